@@ -0,0 +1,727 @@
+/**
+* @file Benchmark.cpp
+* Copyright 2011 Steven Batchelor
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+* @brief Times the engine's hot math routines against the original scalar code they replaced.
+* Run with "render" to also compare the lit pass with the depth pre-pass off and on, and the
+* post processing passes, and frame pacing with auto luminance off, read back in sync and
+* read back late.
+*/
+
+#include <OvglCommon.h>
+#include <OvglContext.h>
+#include <OvglMath.h>
+#include <OvglResource.h>
+#include <OvglGraphics.h>
+#include <OvglScene.h>
+#include <OvglMesh.h>
+#include <OvglWindow.h>
+#include <OvglSkeleton.h>
+#include <GL/glew.h>
+#include <string.h>
+#include <time.h>
+#include <stdlib.h>
+
+// Number of matrices cycled through so the compiler cannot hoist the work out of the timing loop.
+#define SAMPLE_COUNT 1024
+
+// Number of calls timed for each routine.
+#define ITERATIONS 4000000
+
+// The scalar routines the engine shipped with, kept here as the baseline.
+namespace Reference
+{
+Ovgl::Matrix44 multiply( const Ovgl::Matrix44& mine, const Ovgl::Matrix44& in )
+{
+    Ovgl::Matrix44 out;
+	for( int row = 0; row < 4; row++)
+	{
+		for( int col = 0; col < 4; col++)
+		{
+    		out[row][col] = mine[row][0] * in[0][col] + mine[row][1] * in[1][col] + mine[row][2] * in[2][col] + mine[row][3] * in[3][col];
+		}
+	}
+	return out;
+}
+
+Ovgl::Matrix44 inverse( const Ovgl::Matrix44& in_mat )
+{
+    Ovgl::Matrix44 out;
+    float inv[16], det;
+    inv[0] =   in_mat._22*in_mat._33*in_mat._44 - in_mat._22*in_mat._34*in_mat._43 - in_mat._32*in_mat._23*in_mat._44
+            + in_mat._32*in_mat._24*in_mat._43 + in_mat._42*in_mat._23*in_mat._34 - in_mat._42*in_mat._24*in_mat._33;
+    inv[4] =  -in_mat._21*in_mat._33*in_mat._44 + in_mat._21*in_mat._34*in_mat._43 + in_mat._31*in_mat._23*in_mat._44
+            - in_mat._31*in_mat._24*in_mat._43 - in_mat._41*in_mat._23*in_mat._34 + in_mat._41*in_mat._24*in_mat._33;
+    inv[8] =   in_mat._21*in_mat._32*in_mat._44 - in_mat._21*in_mat._34*in_mat._42 - in_mat._31*in_mat._22*in_mat._44
+            + in_mat._31*in_mat._24*in_mat._42 + in_mat._41*in_mat._22*in_mat._34 - in_mat._41*in_mat._24*in_mat._32;
+    inv[12] = -in_mat._21*in_mat._32*in_mat._43 + in_mat._21*in_mat._33*in_mat._42 + in_mat._31*in_mat._22*in_mat._43
+            - in_mat._31*in_mat._23*in_mat._42 - in_mat._41*in_mat._22*in_mat._33 + in_mat._41*in_mat._23*in_mat._32;
+    inv[1] =  -in_mat._12*in_mat._33*in_mat._44 + in_mat._12*in_mat._34*in_mat._43 + in_mat._32*in_mat._13*in_mat._44
+            - in_mat._32*in_mat._14*in_mat._43 - in_mat._42*in_mat._13*in_mat._34 + in_mat._42*in_mat._14*in_mat._33;
+    inv[5] =   in_mat._11*in_mat._33*in_mat._44 - in_mat._11*in_mat._34*in_mat._43 - in_mat._31*in_mat._13*in_mat._44
+            + in_mat._31*in_mat._14*in_mat._43 + in_mat._41*in_mat._13*in_mat._34 - in_mat._41*in_mat._14*in_mat._33;
+    inv[9] =  -in_mat._11*in_mat._32*in_mat._44 + in_mat._11*in_mat._34*in_mat._42 + in_mat._31*in_mat._12*in_mat._44
+            - in_mat._31*in_mat._14*in_mat._42 - in_mat._41*in_mat._12*in_mat._34 + in_mat._41*in_mat._14*in_mat._32;
+    inv[13] =  in_mat._11*in_mat._32*in_mat._43 - in_mat._11*in_mat._33*in_mat._42 - in_mat._31*in_mat._12*in_mat._43
+            + in_mat._31*in_mat._13*in_mat._42 + in_mat._41*in_mat._12*in_mat._33 - in_mat._41*in_mat._13*in_mat._32;
+    inv[2] =   in_mat._12*in_mat._23*in_mat._44 - in_mat._12*in_mat._24*in_mat._43 - in_mat._22*in_mat._13*in_mat._44
+            + in_mat._22*in_mat._14*in_mat._43 + in_mat._42*in_mat._13*in_mat._24 - in_mat._42*in_mat._14*in_mat._23;
+    inv[6] =  -in_mat._11*in_mat._23*in_mat._44 + in_mat._11*in_mat._24*in_mat._43 + in_mat._21*in_mat._13*in_mat._44
+            - in_mat._21*in_mat._14*in_mat._43 - in_mat._41*in_mat._13*in_mat._24 + in_mat._41*in_mat._14*in_mat._23;
+    inv[10] =  in_mat._11*in_mat._22*in_mat._44 - in_mat._11*in_mat._24*in_mat._42 - in_mat._21*in_mat._12*in_mat._44
+            + in_mat._21*in_mat._14*in_mat._42 + in_mat._41*in_mat._12*in_mat._24 - in_mat._41*in_mat._14*in_mat._22;
+    inv[14] = -in_mat._11*in_mat._22*in_mat._43 + in_mat._11*in_mat._23*in_mat._42 + in_mat._21*in_mat._12*in_mat._43
+            - in_mat._21*in_mat._13*in_mat._42 - in_mat._41*in_mat._12*in_mat._23 + in_mat._41*in_mat._13*in_mat._22;
+    inv[3] =  -in_mat._12*in_mat._23*in_mat._34 + in_mat._12*in_mat._24*in_mat._33 + in_mat._22*in_mat._13*in_mat._34
+            - in_mat._22*in_mat._14*in_mat._33 - in_mat._32*in_mat._13*in_mat._24 + in_mat._32*in_mat._14*in_mat._23;
+    inv[7] =   in_mat._11*in_mat._23*in_mat._34 - in_mat._11*in_mat._24*in_mat._33 - in_mat._21*in_mat._13*in_mat._34
+            + in_mat._21*in_mat._14*in_mat._33 + in_mat._31*in_mat._13*in_mat._24 - in_mat._31*in_mat._14*in_mat._23;
+    inv[11] = -in_mat._11*in_mat._22*in_mat._34 + in_mat._11*in_mat._24*in_mat._32 + in_mat._21*in_mat._12*in_mat._34
+            - in_mat._21*in_mat._14*in_mat._32 - in_mat._31*in_mat._12*in_mat._24 + in_mat._31*in_mat._14*in_mat._22;
+    inv[15] =  in_mat._11*in_mat._22*in_mat._33 - in_mat._11*in_mat._23*in_mat._32 - in_mat._21*in_mat._12*in_mat._33
+            + in_mat._21*in_mat._13*in_mat._32 + in_mat._31*in_mat._12*in_mat._23 - in_mat._31*in_mat._13*in_mat._22;
+    det = in_mat._11*inv[0] + in_mat._12*inv[4] + in_mat._13*inv[8] + in_mat._14*inv[12];
+    if (det == 0.0f)
+        return out;
+
+    det = 1.0f / det;
+
+    for (int c = 0; c < 4; c++)
+        for (int r = 0; r < 4; r++)
+            out[c][r] = inv[(c*4) + r] * det;
+    return out;
+}
+
+// The matrix based joint hierarchy Pose used before it kept rotation, translation and scale apart.
+class MatrixJoint
+{
+	public:
+		MatrixJoint* parent;
+		std::vector< MatrixJoint* > children;
+		Ovgl::Matrix44 offset;
+		Ovgl::Matrix44 localTransform;
+		Ovgl::Matrix44 globalTransform;
+};
+
+void updateTransforms( MatrixJoint* pNode )
+{
+	pNode->globalTransform = pNode->localTransform;
+	MatrixJoint* parent = pNode->parent;
+	while( parent )
+	{
+		pNode->globalTransform = pNode->globalTransform * parent->localTransform;
+		parent  = parent->parent;
+	}
+
+	for( uint32_t i = 0; i < pNode->children.size(); i++)
+	{
+		updateTransforms( pNode->children[i]);
+	}
+}
+
+void animate( std::vector< MatrixJoint >& joints, const Ovgl::Animation& anim, std::vector< Ovgl::Matrix44 >& matrices )
+{
+	for( uint32_t a = 0; a < anim.channels.size(); a++ )
+	{
+		const Ovgl::Channel& channel = anim.channels[a];
+		Ovgl::Matrix44 mat = Ovgl::matrixRotationQuaternion( slerp( channel.rotationKeys[0].value, channel.rotationKeys[1].value, 0.5f ) );
+		Ovgl::Vector3 presentPosition = channel.positionKeys[0].value;
+		mat._41 = presentPosition.x; mat._42 = presentPosition.y; mat._43 = presentPosition.z;
+		joints[channel.index].localTransform = mat;
+	}
+	updateTransforms( &joints[0] );
+	for( uint32_t b = 0; b < matrices.size(); b++ )
+	{
+		matrices[b] = inverse( joints[b].offset ) * joints[b].globalTransform;
+	}
+}
+
+// The immediate mode quad every post processing pass drew before the retained triangle.
+void drawFullScreenQuad()
+{
+	glBegin(GL_QUADS);
+	glTexCoord2f( 0.0f, 0.0f );
+	glVertex3f(-1.0f,-1.0f, -1.0f);
+	glTexCoord2f( 1.0f, 0.0f );
+	glVertex3f(1.0f,-1.0f, -1.0f);
+	glTexCoord2f( 1.0f, 1.0f );
+	glVertex3f(1.0f, 1.0f, -1.0f);
+	glTexCoord2f( 0.0f, 1.0f );
+	glVertex3f(-1.0f, 1.0f, -1.0f);
+	glEnd();
+}
+};
+
+std::vector< Ovgl::Matrix44 >	samples;
+std::vector< Ovgl::Matrix44 >	rigidSamples;
+float							sink;
+
+// Returns the nanoseconds spent per call between two clock readings.
+double nanosecondsPerCall( clock_t start, clock_t end, long calls )
+{
+	return ( (double)( end - start ) / CLOCKS_PER_SEC ) * 1.0e9 / (double)calls;
+}
+
+// Largest absolute difference between two matrices.
+float maxError( const Ovgl::Matrix44& a, const Ovgl::Matrix44& b )
+{
+	float error = 0.0f;
+	for( int i = 0; i < 16; i++ )
+	{
+		error = std::max( error, (float)fabs( (&a._11)[i] - (&b._11)[i] ) );
+	}
+	return error;
+}
+
+void printResult( const char* name, double before, double after, float error )
+{
+	printf( "%-30s %10.2f %10.2f %8.2fx %12g\n", name, before, after, before / after, error );
+}
+
+void benchmarkMultiply()
+{
+	clock_t start, end;
+	Ovgl::Matrix44 accumulator;
+
+	start = clock();
+	for( long i = 0; i < ITERATIONS; i++ )
+	{
+		accumulator = Reference::multiply( samples[i % SAMPLE_COUNT], samples[( i + 1 ) % SAMPLE_COUNT] );
+		sink += accumulator._41;
+	}
+	end = clock();
+	double before = nanosecondsPerCall( start, end, ITERATIONS );
+
+	start = clock();
+	for( long i = 0; i < ITERATIONS; i++ )
+	{
+		accumulator = samples[i % SAMPLE_COUNT] * samples[( i + 1 ) % SAMPLE_COUNT];
+		sink += accumulator._41;
+	}
+	end = clock();
+	double after = nanosecondsPerCall( start, end, ITERATIONS );
+
+	float error = 0.0f;
+	for( uint32_t i = 0; i < SAMPLE_COUNT; i++ )
+	{
+		error = std::max( error, maxError( Reference::multiply( samples[i], samples[( i + 1 ) % SAMPLE_COUNT] ), samples[i] * samples[( i + 1 ) % SAMPLE_COUNT] ) );
+	}
+	printResult( "Matrix44 multiply", before, after, error );
+}
+
+// Signature shared by the single matrix routines being timed.
+typedef Ovgl::Matrix44 ( *MatrixFunction )( const Ovgl::Matrix44& );
+
+Ovgl::Matrix44 generalInverse( const Ovgl::Matrix44& matrix )
+{
+	return Ovgl::matrixInverse( Ovgl::Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), matrix );
+}
+
+// Returns the nanoseconds per call of a single matrix routine over the samples.
+double timeMatrixFunction( MatrixFunction function, const std::vector< Ovgl::Matrix44 >& input )
+{
+	Ovgl::Matrix44 accumulator;
+	clock_t start = clock();
+	for( long i = 0; i < ITERATIONS; i++ )
+	{
+		accumulator = function( input[i % SAMPLE_COUNT] );
+		sink += accumulator._41;
+	}
+	clock_t end = clock();
+	return nanosecondsPerCall( start, end, ITERATIONS );
+}
+
+void compareMatrixFunctions( const char* name, MatrixFunction before, MatrixFunction after, const std::vector< Ovgl::Matrix44 >& input )
+{
+	float error = 0.0f;
+	for( uint32_t i = 0; i < SAMPLE_COUNT; i++ )
+	{
+		error = std::max( error, maxError( before( input[i] ), after( input[i] ) ) );
+	}
+	printResult( name, timeMatrixFunction( before, input ), timeMatrixFunction( after, input ), error );
+}
+
+// Same size and layout as Ovgl::Vertex for the position and normal.
+struct BenchmarkVertex
+{
+	Ovgl::Vector3	position;
+	Ovgl::Vector3	normal;
+	float			other[10];
+};
+
+void benchmarkVertexTransform()
+{
+	// Small enough to stay in cache so the routines are timed rather than memory.
+	const uint32_t vertexCount = 1 << 14;
+	const uint32_t repeats = 64;
+	std::vector< BenchmarkVertex > vertices( vertexCount );
+	for( uint32_t i = 0; i < vertexCount; i++ )
+	{
+		vertices[i].position = Ovgl::Vector3( (float)( i % 97 ), (float)( i % 89 ), (float)( i % 83 ) );
+		vertices[i].normal = Ovgl::Vector3( 0.0f, 1.0f, 0.0f );
+	}
+	std::vector< BenchmarkVertex > output = vertices;
+	const Ovgl::Matrix44& matrix = samples[0];
+
+	clock_t start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		for( uint32_t i = 0; i < vertexCount; i++ )
+		{
+			output[i].position = Ovgl::vector3Transform( vertices[i].position, matrix );
+			output[i].normal = Ovgl::vector3Transform( vertices[i].normal, samples[0].rotation() );
+		}
+	}
+	clock_t end = clock();
+	double before = nanosecondsPerCall( start, end, vertexCount * repeats );
+	Ovgl::Vector3 expected = output[vertexCount - 1].position;
+
+	start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		Ovgl::vector3TransformArray( matrix, &vertices[0].position, sizeof( BenchmarkVertex ), &output[0].position, sizeof( BenchmarkVertex ), vertexCount );
+		Ovgl::vector3TransformNormalArray( matrix, &vertices[0].normal, sizeof( BenchmarkVertex ), &output[0].normal, sizeof( BenchmarkVertex ), vertexCount );
+	}
+	end = clock();
+	double after = nanosecondsPerCall( start, end, vertexCount * repeats );
+
+	Ovgl::Vector3 result = output[vertexCount - 1].position;
+	float error = std::max( (float)fabs( result.x - expected.x ), std::max( (float)fabs( result.y - expected.y ), (float)fabs( result.z - expected.z ) ) );
+	printResult( "Vertex transform (strided)", before, after, error );
+	sink += output[vertexCount / 2].normal.y;
+
+	// The same points split into x, y and z streams.
+	std::vector< float > x( vertexCount ), y( vertexCount ), z( vertexCount );
+	for( uint32_t i = 0; i < vertexCount; i++ )
+	{
+		x[i] = vertices[i].position.x;
+		y[i] = vertices[i].position.y;
+		z[i] = vertices[i].position.z;
+	}
+	std::vector< float > outX( vertexCount ), outY( vertexCount ), outZ( vertexCount );
+	start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		// Normals and positions, matching the work done per vertex above.
+		Ovgl::vector3TransformStreams( matrix, &x[0], &y[0], &z[0], &outX[0], &outY[0], &outZ[0], vertexCount, true );
+		Ovgl::vector3TransformStreams( matrix, &x[0], &y[0], &z[0], &outX[0], &outY[0], &outZ[0], vertexCount, false );
+	}
+	end = clock();
+	after = nanosecondsPerCall( start, end, vertexCount * repeats );
+	error = std::max( (float)fabs( outX[vertexCount - 1] - expected.x ), std::max( (float)fabs( outY[vertexCount - 1] - expected.y ), (float)fabs( outZ[vertexCount - 1] - expected.z ) ) );
+	printResult( "Vertex transform (streams)", before, after, error );
+	sink += outY[vertexCount / 2];
+}
+
+void benchmarkPose()
+{
+	// A humanoid sized skeleton: a spine with limbs hanging off it, eight joints deep at most.
+	const uint32_t jointCount = 64;
+	const uint32_t repeats = 20000;
+	Ovgl::Pose pose;
+	std::vector< Reference::MatrixJoint > matrixJoints( jointCount );
+	Ovgl::Animation animation;
+	pose.joints.resize( jointCount );
+	pose.matrices.resize( jointCount );
+	for( uint32_t i = 0; i < jointCount; i++ )
+	{
+		int32_t parent = ( i == 0 ) ? -1 : ( ( i % 8 == 0 ) ? (int32_t)i - 8 : (int32_t)i - 1 );
+		pose.joints[i] = new Ovgl::Joint;
+		pose.joints[i]->parent = ( parent < 0 ) ? NULL : pose.joints[parent];
+		matrixJoints[i].parent = ( parent < 0 ) ? NULL : &matrixJoints[parent];
+		if( parent >= 0 )
+		{
+			pose.joints[parent]->children.push_back( pose.joints[i] );
+			matrixJoints[parent].children.push_back( &matrixJoints[i] );
+		}
+		pose.joints[i]->offset = samples[i];
+		matrixJoints[i].offset = samples[i];
+
+		Ovgl::Channel channel;
+		channel.index = i;
+		Ovgl::VectorKey positionKey;
+		positionKey.time = 0.0;
+		positionKey.value = Ovgl::Vector3( 0.0f, 0.1f * i, 0.0f );
+		channel.positionKeys.push_back( positionKey );
+		positionKey.time = 1.0;
+		channel.positionKeys.push_back( positionKey );
+		Ovgl::QuatKey rotationKey;
+		rotationKey.time = 0.0;
+		rotationKey.value = Ovgl::quaternionNormalize( Ovgl::Vector4( 0.1f, 0.0f, 0.0f, 1.0f ) );
+		channel.rotationKeys.push_back( rotationKey );
+		rotationKey.time = 1.0;
+		rotationKey.value = Ovgl::quaternionNormalize( Ovgl::Vector4( 0.0f, 0.2f, 0.1f, 1.0f ) );
+		channel.rotationKeys.push_back( rotationKey );
+		animation.channels.push_back( channel );
+	}
+	pose.rootJoint = pose.joints[0];
+	std::vector< Ovgl::Matrix44 > referenceMatrices( jointCount );
+
+	clock_t start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		Reference::animate( matrixJoints, animation, referenceMatrices );
+		sink += referenceMatrices[jointCount - 1]._41;
+	}
+	clock_t end = clock();
+	double before = nanosecondsPerCall( start, end, repeats );
+
+	start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		pose.animate( &animation, 0.5f );
+		sink += pose.matrices[jointCount - 1]._41;
+	}
+	end = clock();
+	double after = nanosecondsPerCall( start, end, repeats );
+
+	float error = 0.0f;
+	for( uint32_t i = 0; i < jointCount; i++ )
+	{
+		error = std::max( error, maxError( referenceMatrices[i], pose.matrices[i] ) );
+		delete pose.joints[i];
+	}
+	printResult( "Pose::animate (64 joints)", before, after, error );
+}
+
+void benchmarkFrustumCulling()
+{
+	// Boxes scattered around a camera so roughly a quarter of them are in view.
+	const uint32_t boxCount = 1 << 12;
+	const uint32_t repeats = 256;
+	std::vector< Ovgl::AABB > boxes( boxCount );
+	for( uint32_t i = 0; i < boxCount; i++ )
+	{
+		Ovgl::Vector3 center = Ovgl::vector3Transform( Ovgl::Vector3( 0.0f, 0.0f, 0.0f ), samples[i % SAMPLE_COUNT] ) - Ovgl::Vector3( 50.0f, 50.0f, 50.0f );
+		Ovgl::Vector3 extents( 1.0f + ( i % 5 ), 1.0f + ( i % 3 ), 1.0f + ( i % 7 ) );
+		boxes[i] = Ovgl::AABB( center - extents, center + extents );
+	}
+	Ovgl::Frustum frustum = Ovgl::frustumMatrix( Ovgl::matrixPerspectiveLH( 1.0f, 1.33f, 0.1f, 100.0f ) );
+	std::vector< char > expected( boxCount );
+	bool* visible = new bool[boxCount];
+
+	clock_t start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		for( uint32_t i = 0; i < boxCount; i++ )
+		{
+			expected[i] = Ovgl::frustumIntersectsAABB( frustum, boxes[i] );
+		}
+	}
+	clock_t end = clock();
+	double before = nanosecondsPerCall( start, end, boxCount * repeats );
+
+	start = clock();
+	for( uint32_t r = 0; r < repeats; r++ )
+	{
+		sink += (float)Ovgl::frustumIntersectsAABBArray( frustum, &boxes[0], sizeof( Ovgl::AABB ), visible, boxCount );
+	}
+	end = clock();
+	double after = nanosecondsPerCall( start, end, boxCount * repeats );
+
+	// Count the boxes the two paths disagree on.
+	float error = 0.0f;
+	for( uint32_t i = 0; i < boxCount; i++ )
+	{
+		error += ( (bool)expected[i] != visible[i] ) ? 1.0f : 0.0f;
+	}
+	delete [] visible;
+	printResult( "AABB frustum test", before, after, error );
+}
+
+// Fills the target's view with rows of cubes standing one behind another, lit by many small lights.
+void createCubeRows( Ovgl::Context* context, Ovgl::RenderTarget* target )
+{
+	Ovgl::ResourceManager* resources = new Ovgl::ResourceManager( context, "" );
+	Ovgl::Scene* scene = resources->createScene();
+	target->view = scene->createCamera( Ovgl::matrixTranslation( 0.0f, 0.0f, 0.0f ) );
+	Ovgl::Mesh* cube = context->defaultMedia->meshes[0];
+	for( int z = 0; z < 16; z++ )
+	{
+		for( int y = -2; y <= 2; y++ )
+		{
+			for( int x = -4; x <= 4; x++ )
+			{
+				scene->createObject( cube, Ovgl::matrixTranslation( x * 1.2f, y * 1.2f, 3.0f + z * 1.5f ) );
+			}
+		}
+	}
+	for( uint32_t l = 0; l < 64; l++ )
+	{
+		Ovgl::Light* light = scene->createLight( Ovgl::matrixTranslation( ( l % 8 ) * 1.5f - 5.25f, ( l / 8 % 2 ) * 3.0f - 1.5f, 2.0f + ( l / 16 ) * 6.0f ), Ovgl::Vector4( 1.0f, 1.0f, 1.0f, 1.0f ), Ovgl::POINT_LIGHT );
+		light->radius = 4.0f;
+		light->castShadows = false;
+	}
+}
+
+// Renders the cube rows with the depth pre-pass off and then on, and reports what the lit pass cost.
+void benchmarkDepthPrepass()
+{
+	const uint32_t warmupFrames = 10;
+	const uint32_t frames = 200;
+	Ovgl::Context* context = new Ovgl::Context( 0 );
+	Ovgl::Window* window = new Ovgl::Window( context, "Benchmark", 640, 480 );
+	Ovgl::RenderTarget* target = new Ovgl::RenderTarget( context, window, Ovgl::URect( 0.0f, 0.0f, 1.0f, 1.0f ), 0 );
+	createCubeRows( context, target );
+
+	printf( "\n%-30s %14s %10s %10s\n", "Depth pre-pass", "Lit samples", "Lit GPU ms", "Frame ms" );
+	for( uint32_t mode = 0; mode < 2; mode++ )
+	{
+		target->depthPrepass = ( mode == 1 );
+		for( uint32_t f = 0; f < warmupFrames; f++ )
+		{
+			target->render();
+		}
+
+		// Query results arrive a frame or more late, so every frame adds the latest one.
+		uint64_t samples = 0;
+		double gpuMilliseconds = 0.0;
+		clock_t start = clock();
+		for( uint32_t f = 0; f < frames; f++ )
+		{
+			target->render();
+			samples += target->litSamples;
+			gpuMilliseconds += target->litMilliseconds;
+		}
+		clock_t end = clock();
+		printf( "%-30s %14.0f %10.3f %10.3f\n", mode ? "on" : "off", (double)samples / frames, gpuMilliseconds / frames, ( end - start ) * 1000.0 / CLOCKS_PER_SEC / frames );
+	}
+	delete context;
+}
+
+// Reports the full screen passes and texture traffic of every combination of the post
+// processing passes, then the CPU time of each render graph pass with all of them on. The
+// immediate mode quads the passes drew before are gone from the engine, so the full screen draw
+// they did is timed against the retained triangle the passes draw now.
+void benchmarkPostProcessing()
+{
+	const uint32_t warmupFrames = 10;
+	const uint32_t frames = 200;
+	const long draws = 100000;
+	Ovgl::Context* context = new Ovgl::Context( 0 );
+	Ovgl::Window* window = new Ovgl::Window( context, "Benchmark", 640, 480 );
+	Ovgl::RenderTarget* target = new Ovgl::RenderTarget( context, window, Ovgl::URect( 0.0f, 0.0f, 1.0f, 1.0f ), 0 );
+	createCubeRows( context, target );
+	printf( "\n%-30s %10s %14s %10s\n", "Bloom, motion blur, luminance", "Passes", "Bandwidth MB", "Frame ms" );
+	for( uint32_t c = 0; c < 8; c++ )
+	{
+		target->bloom = ( c & 1 ) ? 4 : 0;
+		target->motionBlur = ( c & 2 ) != 0;
+		target->autoLuminance = ( c & 4 ) != 0;
+		for( uint32_t f = 0; f < warmupFrames; f++ )
+		{
+			target->render();
+		}
+		clock_t start = clock();
+		for( uint32_t f = 0; f < frames; f++ )
+		{
+			target->render();
+		}
+		clock_t end = clock();
+		char name[32];
+		sprintf( name, "%-3s %-3s %-3s", ( c & 1 ) ? "on" : "off", ( c & 2 ) ? "on" : "off", ( c & 4 ) ? "on" : "off" );
+		printf( "%-30s %10u %14.2f %10.3f\n", name, target->postPasses, target->postBandwidth / ( 1024.0 * 1024.0 ), ( end - start ) * 1000.0 / CLOCKS_PER_SEC / frames );
+	}
+
+	target->bloom = 4;
+	target->motionBlur = true;
+	target->autoLuminance = true;
+	for( uint32_t f = 0; f < warmupFrames; f++ )
+	{
+		target->render();
+	}
+	std::map< std::string, double > passTimes;
+	for( uint32_t f = 0; f < frames; f++ )
+	{
+		target->render();
+		for( std::map< std::string, double >::iterator p = target->passTimes.begin(); p != target->passTimes.end(); p++ )
+		{
+			passTimes[p->first] += p->second;
+		}
+	}
+	printf( "\n%-30s %10s\n", "Render graph pass", "CPU ms" );
+	for( std::map< std::string, double >::iterator p = passTimes.begin(); p != passTimes.end(); p++ )
+	{
+		printf( "%-30s %10.3f\n", p->first.c_str(), p->second / frames );
+	}
+
+	// A one pixel viewport keeps the GPU's fill cost out of the submission time.
+	SDL_GL_MakeCurrent( window->sdlWindow, window->windowContext );
+	glViewport( 0, 0, 1, 1 );
+	float corners[6] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+	GLuint buffer, vertexArray;
+	glGenBuffers( 1, &buffer );
+	glBindBuffer( GL_ARRAY_BUFFER, buffer );
+	glBufferData( GL_ARRAY_BUFFER, sizeof( corners ), corners, GL_STATIC_DRAW );
+	glGenVertexArrays( 1, &vertexArray );
+	glBindVertexArray( vertexArray );
+	glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 0, NULL );
+	glEnableVertexAttribArray( 0 );
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	glFinish();
+	clock_t quadStart = clock();
+	for( long d = 0; d < draws; d++ )
+	{
+		Reference::drawFullScreenQuad();
+	}
+	glFinish();
+	clock_t triangleStart = clock();
+	for( long d = 0; d < draws; d++ )
+	{
+		glBindVertexArray( vertexArray );
+		glDrawArrays( GL_TRIANGLES, 0, 3 );
+	}
+	glBindVertexArray( 0 );
+	glFinish();
+	clock_t triangleEnd = clock();
+	printf( "\n%-30s %10s %10s %9s\n", "Full screen draw", "Before ns", "After ns", "Speedup" );
+	double before = nanosecondsPerCall( quadStart, triangleStart, draws );
+	double after = nanosecondsPerCall( triangleStart, triangleEnd, draws );
+	printf( "%-30s %10.1f %10.1f %8.2fx\n", "quad vs triangle", before, after, before / after );
+	glDeleteVertexArrays( 1, &vertexArray );
+	glDeleteBuffers( 1, &buffer );
+	SDL_GL_MakeCurrent( NULL, NULL );
+	delete context;
+}
+
+// Renders the cube rows with auto luminance off, reading the luminance back every frame and
+// reading it back through pixel buffers a few frames late. Waiting for the GPU shows up as
+// uneven frames more than as slower ones, so the spread of the frame times is reported too.
+void benchmarkAutoLuminance()
+{
+	const uint32_t warmupFrames = 10;
+	const uint32_t frames = 200;
+	Ovgl::Context* context = new Ovgl::Context( 0 );
+	Ovgl::Window* window = new Ovgl::Window( context, "Benchmark", 640, 480 );
+	Ovgl::RenderTarget* target = new Ovgl::RenderTarget( context, window, Ovgl::URect( 0.0f, 0.0f, 1.0f, 1.0f ), 0 );
+	createCubeRows( context, target );
+	const char* names[3] = { "off", "on, sync", "on, async" };
+	printf( "\n%-30s %10s %10s\n", "Auto luminance", "Frame ms", "Std dev ms" );
+	for( uint32_t mode = 0; mode < 3; mode++ )
+	{
+		target->autoLuminance = ( mode > 0 );
+		target->asyncLuminance = ( mode == 2 );
+		for( uint32_t f = 0; f < warmupFrames; f++ )
+		{
+			target->render();
+		}
+
+		// Frames are timed on the wall clock, a stall waiting for the GPU is not CPU time.
+		double sum = 0.0;
+		double sumSquares = 0.0;
+		for( uint32_t f = 0; f < frames; f++ )
+		{
+			uint64_t start = SDL_GetPerformanceCounter();
+			target->render();
+			double milliseconds = ( SDL_GetPerformanceCounter() - start ) * 1000.0 / SDL_GetPerformanceFrequency();
+			sum += milliseconds;
+			sumSquares += milliseconds * milliseconds;
+		}
+		double mean = sum / frames;
+		printf( "%-30s %10.3f %10.3f\n", names[mode], mean, sqrt( std::max( sumSquares / frames - mean * mean, 0.0 ) ) );
+	}
+	delete context;
+}
+
+void benchmarkVertexFormats()
+{
+	Ovgl::Context* context = new Ovgl::Context( 0 );
+	Ovgl::Mesh* cube = context->defaultMedia->meshes[0];
+
+	// A copy of the cube whose vertices are shared between two bones by height.
+	Ovgl::Mesh* skinned = new Ovgl::Mesh;
+	skinned->mediaLibrary = context->defaultMedia;
+	skinned->skeleton = new Ovgl::Skeleton;
+	skinned->vertices = cube->vertices;
+	skinned->faces = cube->faces;
+	skinned->attributes = cube->attributes;
+	for( uint32_t v = 0; v < skinned->vertices.size(); v++ )
+	{
+		float t = skinned->vertices[v].position.y + 0.5f;
+		skinned->vertices[v].weight = Ovgl::Vector4( 1.0f - t * 0.5f, t * 0.5f, 0.0f, 0.0f );
+		skinned->vertices[v].indices = Ovgl::Vector4( 0.0f, 1.0f, 0.0f, 0.0f );
+	}
+	Ovgl::Bone* bone = new Ovgl::Bone;
+	bone->matrix = Ovgl::matrixIdentity();
+	bone->length = 1.0f;
+	bone->mesh = new Ovgl::Mesh;
+	bone->mesh->mediaLibrary = context->defaultMedia;
+	bone->convex = NULL;
+	skinned->skeleton->bones.push_back( bone );
+
+	Ovgl::Mesh* meshes[2] = { cube, skinned };
+	const char* names[2] = { "static", "skinned" };
+
+	// Sizes are what the driver reports for the buffers, not its own allocations.
+	printf( "\n%-30s %14s %14s\n", "GL vertex buffer sizes", "Float B/vtx", "Packed B/vtx" );
+	for( uint32_t m = 0; m < 2; m++ )
+	{
+		uint32_t bytes[2];
+		for( uint32_t packed = 0; packed < 2; packed++ )
+		{
+			meshes[m]->packVertices = ( packed == 1 );
+			meshes[m]->update();
+			bytes[packed] = meshes[m]->getVertexMemory();
+		}
+		printf( "%-30s %14.1f %14.1f\n", names[m], (double)bytes[0] / meshes[m]->vertices.size(), (double)bytes[1] / meshes[m]->vertices.size() );
+	}
+	Ovgl::Skeleton* skeleton = skinned->skeleton;
+	delete skinned;
+	delete bone->mesh;
+	delete bone;
+	delete skeleton;
+	delete context;
+}
+
+int main( int argc, char** argv )
+{
+	// Scaled, rotated and translated matrices like the ones the engine feeds through these routines every frame.
+	srand( 1 );
+	for( uint32_t i = 0; i < SAMPLE_COUNT; i++ )
+	{
+		float r[7];
+		for( uint32_t j = 0; j < 7; j++ )
+		{
+			r[j] = (float)rand() / (float)RAND_MAX;
+		}
+		float scale = 0.5f + r[6];
+		Ovgl::Matrix44 rigid = Ovgl::matrixRotationEuler( r[0] * 6.0f, r[1] * 6.0f, r[2] * 6.0f ) * Ovgl::matrixTranslation( r[3] * 100.0f, r[4] * 100.0f, r[5] * 100.0f );
+		rigidSamples.push_back( rigid );
+		samples.push_back( Ovgl::matrixScaling( scale, scale, scale ) * rigid );
+	}
+
+	printf( "Ovgl math kernels: %s\n\n", Ovgl::mathInstructionSet() );
+	printf( "%-30s %10s %10s %9s %12s\n", "Routine", "Before ns", "After ns", "Speedup", "Max error" );
+	benchmarkMultiply();
+	compareMatrixFunctions( "matrixInverse", Reference::inverse, generalInverse, samples );
+	compareMatrixFunctions( "matrixInverseRigid", generalInverse, Ovgl::matrixInverseRigid, rigidSamples );
+	compareMatrixFunctions( "matrixInverseAffine", generalInverse, Ovgl::matrixInverseAffine, samples );
+	benchmarkVertexTransform();
+	benchmarkPose();
+	benchmarkFrustumCulling();
+
+	// Rendering needs a window and a GPU, so it only runs when asked for.
+	if( argc > 1 && !strcmp( argv[1], "render" ) )
+	{
+		benchmarkDepthPrepass();
+		benchmarkPostProcessing();
+		benchmarkAutoLuminance();
+		benchmarkVertexFormats();
+	}
+
+	// Print the sink so the optimizer has to keep every timed call.
+	printf( "\n(checksum %g)\n", sink );
+	return 0;
+}
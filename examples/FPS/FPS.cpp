@@ -92,7 +92,7 @@ int main()
     // Create Render Target
     renderTarget = new Ovgl::RenderTarget( context, window, Ovgl::URect(0, 0, 1.0f, 1.0f), 0);
 
-	// Blurs bloom across four angles
+	// Builds bloom from four pyramid levels
     renderTarget->bloom = 4;
 
 	// Auto adjust brightness
@@ -59,9 +59,15 @@ extern "C"
 
 	typedef void *SDL_GLContext;
 	struct SDL_Window;
+	struct SDL_Thread;
+	typedef struct SDL_semaphore SDL_sem;
 	extern DECLSPEC void SDLCALL SDL_GetWindowPosition( SDL_Window * window, int *x, int *y );
 	extern DECLSPEC void SDLCALL SDL_GetWindowSize( SDL_Window * window, int *w, int *h );
 	extern DECLSPEC int SDLCALL SDL_GL_MakeCurrent(SDL_Window * window, SDL_GLContext context);
+	extern DECLSPEC SDL_GLContext SDLCALL SDL_GL_GetCurrentContext(void);
+	extern DECLSPEC SDL_Window* SDLCALL SDL_GL_GetCurrentWindow(void);
+	extern DECLSPEC uint64_t SDLCALL SDL_GetPerformanceCounter(void);
+	extern DECLSPEC uint64_t SDLCALL SDL_GetPerformanceFrequency(void);
 }
 
 typedef struct _CGeffect *CGeffect;
@@ -151,6 +157,8 @@ extern "C"
 	class Context;
 	class Interface;
 	class RenderTarget;
+	class TexturePool;
+	class SkinCache;
 	class Effect;
 	class Event;
 	class ResourceManager;
@@ -241,10 +249,48 @@ extern "C"
 			ALCdevice*                              alDevice;
 			ALCcontext*                             alContext;
 			ResourceManager*                        defaultMedia;
+			uint32_t                                shaderStamp;
+			TexturePool*                            texturePool;
+			SkinCache*                              skinCache;
+			std::vector< SDL_Thread* >              workers;
+			std::vector< SDL_sem* >                 workStart;
+			SDL_sem*                                workDone;
+			void                                    (*workJob)( void* data, uint32_t begin, uint32_t end );
+			void*                                   workData;
+			uint32_t                                workCount;
+			bool                                    workStop;
 			std::vector< ResourceManager* >         mediaLibraries;
 			std::vector< Window* >                  windows;
 			FT_Library                              ftLibrary;
+
+			/**
+			 * Vertex array objects released while another GL context was current, by the GL
+			 * context they belong to. They are deleted the next time their context renders.
+			 */
+			std::map< void*, std::vector< uint32_t > > releasedVertexArrays;
 			void                                    start();
+
+			/**
+			 * Deletes a vertex array object now if its GL context is current, or else the next
+			 * time that context renders. Vertex array objects are not shared between contexts.
+			 * @param glContext GL context the vertex array object was built in.
+			 * @param vertexArray The vertex array object.
+			 */
+			void                                    releaseVertexArray( void* glContext, uint32_t vertexArray );
+
+			/**
+			 * Deletes the vertex array objects released for the current GL context.
+			 */
+			void                                    deleteReleasedVertexArrays();
+
+			/**
+			 * Splits the range 0 to count into one slice per worker thread plus one for the
+			 * calling thread and runs the job on every slice at once, returning when all are done.
+			 * @param count Number of items the job covers.
+			 * @param job Function called with the data and the first and one past the last item of a slice.
+			 * @param data Pointer passed to the job.
+			 */
+			void                                    parallelFor( uint32_t count, void (*job)( void* data, uint32_t begin, uint32_t end ), void* data );
 	};
 }
 }
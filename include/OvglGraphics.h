@@ -31,6 +31,644 @@ extern "C"
 	class Font;
 	class Event;
 	class Material;
+	class Mesh;
+	class RenderTarget;
+	class SkinnedMesh;
+
+	/**
+	 * Camera and light values that stay the same for every draw of one render. They are
+	 * built once at the start of Ovgl::RenderTarget::render and passed to every draw.
+	 * @brief Per view constants of a frame.
+	 */
+	class DLLEXPORT FrameConstants
+	{
+		public:
+
+			/**
+			 * World to camera matrix.
+			 */
+			Matrix44 view;
+
+			/**
+			 * Camera to clip matrix.
+			 */
+			Matrix44 projection;
+
+			/**
+			 * World to clip matrix.
+			 */
+			Matrix44 viewProj;
+
+			/**
+			 * Position of the camera in world space.
+			 */
+			Vector4 viewPosition;
+
+			/**
+			 * Lights whose influence reaches the camera's view, in the order of the arrays below.
+			 * Lights without a radius come first.
+			 */
+			std::vector< Light* > lightSources;
+
+			/**
+			 * World position of every light packed as x, y, z and 1, or for directional lights
+			 * the direction towards the light packed as x, y, z and 0.
+			 */
+			std::vector< Vector4 > lights;
+
+			/**
+			 * Color of every light packed as r, g, b and radius.
+			 */
+			std::vector< Vector4 > lightColors;
+
+			/**
+			 * Cone of every light packed as the direction the light shines in and the cosine of
+			 * half its angle. Lights other than spot lights have no direction and a cosine of -1.
+			 */
+			std::vector< Vector4 > lightSpots;
+
+			/**
+			 * Sphere around everything every light can reach packed as center and radius. Lights
+			 * without a radius have a radius of 0.
+			 */
+			std::vector< Vector4 > lightSpheres;
+
+			/**
+			 * Shadow map layers of every light packed as first layer, number of layers to
+			 * search, 1 for point lights and 0. Lights without shadows have no layers.
+			 */
+			std::vector< Vector4 > lightShadows;
+
+			/**
+			 * World to clip matrix of every shadow map layer.
+			 */
+			std::vector< Matrix44 > shadowMatrices;
+
+			/**
+			 * Number of lights at the front of the arrays above that have no radius.
+			 */
+			uint32_t globalLights;
+
+			/**
+			 * Change stamp shared by every camera and light upload of this frame.
+			 */
+			uint32_t stamp;
+	};
+
+	/**
+	 * Divides the camera's view into a grid of cells, evenly across the screen and
+	 * logarithmically in depth, and lists the lights reaching each cell so pixels only shade
+	 * the lights of their own cell. Lights without a radius reach every cell and are shaded
+	 * by every pixel instead of being listed. The lists are sent to the shaders through
+	 * texture buffers.
+	 * @brief Clustered light lists of a frame.
+	 */
+	class DLLEXPORT LightClusters
+	{
+		public:
+
+			LightClusters();
+			~LightClusters();
+
+			/**
+			 * Number of cells across, down and in depth.
+			 */
+			uint32_t gridX;
+			uint32_t gridY;
+			uint32_t gridZ;
+
+			/**
+			 * Depth the first slice ends at and depth the last slice starts at.
+			 */
+			float nearDistance;
+			float farDistance;
+
+			/**
+			 * Tangents of half the camera's horizontal and vertical field of view, and slices per
+			 * unit of logarithmic depth, set by build.
+			 */
+			float tanX;
+			float tanY;
+			float sliceScale;
+
+			/**
+			 * Number of lights at the front of the light data that reach every cell.
+			 */
+			uint32_t globalLights;
+
+			/**
+			 * View space centers and radii of the lights with a radius, one array per component.
+			 */
+			std::vector< float > centerX;
+			std::vector< float > centerY;
+			std::vector< float > centerZ;
+			std::vector< float > radii;
+
+			/**
+			 * Number of listed lights and first entry in the index list of every cell.
+			 */
+			std::vector< uint32_t > counts;
+			std::vector< uint32_t > offsets;
+
+			/**
+			 * Light data of every light as position, color, cone and shadow layers, cell table
+			 * as first entry and count of every cell, and light of every entry in the cells' lists.
+			 */
+			std::vector< Vector4 > lightData;
+			std::vector< float > table;
+			std::vector< float > indices;
+
+			/**
+			 * Buffers holding the light data, cell table and index list, and the texture buffer
+			 * views the shaders read them through.
+			 */
+			uint32_t lightBuffer;
+			uint32_t lightTexture;
+			uint32_t tableBuffer;
+			uint32_t tableTexture;
+			uint32_t indexBuffer;
+			uint32_t indexTexture;
+
+			/**
+			 * Lists the lights of a frame in the cells they reach and uploads the lists.
+			 * @param context Context whose worker threads fill the cells, one range of depth slices each.
+			 * @param frame Camera and light values of the frame, with the shadow layers of its lights placed.
+			 */
+			void build( Context* context, const FrameConstants& frame );
+
+			/**
+			 * Returns the depth slice of a view space depth.
+			 */
+			uint32_t getSlice( float depth ) const;
+
+			/**
+			 * Counts the lights of every cell in a range of depth slices, or lists them when
+			 * the offsets are known.
+			 * @param begin First slice.
+			 * @param end One past the last slice.
+			 * @param fill Indicates if the lights are listed rather than counted.
+			 */
+			void assignSlices( uint32_t begin, uint32_t end, bool fill );
+	};
+
+	/**
+	 * One subset of a mesh waiting to be drawn by a render queue.
+	 * @brief Render queue entry.
+	 */
+	class DLLEXPORT DrawItem
+	{
+		public:
+
+			/**
+			 * Sort key. Opaque items are ordered by shader, material, mesh, subset and then front
+			 * to back. Post render items have the top bit set and are ordered back to front.
+			 * The key holds ids for up to 1023 shaders, 16383 materials and meshes and 31 subsets
+			 * per frame. Later ones share the last id and RenderQueue::sort orders them by
+			 * pointer instead.
+			 */
+			uint64_t key;
+
+			/**
+			 * Mesh and subset to draw.
+			 */
+			const Mesh* mesh;
+			uint32_t subset;
+
+			/**
+			 * Material of the subset.
+			 */
+			Material* material;
+
+			/**
+			 * Skinned copy of the mesh the subset is drawn from as static geometry, or NULL if
+			 * the mesh is skinned while it is drawn.
+			 */
+			const SkinnedMesh* skinned;
+
+			/**
+			 * ShaderPermutation flags of the permutation of the material's shader the subset is
+			 * drawn with, without SHADER_INSTANCED which is added when the draw is merged.
+			 */
+			uint32_t permutation;
+
+			/**
+			 * World matrix multiplied by the view projection.
+			 */
+			Matrix44 world;
+
+			/**
+			 * Bone palette, it must stay valid until the queue is rendered.
+			 */
+			const Matrix44* pose;
+			uint32_t boneCount;
+
+			/**
+			 * Change stamp shared by every subset of the mesh.
+			 */
+			uint32_t stamp;
+	};
+
+	/**
+	 * Collects the draws of a frame so they can be submitted in an order that keeps state changes low.
+	 * @brief Sorted list of draws.
+	 */
+	class DLLEXPORT RenderQueue
+	{
+		public:
+			RenderQueue();
+
+			/**
+			 * Items in the order they were queued.
+			 */
+			std::vector< DrawItem > items;
+
+			/**
+			 * Indices of the items in draw order, filled by sort.
+			 */
+			std::vector< uint32_t > order;
+
+			/**
+			 * Number of items drawn together by one instanced draw starting at each position of
+			 * order, 0 for items drawn on their own. Filled by renderQueue.
+			 */
+			std::vector< uint32_t > runs;
+
+			/**
+			 * Bone palettes of every instanced item, one run after another, in the layout of the
+			 * instance buffer.
+			 */
+			std::vector< Matrix44 > palettes;
+
+			/**
+			 * Small ids given to shaders, materials and meshes for the sort keys.
+			 */
+			std::map< const void*, uint32_t > ids;
+
+			/**
+			 * Indicates if an id or subset did not fit its field of a sort key since the last clear.
+			 */
+			bool overflow;
+
+			/**
+			 * Removes every item.
+			 */
+			void clear();
+
+			/**
+			 * Returns the id of a shader, material or mesh, giving it the next free id the first time.
+			 */
+			uint32_t getId( const void* pointer );
+
+			/**
+			 * Orders the items by their sort keys.
+			 */
+			void sort();
+	};
+
+	/**
+	 * Size and format of a texture, the key textures are pooled under.
+	 * @brief Texture description.
+	 */
+	class DLLEXPORT TextureDesc
+	{
+		public:
+			TextureDesc();
+			TextureDesc( int width, int height, uint32_t format, uint32_t samples, bool mipmaps );
+
+			/**
+			 * Size of the texture in pixels.
+			 */
+			int width;
+			int height;
+
+			/**
+			 * Internal format of the texture.
+			 */
+			uint32_t format;
+
+			/**
+			 * Samples per pixel, textures with more than one are multisample textures.
+			 */
+			uint32_t samples;
+
+			/**
+			 * Indicates if the texture has a full mip chain.
+			 */
+			bool mipmaps;
+
+			/**
+			 * Estimated bytes of video memory the texture takes up.
+			 */
+			uint64_t getBytes() const;
+
+			bool operator == ( const TextureDesc& desc ) const;
+	};
+
+	/**
+	 * A texture owned by the texture pool.
+	 * @brief Pooled texture.
+	 */
+	class DLLEXPORT PooledTexture
+	{
+		public:
+			TextureDesc desc;
+			uint32_t texture;
+
+			/**
+			 * Indicates if the texture is handed out.
+			 */
+			bool inUse;
+
+			/**
+			 * Frame the texture was last handed out in.
+			 */
+			uint32_t lastFrame;
+	};
+
+	/**
+	 * Hands out textures for the intermediate results of rendering. Textures are given back
+	 * once the passes reading them are done, so render targets of the same size share them
+	 * and textures are only created when no free one of the same size and format is left.
+	 * Textures live in the context's shared GL context, so any render target can use them.
+	 * @brief Pool of transient textures.
+	 */
+	class DLLEXPORT TexturePool
+	{
+		public:
+			TexturePool();
+			~TexturePool();
+
+			/**
+			 * Every texture of the pool.
+			 */
+			std::vector< PooledTexture > textures;
+
+			/**
+			 * Number of collections, which the context runs once per frame.
+			 */
+			uint32_t frame;
+
+			/**
+			 * Estimated bytes of video memory taken up by the pool's textures.
+			 */
+			uint64_t allocatedBytes;
+
+			/**
+			 * Hands out a free texture of the given size and format, creating one if there is none.
+			 * @param desc Size and format of the texture.
+			 */
+			uint32_t acquire( const TextureDesc& desc );
+
+			/**
+			 * Gives a texture back to the pool.
+			 * @param texture A texture handed out by acquire.
+			 */
+			void release( uint32_t texture );
+
+			/**
+			 * Deletes free textures that were not handed out for a number of frames, which
+			 * frees the textures of sizes no render target uses anymore, and starts a new frame.
+			 * @param maxIdleFrames Frames a free texture is kept without being handed out.
+			 */
+			void collect( uint32_t maxIdleFrames );
+	};
+
+	/**
+	 * Vertices of a mesh skinned by one bone palette, kept by the skin cache.
+	 * @brief Skinned mesh copy.
+	 */
+	class DLLEXPORT SkinnedMesh
+	{
+		public:
+			const Mesh* mesh;
+
+			/**
+			 * Palette the vertices were skinned with.
+			 */
+			std::vector< Matrix44 > palette;
+
+			/**
+			 * Buffers holding the skinned positions and normals, one Vector3 per vertex each.
+			 * Texture coordinates are read from the mesh's shading stream, and every vertex
+			 * follows bone 0 completely.
+			 */
+			uint32_t positionBuffer;
+			uint32_t shadingBuffer;
+
+			/**
+			 * Indicates if the vertex buffer holds the mesh skinned by the palette.
+			 */
+			bool skinned;
+
+			/**
+			 * Number of draws of the mesh with this palette during the current and the last frame.
+			 */
+			uint32_t draws;
+			uint32_t lastDraws;
+
+			/**
+			 * Frame the mesh was last drawn or prepared in, and frame its skin was last checked in.
+			 */
+			uint32_t lastFrame;
+			uint32_t readyFrame;
+	};
+
+	/**
+	 * Skins meshes drawn more than once a frame a single time with transform feedback, so the
+	 * shadow passes, the depth pre-pass and every render target viewing the scene draw them
+	 * as static geometry. Meshes are tracked by their bone palette, and the draws of the
+	 * last frame decide which ones are worth skinning ahead, so a mesh is first skinned
+	 * ahead in the frame after the one it was drawn more than once in. Frames are counted
+	 * by the renders of each render target, a frame ends when a target renders again.
+	 * @brief Cache of skinned meshes.
+	 */
+	class DLLEXPORT SkinCache
+	{
+		public:
+			SkinCache( Context* context );
+			~SkinCache();
+
+			/**
+			 * Context whose meshes are cached.
+			 */
+			Context* context;
+
+			/**
+			 * Indicates if meshes are skinned ahead at all.
+			 */
+			bool enabled;
+
+			/**
+			 * Skinned copies by mesh and palette.
+			 */
+			std::map< std::pair< const Mesh*, const Matrix44* >, SkinnedMesh > meshes;
+
+			/**
+			 * Number of frames counted so far.
+			 */
+			uint32_t frame;
+
+			/**
+			 * Render targets that rendered during the current frame.
+			 */
+			std::vector< const RenderTarget* > renderedTargets;
+
+			/**
+			 * Program skinning the vertices, built on first use, and the location of its palette.
+			 */
+			uint32_t program;
+			int32_t paletteLocation;
+			bool programFailed;
+
+			/**
+			 * Vertex array object of every GL context that cached meshes are drawn through.
+			 */
+			std::map< void*, uint32_t > vertexArrays;
+
+			/**
+			 * Number of meshes skinned and of draws served from the cache during the current frame.
+			 */
+			uint32_t skinnedMeshes;
+			uint32_t cachedDraws;
+
+			/**
+			 * Skins a mesh ahead if it was drawn more than once last frame and its palette
+			 * changed since it was last skinned. Meshes with a single bone or without weights are
+			 * left alone. Must be called before the mesh is drawn.
+			 * @param mesh The mesh.
+			 * @param pose Bone palette, the same pointer must be passed to draw.
+			 * @param boneCount Number of matrices in the palette.
+			 */
+			void prepare( const Mesh* mesh, const Matrix44* pose, uint32_t boneCount );
+
+			/**
+			 * Counts draws of a mesh and returns its skinned copy if it was prepared this frame,
+			 * or NULL if the mesh is to be skinned while drawing.
+			 * @param mesh The mesh.
+			 * @param pose Bone palette passed to prepare.
+			 * @param passes Number of draws that are counted.
+			 */
+			const SkinnedMesh* draw( const Mesh* mesh, const Matrix44* pose, uint32_t passes );
+
+			/**
+			 * Binds a vertex array object drawing a skinned copy with its mesh's indices.
+			 * @param skinnedMesh The skinned copy.
+			 * @param depthOnly Indicates if only the positions are read, for passes that write depth alone.
+			 */
+			void bind( const SkinnedMesh* skinnedMesh, bool depthOnly );
+
+			/**
+			 * Releases the vertex array object built in a GL context, or in every context if it
+			 * is NULL.
+			 * @param glContext The GL context or NULL.
+			 */
+			void releaseVertexArrays( void* glContext );
+
+			/**
+			 * Called by every render target before it renders, collects when a new frame starts.
+			 * @param target The render target.
+			 */
+			void beginRender( const RenderTarget* target );
+
+			/**
+			 * Deletes copies that were not drawn for a number of frames and starts a new frame.
+			 * @param maxIdleFrames Frames a copy is kept without being drawn.
+			 */
+			void collect( uint32_t maxIdleFrames );
+	};
+
+	/**
+	 * A transient texture used by the passes of a render graph.
+	 * @brief Render graph resource.
+	 */
+	class DLLEXPORT RenderResource
+	{
+		public:
+			TextureDesc desc;
+
+			/**
+			 * Variable that holds the texture while the resource is alive and 0 otherwise.
+			 */
+			uint32_t* binding;
+
+			/**
+			 * Index of the first and last pass using the resource, found when the graph is executed.
+			 */
+			uint32_t firstPass;
+			uint32_t lastPass;
+	};
+
+	/**
+	 * A step of a render graph.
+	 * @brief Render graph pass.
+	 */
+	class DLLEXPORT RenderPass
+	{
+		public:
+			std::string name;
+
+			/**
+			 * Render target function drawing the pass.
+			 */
+			void (RenderTarget::*execute)();
+
+			/**
+			 * Resources the pass reads and writes.
+			 */
+			std::vector< uint32_t > reads;
+			std::vector< uint32_t > writes;
+	};
+
+	/**
+	 * Lists the passes of a render and the transient textures they read and write. When the
+	 * graph is executed every texture is taken from the texture pool just before the first
+	 * pass using it and given back right after the last one, so textures are shared between
+	 * passes and render targets whose uses do not overlap.
+	 * @brief Passes of a render and their resources.
+	 */
+	class DLLEXPORT RenderGraph
+	{
+		public:
+			std::vector< RenderResource > resources;
+			std::vector< RenderPass > passes;
+
+			/**
+			 * Removes every pass and resource.
+			 */
+			void clear();
+
+			/**
+			 * Declares a transient texture.
+			 * @param desc Size and format of the texture.
+			 * @param binding Variable given the texture while the resource is alive.
+			 */
+			uint32_t addTexture( const TextureDesc& desc, uint32_t* binding );
+
+			/**
+			 * Declares a pass, passes run in the order they are added.
+			 * @param name Name the pass is profiled under.
+			 * @param execute Render target function drawing the pass.
+			 */
+			uint32_t addPass( const std::string& name, void (RenderTarget::*execute)() );
+
+			/**
+			 * Declares that a pass reads a resource.
+			 */
+			void read( uint32_t pass, uint32_t resource );
+
+			/**
+			 * Declares that a pass writes a resource.
+			 */
+			void write( uint32_t pass, uint32_t resource );
+
+			/**
+			 * Runs the passes on a render target, taking their textures from a pool and
+			 * recording the CPU time of each pass in the target's pass times.
+			 * @param target Render target the passes draw for.
+			 * @param pool Pool the textures are taken from.
+			 */
+			void execute( RenderTarget* target, TexturePool* pool );
+	};
 
 	class DLLEXPORT RenderTarget
 	{
@@ -72,44 +710,115 @@ extern "C"
 			uint32_t effectFrameBuffer;
 
 			/**
-			 * Depth buffer used for rendering.
+			 * Multisampled depth and color textures the scene is drawn into.
 			 */
 			uint32_t depthBuffer;
+			uint32_t colorBuffer;
 
 			/**
-			 * Color buffer used for rendering.
+			 * Resolved scene depth, read by motion blur.
 			 */
-			uint32_t colorBuffer;
+			uint32_t depthTexture;
+
+			/**
+			 * Resolved scene color, the source of post processing.
+			 */
+			uint32_t primaryTex;
+			
+			/**
+			 * Levels of the bloom pyramid, each half the size of the one before, starting at
+			 * half the size of the primary texture.
+			 */
+			std::vector< uint32_t > bloomTextures;
 
 			/**
-			 *
+			 * Indicates if lights cast shadows.
 			 */
-			uint32_t colorTexture;
+			bool shadows;
 
 			/**
-			 *
+			 * Width and height of every shadow map layer.
 			 */
-			uint32_t depthTexture;
+			uint32_t shadowResolution;
 
 			/**
-			 * This is the primary texture.
+			 * Distance from the camera the cascades of directional light shadows reach, and the
+			 * range of point and spot light shadows.
 			 */
-			uint32_t primaryTex;
-			
+			float shadowDistance;
+
+			/**
+			 * Number of cascades directional light shadows are split into.
+			 */
+			uint32_t shadowCascades;
+
+			/**
+			 * Shadow maps of every shadowed light as the layers of one array texture, and a copy
+			 * of each layer holding only static objects, which is redrawn only when a static
+			 * object or the layer's light moves.
+			 */
+			uint32_t shadowTexture;
+			uint32_t staticShadowTexture;
+
+			/**
+			 * Number of layers the shadow textures hold and the resolution they were allocated at.
+			 */
+			uint32_t shadowLayers;
+			uint32_t shadowTextureResolution;
+
+			/**
+			 * Frame buffers the shadow layers are drawn into and copied from.
+			 */
+			uint32_t shadowFrameBuffer;
+			uint32_t shadowCacheFrameBuffer;
+
 			/**
-			 * This is the secondary texture.
+			 * Matrix each static layer was drawn with, and the scene and static revision it showed.
 			 */
-			uint32_t secondaryTex;
+			std::vector< Matrix44 > staticShadowMatrices;
+			Scene* staticShadowScene;
+			uint32_t staticShadowRevision;
 
 			/**
-			 * This is the primary bloom texture.
+			 * Number of shadow caster draws and of static layers redrawn during the last render.
 			 */
-			uint32_t primaryBloomTex;
+			uint32_t shadowDraws;
+			uint32_t staticShadowUpdates;
 
 			/**
-			 * This is the secondary bloom texture.
+			 * Passes of a render and the textures above, which are taken from the context's
+			 * texture pool while the passes using them run and are 0 otherwise.
 			 */
-			uint32_t secondaryBloomTex;
+			RenderGraph graph;
+
+			/**
+			 * Camera and light values of the render in progress.
+			 */
+			FrameConstants frameConstants;
+
+			/**
+			 * Area of the destination the render in progress is written to and the destination's height.
+			 */
+			Ovgl::Rect frameRect;
+			int frameTargetHeight;
+
+			/**
+			 * Size of the primary texture, kept so post processing needs no texture queries.
+			 */
+			int effectWidth;
+			int effectHeight;
+
+			/**
+			 * View projection of the previous frame, used by motion blur.
+			 */
+			Matrix44 previousViewProj;
+
+			/**
+			 * Number of full screen passes and estimated bytes of texture memory read and
+			 * written by post processing during the last render.
+			 */
+			uint32_t postPasses;
+			uint64_t postBandwidth;
 
 			/**
 			 * Pointer to window if this is a window based render target.
@@ -147,7 +856,7 @@ extern "C"
 			bool debugMode;
 
 			/**
-			 * Indicates if bloom is enabled.
+			 * Number of bloom pyramid levels, 0 disables bloom.
 			 */
 			int bloom;
 
@@ -156,6 +865,24 @@ extern "C"
 			 */
 			bool autoLuminance;
 
+			/**
+			 * Indicates if the scene luminance is read back through pixel buffers a few frames
+			 * late instead of waiting for the GPU every frame.
+			 */
+			bool asyncLuminance;
+
+			/**
+			 * Ring of pixel buffers the scene luminance is read back through, with the fence
+			 * signalling when each one has been filled.
+			 */
+			uint32_t luminanceBuffers[3];
+			void* luminanceFences[3];
+
+			/**
+			 * Number of luminance readbacks issued, selects the next buffer of the ring.
+			 */
+			uint32_t luminanceFrame;
+
 			/**
 			 * Indicates if multisampling is enabled.
 			 */
@@ -167,19 +894,147 @@ extern "C"
 			bool motionBlur;
 
 			/**
-			 * Render auto luminance effect.
+			 * Indicates if meshes outside the camera's view are skipped.
+			 */
+			bool frustumCulling;
+
+			/**
+			 * Number of meshes that were inside the camera's view during the last render.
+			 */
+			uint32_t visibleCount;
+
+			/**
+			 * Number of meshes that were skipped by frustum culling during the last render.
+			 */
+			uint32_t culledCount;
+
+			/**
+			 * Number of lights skipped during the last render because their influence did not
+			 * reach the camera's view.
+			 */
+			uint32_t culledLights;
+
+			/**
+			 * Number of draw calls issued during the last render.
+			 */
+			uint32_t drawCalls;
+
+			/**
+			 * Number of shader, material, mesh and depth state changes during the last render.
+			 */
+			uint32_t stateChanges;
+
+			/**
+			 * Draws of the scene waiting to be submitted.
+			 */
+			RenderQueue queue;
+
+			/**
+			 * Indicates if opaque surfaces are first drawn depth only, so the lit pass shades
+			 * each pixel once with depth testing set to less or equal and depth writes off.
+			 */
+			bool depthPrepass;
+
+			/**
+			 * Number of draws of the depth pre-pass during the last render.
+			 */
+			uint32_t prepassDraws;
+
+			/**
+			 * Samples passed and GPU time in milliseconds of the lit pass, read back from queries
+			 * a frame or more late.
+			 */
+			uint32_t litQueries[2];
+			uint64_t litSamples;
+			double litMilliseconds;
+
+			/**
+			 * Indicates if opaque draws of the same mesh subset and material are merged into
+			 * instanced draws when their shader has an instanced variant.
+			 */
+			bool instancing;
+
+			/**
+			 * Buffer holding the bone palettes of instanced draws and the texture buffer view the
+			 * instanced shaders read it through.
+			 */
+			uint32_t instanceBuffer;
+			uint32_t instanceTexture;
+
+			/**
+			 * Largest number of matrices the instance buffer can hold on this device.
+			 */
+			uint32_t instanceCapacity;
+
+			/**
+			 * Lights of the render in progress listed by the cells of the view they reach.
+			 */
+			LightClusters clusters;
+
+			/**
+			 * Buffer and vertex array object of the triangle full screen passes are drawn with.
+			 */
+			uint32_t fullScreenBuffer;
+			uint32_t fullScreenArray;
+
+			/**
+			 * GL context the full screen vertex array object was built in, vertex array objects are not shared.
+			 */
+			void* fullScreenContext;
+
+			/**
+			 * CPU time in milliseconds spent submitting each pass of the render graph during the
+			 * last render, by pass name.
+			 */
+			std::map< std::string, double > passTimes;
+
+			/**
+			 * Places the shadow maps of the lights, draws them and adds their layers to the
+			 * frame constants.
+			 * @param bounds World bounds of the objects, props and actors with meshes, in that order.
+			 */
+			void renderShadows( const std::vector< AABB >& bounds );
+
+			/**
+			 * Draws the objects, or the props and actors, inside a shadow map layer's view.
+			 * @param viewProj World to clip matrix of the layer.
+			 * @param bounds World bounds of the objects, props and actors with meshes, in that order.
+			 * @param statics Indicates if the static objects or the moving props and actors are drawn.
+			 */
+			void renderShadowCasters( const Matrix44& viewProj, const std::vector< AABB >& bounds, bool statics );
+
+			/**
+			 * Draws the sky box and the scene into the multisampled textures.
+			 */
+			void renderScene();
+
+			/**
+			 * Resolves the multisampled textures into the primary and depth textures.
+			 */
+			void resolveScene();
+
+			/**
+			 * Draws a triangle covering the viewport with every pass of a shader.
+			 * @param shader Effect whose passes are drawn, it must use the full screen vertex program.
+			 */
+			void renderFullScreen( Shader* shader );
+
+			/**
+			 * Measures the scene luminance and adapts the eye luminance to it, the exposure is
+			 * applied by the composite.
 			 */
 			void renderAutoLuminance();
 
 			/**
-			 * Render auto luminance effect.
+			 * Builds the bloom pyramid from the bright parts of the scene.
 			 */
 			void renderBloom();
 
 			/**
-			 * Render auto luminance effect.
+			 * Writes the scene to its destination with exposure, bloom and motion blur applied
+			 * in a single pass, to the area given by frameRect.
 			 */
-			void renderMotionBlur( );
+			void renderComposite();
 
 			/**
 			 * Render debug marker.
@@ -192,14 +1047,40 @@ extern "C"
 			void render();
 
 			/**
-			 * Update dimensions of render target.
+			 * Gathers the camera and light values for the next render.
+			 */
+			FrameConstants getFrameConstants();
+
+			/**
+			 * Update dimensions of render target. Textures are sized when rendering, so there
+			 * is nothing left to do here.
 			 */
 			void update();
 
 			/**
-			 * Render a single mesh.
+			 * Adds every subset of a mesh to the render queue.
+			 * @param frame Camera and light values of the frame.
+			 * @param mesh The mesh to draw.
+			 * @param matrix World matrix of the mesh.
+			 * @param pose Bone palette, it must stay valid until the queue is rendered.
+			 * @param boneCount Number of matrices in the palette.
+			 * @param materials Material of each subset.
+			 */
+			void queueMesh( const FrameConstants& frame, const Ovgl::Mesh& mesh, const Matrix44& matrix, const Matrix44* pose, uint32_t boneCount, std::vector< Material* >& materials );
+
+			/**
+			 * Draws the depth of the opaque surfaces in the sorted render queue with the shadow
+			 * caster effect, leaving the color untouched.
+			 * @param frame Camera and light values of the frame.
+			 * @return True if the depth was drawn, false if there is no effect to draw it with.
+			 */
+			bool renderDepthPrepass( const FrameConstants& frame );
+
+			/**
+			 * Sorts the render queue and draws it, skipping binds that would not change anything.
+			 * @param frame Camera and light values of the frame.
 			 */
-			void renderMesh( const Ovgl::Mesh& mesh, const Matrix44& matrix, std::vector< Matrix44 >& pose, std::vector< Material* >& materials, bool PostRender );
+			void renderQueue( const FrameConstants& frame );
 
 			void doEvent(Event event);
 			void (*onKeyDown)(char);
@@ -18,6 +18,17 @@
 
 #include "OvglCommon.h"
 
+// The small vector primitives are defined at the bottom of this header so they inline into
+// callers. They are inline in every translation unit, the library included. OvglMath.cpp takes
+// their addresses so libOvgl still exports an out-of-line copy for programs built against the
+// older header.
+#define OVGL_INLINE inline
+#if __cplusplus >= 201103L || ( defined( _MSC_VER ) && _MSC_VER >= 1900 )
+#  define OVGL_CONSTEXPR constexpr
+#else
+#  define OVGL_CONSTEXPR
+#endif
+
 namespace Ovgl
 {
 // Define pi
@@ -29,18 +40,22 @@ class Matrix44;
 class Vector2;
 class Vector3;
 class Vector4;
+class AABB;
+class BoundingSphere;
+class Plane;
+class Frustum;
 
 // A two dimensional vector using floating points.
 class DLLEXPORT Vector2
 {
 	public:
 		float x, y;
-		Vector2();
-		Vector2( float newX, float newY );
-		Vector2 operator - ( const Vector2& ) const;
-		Vector2 operator / ( const float& ) const;
-		bool operator == ( const Vector2& ) const;
-		bool operator != ( const Vector2& ) const;
+		OVGL_CONSTEXPR Vector2();
+		OVGL_CONSTEXPR Vector2( float newX, float newY );
+		OVGL_CONSTEXPR Vector2 operator - ( const Vector2& ) const;
+		OVGL_CONSTEXPR Vector2 operator / ( const float& ) const;
+		OVGL_CONSTEXPR bool operator == ( const Vector2& ) const;
+		OVGL_CONSTEXPR bool operator != ( const Vector2& ) const;
 		float& operator[]( size_t index );
 };
 
@@ -49,17 +64,17 @@ class DLLEXPORT Vector3
 {
 	public:
 		float x, y, z;
-		Vector3();
-		Vector3( float newX, float newY, float newZ );
+		OVGL_CONSTEXPR Vector3();
+		OVGL_CONSTEXPR Vector3( float newX, float newY, float newZ );
 		float& operator[]( size_t index );
-		Vector3 operator - ( const Vector3& ) const;
-		Vector3 operator + ( const Vector3& ) const;
-		Vector3 operator / ( const Vector3& ) const;
-		Vector3 operator * ( const Vector3& ) const;
-		Vector3 operator / ( const float& ) const;
-		Vector3 operator * ( const float& ) const;
-		bool operator == ( const Vector3& ) const;
-		bool operator != ( const Vector3& ) const;
+		OVGL_CONSTEXPR Vector3 operator - ( const Vector3& ) const;
+		OVGL_CONSTEXPR Vector3 operator + ( const Vector3& ) const;
+		OVGL_CONSTEXPR Vector3 operator / ( const Vector3& ) const;
+		OVGL_CONSTEXPR Vector3 operator * ( const Vector3& ) const;
+		OVGL_CONSTEXPR Vector3 operator / ( const float& ) const;
+		OVGL_CONSTEXPR Vector3 operator * ( const float& ) const;
+		OVGL_CONSTEXPR bool operator == ( const Vector3& ) const;
+		OVGL_CONSTEXPR bool operator != ( const Vector3& ) const;
 		void toDoubles( double* data );
 		void fromDoubles( double* data );
 };
@@ -69,15 +84,15 @@ class DLLEXPORT Vector4
 {
 	public:
 		float x, y, z, w;
-		Vector4();
-		Vector4( float newX, float newY, float newZ, float newW );
+		OVGL_CONSTEXPR Vector4();
+		OVGL_CONSTEXPR Vector4( float newX, float newY, float newZ, float newW );
 		float& operator[]( size_t index );
-		Vector4 operator - ( const Vector4& ) const;
-		Vector4 operator + ( const Vector4& ) const;
-		Vector4 operator / ( const Vector4& ) const;
-		Vector4 operator * ( const Vector4& ) const;
-		Vector4 operator / ( const float& ) const;
-		Vector4 operator * ( const float& ) const;
+		OVGL_CONSTEXPR Vector4 operator - ( const Vector4& ) const;
+		OVGL_CONSTEXPR Vector4 operator + ( const Vector4& ) const;
+		OVGL_CONSTEXPR Vector4 operator / ( const Vector4& ) const;
+		OVGL_CONSTEXPR Vector4 operator * ( const Vector4& ) const;
+		OVGL_CONSTEXPR Vector4 operator / ( const float& ) const;
+		OVGL_CONSTEXPR Vector4 operator * ( const float& ) const;
 		void toDoubles( double* data );
 		void fromDoubles( double* data );
 };
@@ -89,7 +104,7 @@ class DLLEXPORT Matrix33
 		float _11, _12, _13;
 		float _21, _22, _23;
 		float _31, _32, _33;
-		Matrix33();
+		OVGL_CONSTEXPR Matrix33();
 		Vector3& operator[]( size_t index ) const;
 		Matrix33 operator * ( const Matrix33& ) const;
 		Matrix44 to4x4();
@@ -105,7 +120,7 @@ class DLLEXPORT Matrix44
 		float _21, _22, _23, _24;
 		float _31, _32, _33, _34;
 		float _41, _42, _43, _44;
-		Matrix44();
+		OVGL_CONSTEXPR Matrix44();
 		Vector4& operator[](size_t index) const;
 		Matrix44 operator * ( const Matrix44& ) const;
 		Matrix33 to3x3();
@@ -115,6 +130,66 @@ class DLLEXPORT Matrix44
 		void fromDoubles( double* data );
 };
 
+// A rotation, translation and scale kept apart instead of multiplied into a matrix.
+// Applies scale first, then rotation, then translation, the same order as a matrix
+// built by matrixTransform. Composition is exact as long as parent scales are uniform.
+class DLLEXPORT Transform
+{
+	public:
+		Vector4 rotation;
+		Vector3 translation;
+		Vector3 scale;
+		Transform();
+		Transform( const Vector4& newRotation, const Vector3& newTranslation, const Vector3& newScale );
+		Transform operator * ( const Transform& ) const;
+};
+
+// An axis aligned bounding box given by its smallest and largest corners.
+class DLLEXPORT AABB
+{
+	public:
+		Vector3 min, max;
+		AABB();
+		AABB( const Vector3& newMin, const Vector3& newMax );
+		Vector3 center() const;
+		Vector3 extents() const;
+};
+
+// A sphere given by its center and radius.
+class DLLEXPORT BoundingSphere
+{
+	public:
+		Vector3 center;
+		float radius;
+		BoundingSphere();
+		BoundingSphere( const Vector3& newCenter, float newRadius );
+};
+
+// A plane holding every point p where vector3Dot( normal, p ) + d is zero, points on the
+// side the normal faces give positive distances.
+class DLLEXPORT Plane
+{
+	public:
+		Vector3 normal;
+		float d;
+		Plane();
+		Plane( const Vector3& newNormal, float newD );
+};
+
+// The six planes bounding a view volume, ordered left, right, bottom, top, near and far.
+// Every normal faces into the volume.
+class DLLEXPORT Frustum
+{
+	public:
+		Plane planes[6];
+};
+
+/**
+ * Returns the name of the instruction set the math kernels were compiled for
+ * ( "AVX", "SSE", "NEON" or "Scalar" ).
+ */
+DLLEXPORT const char* mathInstructionSet();
+
 /**
  * Creates a default 4x4 identity matrix.
  */
@@ -133,12 +208,30 @@ DLLEXPORT Matrix44 matrixSwapYZ( const Matrix44& inMat );
 DLLEXPORT Matrix44 matrixSwapXZ( const Matrix44& inMat );
 
 /**
- * Inverses a matrix.
+ * Inverses a matrix. On SSE builds the inverse is computed from 2x2 blocks instead of
+ * full cofactors, results match the scalar path to within about 1e-5 relative error for
+ * well conditioned matrices. A singular matrix gives back the identity on every path.
  * @param inVec
  * @param inMat
  */
 DLLEXPORT Matrix44 matrixInverse( const Vector4& inVec, const Matrix44& inMat );
 
+/**
+ * Inverses a rigid matrix, one made only of a rotation and a translation such as a camera
+ * or physics body pose. The rotation is transposed and the translation negated, the result
+ * is undefined for matrices with scaling, shearing or projection.
+ * @param inMat Rigid matrix to inverse.
+ */
+DLLEXPORT Matrix44 matrixInverseRigid( const Matrix44& inMat );
+
+/**
+ * Inverses an affine matrix, one whose last column is ( 0, 0, 0, 1 ). Handles scaling and
+ * shearing with a 3x3 inverse instead of the full 4x4 one. A singular matrix gives back
+ * the identity.
+ * @param inMat Affine matrix to inverse.
+ */
+DLLEXPORT Matrix44 matrixInverseAffine( const Matrix44& inMat );
+
 /**
  * Creates a 4x4 matrix scaled to the given parameters.
  * @param x Scale of X axis.
@@ -209,6 +302,80 @@ DLLEXPORT Matrix44 matrixRotationQuaternion( const Vector4& q);
  */
 DLLEXPORT Matrix44 matrixPerspectiveLH( float fov, float aspect, float zn, float zf);
 
+/**
+ * Create a 4x4 left handed orthographic matrix for the given view volume.
+ * @param l Left edge of the volume.
+ * @param r Right edge of the volume.
+ * @param b Bottom edge of the volume.
+ * @param t Top edge of the volume.
+ * @param zn Nearest an object can be viewed.
+ * @param zf Farthest an object can be viewed.
+ */
+DLLEXPORT Matrix44 matrixOrthoOffCenterLH( float l, float r, float b, float t, float zn, float zf );
+
+/**
+ * Creates a 4x4 matrix from a rotation, translation and scale.
+ * @param transform Transform to convert to a matrix.
+ */
+DLLEXPORT Matrix44 matrixTransform( const Transform& transform );
+
+/**
+ * Splits a matrix into rotation, translation and scale. Shearing cannot be represented
+ * and is lost.
+ * @param matrix Matrix to split.
+ */
+DLLEXPORT Transform transformMatrix( const Matrix44& matrix );
+
+/**
+ * Inverses a transform. Exact for uniform scale.
+ * @param transform Transform to inverse.
+ */
+DLLEXPORT Transform transformInverse( const Transform& transform );
+
+/**
+ * Interpolates two transforms, the rotations are normalized linearly.
+ * @param t1 Starting transform.
+ * @param t2 Ending transform.
+ * @param u How much to interpolate it from 0 - 1.
+ */
+DLLEXPORT Transform transformNlerp( const Transform& t1, const Transform& t2, float u );
+
+/**
+ * Interpolates two transforms, the rotations are interpolated spherically.
+ * @param t1 Starting transform.
+ * @param t2 Ending transform.
+ * @param u How much to interpolate it from 0 - 1.
+ */
+DLLEXPORT Transform transformSlerp( const Transform& t1, const Transform& t2, float u );
+
+/**
+ * Combines two rotations so that the result rotates by q1 and then by q2, matching
+ * matrixRotationQuaternion( q1 ) * matrixRotationQuaternion( q2 ).
+ * @param q1 First rotation.
+ * @param q2 Second rotation.
+ */
+DLLEXPORT Vector4 quaternionMultiply( const Vector4& q1, const Vector4& q2 );
+
+/**
+ * Gives the opposite rotation of a unit quaternion.
+ * @param q Quaternion to inverse.
+ */
+DLLEXPORT Vector4 quaternionConjugate( const Vector4& q );
+
+/**
+ * Scales a quaternion to unit length.
+ * @param q Quaternion to normalize.
+ */
+DLLEXPORT Vector4 quaternionNormalize( const Vector4& q );
+
+/**
+ * Normalized linear interpolation between two quaternions along the shortest arc.
+ * @param q1 Starting quaternion.
+ * @param q2 Ending quaternion.
+ * @param t How much to interpolate it form 0 - 1.
+ */
+DLLEXPORT Vector4 nlerp( const Vector4& q1, const Vector4& q2, float t );
+
 /**
  * Creates a quaternion based on the rotation of the given matrix.
  * @param matrix Matrix to get quaternion from.
@@ -242,7 +409,7 @@ DLLEXPORT Vector3 eulerRotationMatrix( const Matrix44& matrix );
  * @param vec2 Ending vector.
  * @param u How much to interpolate it form 0 - 1.
  */
-DLLEXPORT Vector4 vector4Lerp( const Vector4& vec1, const Vector4& vec2, float u);
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR Vector4 vector4Lerp( const Vector4& vec1, const Vector4& vec2, float u);
 
 /**
  * Spherical linear interpolation between the two vectors.
@@ -257,20 +424,119 @@ DLLEXPORT Vector4 slerp( const Vector4& q1, const Vector4& q2, float t );
  * @param vec1 First vector.
  * @param vec2 Second vector.
  */
-DLLEXPORT Vector3 vector3Cross( const Vector3& vec1, const Vector3& vec2 );
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR Vector3 vector3Cross( const Vector3& vec1, const Vector3& vec2 );
 
 /**
  * Transforms the three dimensional vector based on the given matrix.
  * @param vector Vector to transform.
  * @param matrix Matrix to apply to vector.
  */
-DLLEXPORT Vector3 vector3Transform( const Vector3& vector, const Matrix44& matrix );
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR Vector3 vector3Transform( const Vector3& vector, const Matrix44& matrix );
+
+/**
+ * Transforms a span of points by one matrix. Strides are in bytes so the points may sit
+ * inside larger structures such as vertices, pass sizeof( Vector3 ) for a packed array.
+ * The input and output may be the same span.
+ * @param matrix Matrix to apply to every point.
+ * @param in First point to read.
+ * @param inStride Bytes between two input points.
+ * @param out First point to write.
+ * @param outStride Bytes between two output points.
+ * @param count Number of points.
+ */
+DLLEXPORT void vector3TransformArray( const Matrix44& matrix, const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count );
+
+/**
+ * Transforms a span of directions such as normals by the rotation and scale of a matrix,
+ * ignoring its translation. Strides are in bytes, the input and output may be the same span.
+ * @param matrix Matrix to apply to every direction.
+ * @param in First direction to read.
+ * @param inStride Bytes between two input directions.
+ * @param out First direction to write.
+ * @param outStride Bytes between two output directions.
+ * @param count Number of directions.
+ */
+DLLEXPORT void vector3TransformNormalArray( const Matrix44& matrix, const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count );
+
+/**
+ * Transforms points or directions stored as separate x, y and z streams. The streams may
+ * be transformed in place.
+ * @param matrix Matrix to apply.
+ * @param inX Input x components.
+ * @param inY Input y components.
+ * @param inZ Input z components.
+ * @param outX Output x components.
+ * @param outY Output y components.
+ * @param outZ Output z components.
+ * @param count Number of vectors.
+ * @param normals True to ignore the translation of the matrix.
+ */
+DLLEXPORT void vector3TransformStreams( const Matrix44& matrix, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, size_t count, bool normals );
+
+/**
+ * Normalizes a span of three dimensional vectors. Strides are in bytes, zero length
+ * vectors are copied through unchanged.
+ * @param in First vector to read.
+ * @param inStride Bytes between two input vectors.
+ * @param out First vector to write.
+ * @param outStride Bytes between two output vectors.
+ * @param count Number of vectors.
+ */
+DLLEXPORT void vector3NormalizeArray( const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count );
+
+/**
+ * Normalizes vectors stored as separate x, y and z streams in place. Zero length vectors
+ * are left unchanged.
+ * @param x The x components.
+ * @param y The y components.
+ * @param z The z components.
+ * @param count Number of vectors.
+ */
+DLLEXPORT void vector3NormalizeStreams( float* x, float* y, float* z, size_t count );
+
+/**
+ * Gets the dot products of two spans of three dimensional vectors. Strides are in bytes.
+ * @param vec1 First vector of the first span.
+ * @param stride1 Bytes between two vectors of the first span.
+ * @param vec2 First vector of the second span.
+ * @param stride2 Bytes between two vectors of the second span.
+ * @param out Receives one dot product per vector pair.
+ * @param count Number of vector pairs.
+ */
+DLLEXPORT void vector3DotArray( const Vector3* vec1, size_t stride1, const Vector3* vec2, size_t stride2, float* out, size_t count );
+
+/**
+ * Gets the dot products of two sets of vectors stored as separate x, y and z streams.
+ * @param x1 The x components of the first set.
+ * @param y1 The y components of the first set.
+ * @param z1 The z components of the first set.
+ * @param x2 The x components of the second set.
+ * @param y2 The y components of the second set.
+ * @param z2 The z components of the second set.
+ * @param out Receives one dot product per vector pair.
+ * @param count Number of vector pairs.
+ */
+DLLEXPORT void vector3DotStreams( const float* x1, const float* y1, const float* z1, const float* x2, const float* y2, const float* z2, float* out, size_t count );
+
+/**
+ * Transforms the three dimensional vector by a rotation, translation and scale.
+ * @param vector Vector to transform.
+ * @param transform Transform to apply to vector.
+ */
+DLLEXPORT Vector3 vector3Transform( const Vector3& vector, const Transform& transform );
+
+/**
+ * Rotates the three dimensional vector by a quaternion.
+ * @param vector Vector to rotate.
+ * @param q Unit quaternion.
+ */
+DLLEXPORT Vector3 vector3Rotate( const Vector3& vector, const Vector4& q );
 
 /**
  * Normalizes the three dimensional vector.
  * @param vector Vector to normalize.
  */
-DLLEXPORT Vector3 vector3Normalize( const Vector3& vector );
+DLLEXPORT OVGL_INLINE Vector3 vector3Normalize( const Vector3& vector );
 
 /**
  * Finds the center point of a list of vertices.
@@ -298,21 +564,21 @@ DLLEXPORT float bound( float expression, int32_t decimalPlaces );
  * Gets the length of a three dimensional vector.
  * @param vector The vector.
  */
-DLLEXPORT float length( const Vector3& vector );
+DLLEXPORT OVGL_INLINE float length( const Vector3& vector );
 
 /**
  * Finds the distance between two three dimensional vectors.
  * @param vec1 The first vector.
  * @param vec2 The second vector.
  */
-DLLEXPORT float distance( const Vector3& vector1, const Vector3& vector2);
+DLLEXPORT OVGL_INLINE float distance( const Vector3& vector1, const Vector3& vector2);
 
 /**
  * Gets the dot product of two three dimensional vectors.
  * @param vec1 The first vector.
  * @param vec2 The second vector.
  */
-DLLEXPORT float vector3Dot( const Vector3& vec1, const Vector3& vec2 );
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR float vector3Dot( const Vector3& vec1, const Vector3& vec2 );
 
 /**
  * Linear interpolation between two floats.
@@ -320,13 +586,13 @@ DLLEXPORT float vector3Dot( const Vector3& vec1, const Vector3& vec2 );
  * @param val2 The ending value.
  * @param u The level of interpolation from 0.0 to 1.0.
  */
-DLLEXPORT float lerp( float val1, float val2, float u);
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR float lerp( float val1, float val2, float u);
 
 /**
  * Converts degrees to radians.
  * @param degree A float containing the number of degrees to convert.
  */
-DLLEXPORT float degToRad( float degree);
+DLLEXPORT OVGL_INLINE OVGL_CONSTEXPR float degToRad( float degree);
 
 /**
  * Creates a bounding box based on a list of three dimensional vectors.
@@ -335,4 +601,293 @@ DLLEXPORT float degToRad( float degree);
  * @param out_min Pointer to a three dimensional vector to return the maximum bounds of the box.
  */
 DLLEXPORT void vector3Box( std::vector< Vector3 >& vectors, Vector3& outMin, Vector3& outMax );
+
+/**
+ * Creates the smallest bounding box holding a span of points. Strides are in bytes so the
+ * points may sit inside larger structures such as vertices. No points give an empty box at
+ * the origin.
+ * @param points First point to read.
+ * @param stride Bytes between two points.
+ * @param count Number of points.
+ */
+DLLEXPORT AABB aabbPoints( const Vector3* points, size_t stride, size_t count );
+
+/**
+ * Creates the smallest bounding box holding two boxes.
+ * @param box1 The first box.
+ * @param box2 The second box.
+ */
+DLLEXPORT AABB aabbMerge( const AABB& box1, const AABB& box2 );
+
+/**
+ * Creates the smallest axis aligned box holding a box moved by a matrix. The matrix must
+ * not hold a projection.
+ * @param box Box to transform.
+ * @param matrix Matrix to apply to the box.
+ */
+DLLEXPORT AABB aabbTransform( const AABB& box, const Matrix44& matrix );
+
+/**
+ * Creates a sphere around a bounding box.
+ * @param box Box to enclose.
+ */
+DLLEXPORT BoundingSphere boundingSphereAABB( const AABB& box );
+
+/**
+ * Gets the signed distance from a plane to a point.
+ * @param plane The plane.
+ * @param point The point.
+ */
+DLLEXPORT float planeDistance( const Plane& plane, const Vector3& point );
+
+/**
+ * Extracts the view frustum of a view projection matrix such as one built with
+ * matrixPerspectiveLH. Passing only a projection matrix gives the frustum in view space,
+ * a world to clip matrix gives it in world space.
+ * @param matrix View projection matrix with depth mapped from 0 to 1.
+ */
+DLLEXPORT Frustum frustumMatrix( const Matrix44& matrix );
+
+/**
+ * Tests if a bounding box is at least partly inside a frustum. Boxes close to a frustum
+ * corner may pass while being outside, they are never rejected while inside.
+ * @param frustum The frustum.
+ * @param box The box to test.
+ */
+DLLEXPORT bool frustumIntersectsAABB( const Frustum& frustum, const AABB& box );
+
+/**
+ * Tests if a sphere is at least partly inside a frustum. Like frustumIntersectsAABB the
+ * test is conservative near the corners.
+ * @param frustum The frustum.
+ * @param sphere The sphere to test.
+ */
+DLLEXPORT bool frustumIntersectsSphere( const Frustum& frustum, const BoundingSphere& sphere );
+
+/**
+ * Tests a span of bounding boxes against a frustum, four boxes at a time on SSE builds and
+ * eight on AVX builds. Strides are in bytes so the boxes may sit inside larger structures.
+ * Gives the same answers as frustumIntersectsAABB.
+ * @param frustum The frustum.
+ * @param boxes First box to test.
+ * @param stride Bytes between two boxes.
+ * @param out Receives true for every box that is at least partly inside.
+ * @param count Number of boxes.
+ * @return Number of boxes at least partly inside.
+ */
+DLLEXPORT size_t frustumIntersectsAABBArray( const Frustum& frustum, const AABB* boxes, size_t stride, bool* out, size_t count );
+
+/**
+ * Tests a span of spheres against a frustum, four spheres at a time on SSE builds and eight
+ * on AVX builds. Strides are in bytes. Gives the same answers as frustumIntersectsSphere.
+ * @param frustum The frustum.
+ * @param spheres First sphere to test.
+ * @param stride Bytes between two spheres.
+ * @param out Receives true for every sphere that is at least partly inside.
+ * @param count Number of spheres.
+ * @return Number of spheres at least partly inside.
+ */
+DLLEXPORT size_t frustumIntersectsSphereArray( const Frustum& frustum, const BoundingSphere* spheres, size_t stride, bool* out, size_t count );
+
+OVGL_INLINE OVGL_CONSTEXPR Vector2::Vector2() : x( 0.0f ), y( 0.0f )
+{
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector2::Vector2( float newX, float newY ) : x( newX ), y( newY )
+{
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector2 Vector2::operator - ( const Vector2& in ) const
+{
+	return Vector2( x - in.x, y - in.y );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector2 Vector2::operator / ( const float& in ) const
+{
+	return Vector2( x / in, y / in );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR bool Vector2::operator == ( const Vector2& in ) const
+{
+	return x == in.x && y == in.y;
+}
+
+OVGL_INLINE OVGL_CONSTEXPR bool Vector2::operator != ( const Vector2& in ) const
+{
+	return x != in.x || y != in.y;
+}
+
+OVGL_INLINE float& Vector2::operator [] ( size_t index )
+{
+	return (&x)[index];
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3::Vector3() : x( 0.0f ), y( 0.0f ), z( 0.0f )
+{
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3::Vector3( float newX, float newY, float newZ ) : x( newX ), y( newY ), z( newZ )
+{
+}
+
+OVGL_INLINE float& Vector3::operator [] ( size_t index )
+{
+	return (&x)[index];
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator - ( const Vector3& in ) const
+{
+	return Vector3( x - in.x, y - in.y, z - in.z );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator + ( const Vector3& in ) const
+{
+	return Vector3( x + in.x, y + in.y, z + in.z );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator / ( const Vector3& in ) const
+{
+	return Vector3( x / in.x, y / in.y, z / in.z );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator * ( const Vector3& in ) const
+{
+	return Vector3( x * in.x, y * in.y, z * in.z );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator / ( const float& in ) const
+{
+	return Vector3( x / in, y / in, z / in );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 Vector3::operator * ( const float& in ) const
+{
+	return Vector3( x * in, y * in, z * in );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR bool Vector3::operator == ( const Vector3& in ) const
+{
+	return x == in.x && y == in.y && z == in.z;
+}
+
+OVGL_INLINE OVGL_CONSTEXPR bool Vector3::operator != ( const Vector3& in ) const
+{
+	return x != in.x || y != in.y || z != in.z;
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4::Vector4() : x( 0.0f ), y( 0.0f ), z( 0.0f ), w( 0.0f )
+{
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4::Vector4( float newX, float newY, float newZ, float newW ) : x( newX ), y( newY ), z( newZ ), w( newW )
+{
+}
+
+OVGL_INLINE float& Vector4::operator [] ( size_t index )
+{
+	return (&x)[index];
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator - ( const Vector4& in ) const
+{
+	return Vector4( x - in.x, y - in.y, z - in.z, w - in.w );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator + ( const Vector4& in ) const
+{
+	return Vector4( x + in.x, y + in.y, z + in.z, w + in.w );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator / ( const Vector4& in ) const
+{
+	return Vector4( x / in.x, y / in.y, z / in.z, w / in.w );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator * ( const Vector4& in ) const
+{
+	return Vector4( x * in.x, y * in.y, z * in.z, w * in.w );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator / ( const float& in ) const
+{
+	return Vector4( x / in, y / in, z / in, w / in );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 Vector4::operator * ( const float& in ) const
+{
+	return Vector4( x * in, y * in, z * in, w * in );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Matrix33::Matrix33() :
+	_11( 1.0f ), _12( 0.0f ), _13( 0.0f ),
+	_21( 0.0f ), _22( 1.0f ), _23( 0.0f ),
+	_31( 0.0f ), _32( 0.0f ), _33( 1.0f )
+{
+}
+
+OVGL_INLINE Vector3& Matrix33::operator [] ( size_t index ) const
+{
+	return (Vector3&)*((Vector3*)((&_11) + (index * 3)));
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Matrix44::Matrix44() :
+	_11( 1.0f ), _12( 0.0f ), _13( 0.0f ), _14( 0.0f ),
+	_21( 0.0f ), _22( 1.0f ), _23( 0.0f ), _24( 0.0f ),
+	_31( 0.0f ), _32( 0.0f ), _33( 1.0f ), _34( 0.0f ),
+	_41( 0.0f ), _42( 0.0f ), _43( 0.0f ), _44( 1.0f )
+{
+}
+
+OVGL_INLINE Vector4& Matrix44::operator [] ( size_t index ) const
+{
+	return (Vector4&)*((Vector4*)((&_11) + (index * 4)));
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector4 vector4Lerp( const Vector4& vec1, const Vector4& vec2, float u )
+{
+	return ( vec1 * ( 1 - u ) ) + ( vec2 * u );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 vector3Cross( const Vector3& vec1, const Vector3& vec2 )
+{
+	return Vector3( vec1.y * vec2.z - vec2.y * vec1.z, vec1.z * vec2.x - vec2.z * vec1.x, vec1.x * vec2.y - vec2.x * vec1.y );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR Vector3 vector3Transform( const Vector3& vector, const Matrix44& matrix )
+{
+	return Vector3( vector.x * matrix._11 + vector.y * matrix._21 + vector.z * matrix._31 + matrix._41,
+	                vector.x * matrix._12 + vector.y * matrix._22 + vector.z * matrix._32 + matrix._42,
+	                vector.x * matrix._13 + vector.y * matrix._23 + vector.z * matrix._33 + matrix._43 );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR float vector3Dot( const Vector3& vec1, const Vector3& vec2 )
+{
+	return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
+}
+
+OVGL_INLINE float length( const Vector3& vector )
+{
+	return sqrt( ( vector.x * vector.x ) + ( vector.y * vector.y ) + ( vector.z * vector.z ) );
+}
+
+OVGL_INLINE float distance( const Vector3& vector1, const Vector3& vector2 )
+{
+	return length( vector1 - vector2 );
+}
+
+OVGL_INLINE Vector3 vector3Normalize( const Vector3& vector )
+{
+	float l = length( vector );
+	return Vector3( vector.x / l, vector.y / l, vector.z / l );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR float lerp( float val1, float val2, float u )
+{
+	return ( val1 * ( 1 - u ) ) + ( val2 * u );
+}
+
+OVGL_INLINE OVGL_CONSTEXPR float degToRad( float degree )
+{
+	return degree * ( (float)OvglPi ) / 180.0f;
+}
 };
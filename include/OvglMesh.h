@@ -26,6 +26,13 @@ namespace Ovgl
 {
 enum Clean { CLEAN_ALL, CLEAN_STRAY_VERTICES, CLEAN_CLOSE_VERTICES, CLEAN_BROKEN_FACES };
 
+/**
+ * Flags of the packed attributes in a mesh's vertex streams. Normals are stored as signed
+ * normalized 10:10:10:2, texture coordinates as half floats, bone weights as normalized bytes
+ * and bone indices as bytes. Attributes without their flag are stored as floats.
+ */
+enum VertexFormat { VERTEX_PACKED_NORMALS = 1, VERTEX_HALF_TEXTURE = 2, VERTEX_PACKED_SKIN = 4 };
+
 class Vertex;
 class Face;
 class Bone;
@@ -88,10 +95,34 @@ extern "C"
 			std::vector< Face >                 faces;
 			std::vector< uint32_t >             attributes;
 			uint32_t                            subsetCount;
+
+			/**
+			 * Vertices are uploaded as separate streams so passes that only need positions
+			 * fetch nothing else. Positions, then normals and texture coordinates, then bone
+			 * weights and indices, which meshes moved by bone 0 alone leave out.
+			 */
+			uint32_t                            positionBuffer;
 			uint32_t                            vertexBuffer;
-			uint32_t*                           indexBuffers;
+			uint32_t                            skinBuffer;
+			bool                                skinned;
+
+			/**
+			 * Indicates if update packs the attributes that keep their precision packed, and
+			 * the VertexFormat flags it chose. Changes take effect on the next update, which
+			 * also builds the vertex array objects again for the new layout.
+			 */
+			bool                                packVertices;
+			uint32_t                            vertexFormat;
+			uint32_t                            indexBuffer;
+			std::vector< uint32_t >             indexCounts;
+			std::vector< uint32_t >             indexStarts;
+			mutable std::map< void*, uint32_t > vertexArrays;
+			mutable std::map< void*, uint32_t > depthArrays;
 			btBvhTriangleMeshShape*             triangleMesh;
 			Skeleton*                           skeleton;
+			Ovgl::AABB                          bounds;
+			Ovgl::BoundingSphere                boundingSphere;
+			std::vector< Ovgl::AABB >           boneBounds;
 			void generateVertexNormals();
 			void cubeCloud( float sx, float sy, float sz, int32_t count );
 			float quickHull();
@@ -100,6 +131,37 @@ extern "C"
 			void connectVertex( std::vector< uint32_t >& faceList, uint32_t vertex );
 			void mergeVerices( std::vector< uint32_t >& vertexList, uint32_t flag );
 			Ovgl::Vector3 computeFaceNormal( uint32_t face );
+			Ovgl::AABB skinnedBounds( const std::vector< Matrix44 >& pose ) const;
+
+			/**
+			 * Returns the vertex array object of this mesh for the current GL context, building
+			 * it on first use. Binding it sets up the vertex layout and every subset's indices.
+			 */
+			uint32_t getVertexArray() const;
+
+			/**
+			 * Returns the vertex array object of this mesh for the current GL context that only
+			 * reads the position and skinning streams, for passes that write depth alone.
+			 */
+			uint32_t getDepthVertexArray() const;
+
+			/**
+			 * Releases the vertex array objects of this mesh built in a GL context, or in every
+			 * context if it is NULL. They are built again on next use.
+			 * @param glContext The GL context or NULL.
+			 */
+			void releaseVertexArrays( void* glContext );
+
+			/**
+			 * Returns the bytes per vertex of the shading and skinning streams in the mesh's format.
+			 */
+			uint32_t getShadingStride() const;
+			uint32_t getSkinStride() const;
+
+			/**
+			 * Returns the size in bytes of the vertex streams as reported by GL.
+			 */
+			uint32_t getVertexMemory() const;
 			void update();
 	};
 }
@@ -20,6 +20,71 @@
 
 namespace Ovgl
 {
+enum ShaderParameter
+{
+	SHADER_WORLD,
+	SHADER_VIEW_PROJ,
+	SHADER_VIEW_POS,
+	SHADER_BONES,
+	SHADER_LIGHT_COUNT,
+	SHADER_LIGHTS,
+	SHADER_LIGHT_COLORS,
+	SHADER_PALETTES,
+	SHADER_INSTANCE_BASE,
+	SHADER_BONE_COUNT,
+	SHADER_SOURCE,
+	SHADER_SCENE,
+	SHADER_BLOOM,
+	SHADER_DEPTH,
+	SHADER_BRIGHTNESS,
+	SHADER_THRESHOLD,
+	SHADER_HALF_PIXEL,
+	SHADER_INVERSE_VIEW_PROJ,
+	SHADER_PREVIOUS_VIEW_PROJ,
+	SHADER_LIGHT_SHADOWS,
+	SHADER_SHADOW_MATRICES,
+	SHADER_SHADOW_MAP,
+	SHADER_SHADOW_TEXEL,
+	SHADER_LIGHT_SPOTS,
+	SHADER_VIEW,
+	SHADER_LIGHT_DATA,
+	SHADER_CLUSTER_TABLE,
+	SHADER_CLUSTER_LIGHTS,
+	SHADER_CLUSTER_GRID,
+	SHADER_CLUSTER_VIEW,
+	SHADER_MODEL,
+	SHADER_DIFFUSE,
+	SHADER_PARAMETER_COUNT
+};
+
+// Features a permutation of a shader is compiled with or without. A combination of these flags
+// indexes Ovgl::Shader::permutations.
+enum ShaderPermutation
+{
+	SHADER_INSTANCED = 1,
+	SHADER_STATIC = 2,
+	SHADER_UNTEXTURED = 4,
+	SHADER_PERMUTATION_COUNT = 8
+};
+
+// Slots of the shaders the context compiles into Ovgl::Context::defaultMedia.
+enum DefaultShader
+{
+	DEFAULT_SHADER_MESH,
+	DEFAULT_SHADER_SKYBOX,
+	DEFAULT_SHADER_MESH_INSTANCED,
+	DEFAULT_SHADER_BLOOM_DOWNSAMPLE,
+	DEFAULT_SHADER_BLOOM_UPSAMPLE,
+	// Four composites, offset by 1 with bloom and by 2 with motion blur.
+	DEFAULT_SHADER_COMPOSITE,
+	DEFAULT_SHADER_CASTER = DEFAULT_SHADER_COMPOSITE + 4,
+	// The mesh permutations with flags 2 to 7, in the order of their flags.
+	DEFAULT_SHADER_MESH_PERMUTATIONS,
+	// The caster permutations with flags 1 to 3, in the order of their flags.
+	DEFAULT_SHADER_CASTER_PERMUTATIONS = DEFAULT_SHADER_MESH_PERMUTATIONS + SHADER_PERMUTATION_COUNT - 2,
+	DEFAULT_SHADER_COUNT = DEFAULT_SHADER_CASTER_PERMUTATIONS + 3
+};
+
 extern "C"
 {
 	class Mesh;
@@ -28,6 +93,7 @@ extern "C"
 	class Mesh;
 	class Context;
 	class Shader;
+	class Material;
 	class Texture;
 	class ResourceManager;
 
@@ -66,8 +132,83 @@ extern "C"
 	class DLLEXPORT Shader
 	{
 		public:
+			Shader();
 			ResourceManager*                        mLibrary;
 			CGeffect                                effect;
+
+			/**
+			 * Variants of this shader compiled from the same source, indexed by a combination of
+			 * ShaderPermutation flags. Instanced variants draw many instances at once with bone
+			 * palettes read from a texture buffer, static variants draw meshes with a single bone
+			 * or without weights by their first bone without blending bones and untextured
+			 * variants skip the diffuse texture. Index 0 is the shader itself, combinations it was
+			 * not compiled with are NULL.
+			 */
+			Shader*                                 permutations[SHADER_PERMUTATION_COUNT];
+
+			/**
+			 * Maps parameters of the shader this one is a variant of to the parameters of the
+			 * same name in this shader, so materials made for the base shader can be applied.
+			 */
+			std::map< CGparameter, CGparameter >    sharedParameters;
+
+			/**
+			 * Handles of the parameters the engine sets, looked up once by resolveParameters.
+			 * Parameters the effect does not declare are NULL.
+			 */
+			CGparameter                             parameters[SHADER_PARAMETER_COUNT];
+
+			/**
+			 * Change stamp of the value last uploaded to each parameter.
+			 */
+			uint32_t                                stamps[SHADER_PARAMETER_COUNT];
+
+			/**
+			 * Number of matrices the Bones array holds.
+			 */
+			uint32_t                                boneCapacity;
+
+			/**
+			 * Number of lights the Lights, LightColors and, when declared, LightShadows and LightSpots arrays hold.
+			 */
+			uint32_t                                lightCapacity;
+
+			/**
+			 * Number of matrices the ShadowMatrices array holds.
+			 */
+			uint32_t                                shadowCapacity;
+
+			/**
+			 * Material whose variables were last uploaded to this shader and its revision at the time.
+			 */
+			Material*                               lastMaterial;
+			uint32_t                                lastMaterialRevision;
+
+			/**
+			 * Looks up the engine parameter handles of the effect. Must be called whenever the effect is created.
+			 */
+			void resolveParameters();
+
+			/**
+			 * Returns true if a parameter exists and was last uploaded with a different stamp, the
+			 * stamp is then recorded so the next call with the same stamp returns false.
+			 * @param parameter The parameter to check.
+			 * @param stamp Stamp identifying the value about to be uploaded.
+			 */
+			bool needsUpload( ShaderParameter parameter, uint32_t stamp );
+
+			/**
+			 * Fills sharedParameters from the shader this one is a variant of.
+			 * @param base The shader this one is a variant of.
+			 */
+			void resolveSharedParameters( Shader* base );
+
+			/**
+			 * Returns the parameter of this shader sharing a name with a parameter of its base
+			 * shader, or NULL if this shader does not declare it.
+			 * @param parameter Parameter of the base shader.
+			 */
+			CGparameter getSharedParameter( CGparameter parameter );
 			void release();
 	};
 
@@ -86,6 +227,7 @@ extern "C"
 			bool                                    noZWrite;
 			std::vector< std::pair< CGparameter, std::vector< float > > > variables;
 			std::vector< std::pair< CGparameter, Ovgl::Texture* > > textures;
+			uint32_t                                revision;
 			void setEffectVariable(const std::string& variable, const std::vector< float >& data);
 			void setEffectTexture(const std::string& variable, Texture* texture);
 			void release();
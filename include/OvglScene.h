@@ -51,6 +51,7 @@ extern "C"
 	class Shader;
 	class Joint;
 	class Vector3;
+	class AABB;
 	class AnimationInstance;
 
 	/**
@@ -154,19 +155,19 @@ extern "C"
 			uint32_t                                 type;
 
 			/**
-			 * This frame buffer is used to apply effects.
+			 * Full cone angle of a spot light in radians, spot lights shine along the z axis of their pose.
 			 */
-			uint32_t                                 shadowFrameBuffer;
+			float                                    angle;
 
 			/**
-			 * This texture stores depth information to perform shadowmapping
+			 * Distance at which point and spot lights have faded out completely, 0 for lights that reach everything.
 			 */
-			uint32_t                                 depthTexture;
+			float                                    radius;
 
 			/**
-			 * Render a single mesh's shadow.
+			 * Indicates if the light casts shadows.
 			 */
-			void renderShadow( const Ovgl::Mesh& mesh, const Matrix44& matrix, std::vector< Matrix44 >& pose, bool PostRender );
+			bool                                     castShadows;
 
 			/**
 			 * Sets the pose of this light.
@@ -260,6 +261,11 @@ extern "C"
 			 */
 			Matrix44 getPose();
 
+			/**
+			 * Returns the world space bounds of this prop's mesh as deformed by its bones.
+			 */
+			AABB getBounds();
+
 			/**
 			 * This function will release control of all memory associated with the prop and it will also remove any reference to it from the scene.
 			 */
@@ -305,6 +311,11 @@ extern "C"
 			 */
 			Matrix44 getPose();
 
+			/**
+			 * Returns the world space bounds of this object's mesh.
+			 */
+			AABB getBounds();
+
 			/**
 			 * This function will release control of all memory associated with the object and it will also remove any reference to it from the scene.
 			 */
@@ -450,6 +461,11 @@ extern "C"
 			 */
 			Matrix44 getPose();
 
+			/**
+			 * Returns the world space bounds of this actor's mesh as deformed by its current pose.
+			 */
+			AABB getBounds();
+
 			/**
 			 * Updates the pose based on the time specified. This function is then called on all child bones and
 			 * the traformational matrix is then passed down.
@@ -517,6 +533,12 @@ extern "C"
 			 */
 			std::vector< Object* >                 objects;
 
+			/**
+			 * Changes whenever an object is added, moved or removed, cached shadows of static
+			 * objects are redrawn when it does.
+			 */
+			uint32_t                               staticRevision;
+
 			/**
 			 * This array contains all lights within the scene.
 			 */
@@ -36,6 +36,7 @@ class Context;
 class Scene;
 class Matrix44;
 class Vector3;
+class Transform;
 
 extern "C"
 {
@@ -108,8 +109,8 @@ extern "C"
 			Joint*											parent;
 			std::vector< Joint* >							children;
 			Matrix44										offset;
-			Matrix44										localTransform;
-			Matrix44 										globalTransform;
+			Transform										localTransform;
+			Transform 										globalTransform;
 	};	
 
 	class DLLEXPORT Pose
@@ -51,6 +51,23 @@ extern "C"
 
 namespace Ovgl
 {
+// Vertex program shared by the full screen passes. It places the corners of a triangle that
+// covers the viewport and derives the texture coordinates from them.
+static const char* fullScreenProgram =
+	"struct FULLSCREEN_OUTPUT"
+	"{"
+	"  float4 pos               : POSITION;"
+	"  float2 tex               : TEXCOORD0;"
+	"};"
+
+	"FULLSCREEN_OUTPUT FullScreenVS( float2 pos : ATTR0 )"
+	"{"
+	"	FULLSCREEN_OUTPUT Out;"
+	"	Out.pos = float4( pos, -1.0, 1.0 );"
+	"	Out.tex = pos * 0.5 + 0.5;"
+	"	return Out;"
+	"}";
+
 void buildDefaultMedia( Context* context )
 {
 	SDL_GL_MakeCurrent(context->contextWindow, context->glContext);
@@ -58,19 +75,13 @@ void buildDefaultMedia( Context* context )
 
 	Shader* defaultEffect = new Shader;
 	Shader* skyboxEffect = new Shader;
-	Shader* blurEffect = new Shader;
-	Shader* bloomEffect = new Shader;
-	Shader* addEffect = new Shader;
-	Shader* brightnessEffect = new Shader;
-	Shader* motionBlurEffect = new Shader;
+	Shader* downsampleEffect = new Shader;
+	Shader* upsampleEffect = new Shader;
 
 	defaultEffect->mLibrary = context->defaultMedia;
 	skyboxEffect->mLibrary = context->defaultMedia;
-	blurEffect->mLibrary = context->defaultMedia;
-	bloomEffect->mLibrary = context->defaultMedia;
-	addEffect->mLibrary = context->defaultMedia;
-	brightnessEffect->mLibrary = context->defaultMedia;
-	motionBlurEffect->mLibrary = context->defaultMedia;
+	downsampleEffect->mLibrary = context->defaultMedia;
+	upsampleEffect->mLibrary = context->defaultMedia;
 
 	// Define debugging variables
 	CGerror error;
@@ -105,26 +116,59 @@ void buildDefaultMedia( Context* context )
 		"float4 Ambient = float4( 0.0f, 0.0f, 0.0f, 1.0f );"
 		"float4 Diffuse = float4( 0.75f, 0.75f, 0.75f, 1.0f );"
 		"float EMI = 0.1f;"
-		"float LightCount               : LIGHTCOUNT;"
 		"float4 ViewPos                 : VIEWPOS;"
-		"float4 Lights[16]              : LIGHTS;"
-		"float4 LightColors[16]         : LIGHTCOLORS;"
 		"float4x4 World                 : WORLD;"
+		"float4x4 View;"
 		"float4x4 ViewProj              : VIEWPROJ;"
-		"float4x4 Bones[128]            : BONES;"
+		"float4x4 ShadowMatrices[24];"
+		"float ShadowTexel;"
+		"float4 ClusterGrid;"
+		"float4 ClusterView;"
+		"\n#ifndef UNTEXTURED\n"
 		"uniform sampler2D txDiffuse;"
+		"\n#endif\n"
 		"uniform samplerCUBE txEnvironment;"
-
+		"uniform sampler2DARRAY txShadow;"
+		"uniform samplerBUF txLights;"
+		"uniform samplerBUF txClusters;"
+		"uniform samplerBUF txClusterLights;"
+
+		// The instanced variant reads each instance's bones from a texture buffer holding
+		// the palettes of every instance one after another, four rows per matrix.
+		"\n#ifdef INSTANCED\n"
+		"uniform samplerBUF Palettes;"
+		"float InstanceBase;"
+		"float BoneCount;"
+		"float4x4 instanceBone( int instance, float index )"
+		"{"
+		"	int row = ( (int)InstanceBase + instance * (int)BoneCount + (int)index ) * 4;"
+		"	return float4x4( texBUF( Palettes, row ), texBUF( Palettes, row + 1 ), texBUF( Palettes, row + 2 ), texBUF( Palettes, row + 3 ) );"
+		"}"
+		"\n#define BONE( index ) instanceBone( instance, index )\n"
+		"FS_INPUT VS( VS_INPUT In, int instance : INSTANCEID )"
+		"\n#elif defined( STATIC )\n"
+		"float4x4 Model;"
+		"\n#define BONE( index ) Model\n"
+		"FS_INPUT VS( VS_INPUT In )"
+		"\n#else\n"
+		"float4x4 Bones[128]            : BONES;"
+		"\n#define BONE( index ) Bones[index]\n"
 		"FS_INPUT VS( VS_INPUT In )"
+		"\n#endif\n"
 		"{"
 		"	FS_INPUT Out;"
+
+		// Static meshes have a single bone every vertex follows completely, so there is nothing to blend.
+		"\n#ifdef STATIC\n"
+		"	float4x4 skinTransform = BONE( 0 );"
+		"\n#else\n"
 		"	float4x4 skinTransform = 0;"
-		"	float4x4 normTransform = 0;"
-		"	skinTransform += Bones[In.bi.x] * In.bw.x;"
-		"	skinTransform += Bones[In.bi.y] * In.bw.y;"
-		"	skinTransform += Bones[In.bi.z] * In.bw.z;"
-		"	skinTransform += Bones[In.bi.w] * In.bw.w;"
-		"	normTransform = skinTransform;"
+		"	skinTransform += BONE( In.bi.x ) * In.bw.x;"
+		"	skinTransform += BONE( In.bi.y ) * In.bw.y;"
+		"	skinTransform += BONE( In.bi.z ) * In.bw.z;"
+		"	skinTransform += BONE( In.bi.w ) * In.bw.w;"
+		"\n#endif\n"
+		"	float4x4 normTransform = skinTransform;"
 		"	normTransform[3].x = 0;"
 		"	normTransform[3].y = 0;"
 		"	normTransform[3].z = 0;"
@@ -136,19 +180,90 @@ void buildDefaultMedia( Context* context )
 		"	return Out;"
 		"}"
 
+		// Each shadowed light owns a range of layers of the shadow map, given by the x and y
+		// of its LightShadows entry. Cascades are searched from the nearest for one covering
+		// the point, point lights pick the cube face the point lies in.
+		"float shadowFactor( float4 posWS, float4 light, float4 shadow )"
+		"{"
+		"	float layer = shadow.x;"
+		"	if( shadow.z > 0 )"
+		"	{"
+		"		float3 d = posWS.xyz - light.xyz;"
+		"		float3 a = abs( d );"
+		"		layer += ( a.x >= a.y && a.x >= a.z ) ? ( d.x < 0 ? 1 : 0 ) : ( a.y >= a.z ) ? ( d.y < 0 ? 3 : 2 ) : ( d.z < 0 ? 5 : 4 );"
+		"	}"
+		"	for( float c = 0; c < shadow.y; c++ )"
+		"	{"
+		"		float4 p = mul( posWS, ShadowMatrices[(int)( layer + c )] );"
+		"		p.xyz = p.xyz / p.w * 0.5 + 0.5;"
+		"		if( all( saturate( p.xyz ) == p.xyz ) )"
+		"		{"
+		"			float lit = 0;"
+		"			for( int s = 0; s < 4; s++ )"
+		"			{"
+		"				float2 offset = ( float2( s % 2, s / 2 ) - 0.5 ) * ShadowTexel;"
+		"				lit += ( p.z <= tex2DARRAY( txShadow, float3( p.xy + offset, layer + c ) ).x ) ? 0.25 : 0;"
+		"			}"
+		"			return lit;"
+		"		}"
+		"	}"
+		"	return 1;"
+		"}"
+
+		// Every light takes four texels of the light data: position, color and radius, cone
+		// and shadow layers.
+		"float4 shadeLight( int index, FS_INPUT In )"
+		"{"
+		"	float4 position = texBUF( txLights, index * 4 );"
+		"	float4 color = texBUF( txLights, index * 4 + 1 );"
+		"	float4 spot = texBUF( txLights, index * 4 + 2 );"
+		"	float4 shadowLayers = texBUF( txLights, index * 4 + 3 );"
+		"	float4 lightDir = position - In.posWS * position.w;"
+		"	float dist = length(lightDir);"
+		"	float4 NdotL = saturate(dot(In.norm, lightDir / dist));"
+		"	float attenuation = 1 / dist;"
+
+		// Lights with a radius fade out smoothly before it, spot lights fade out at the edge of their cone.
+		"	if( color.w > 0 )"
+		"	{"
+		"		attenuation *= pow( saturate( 1 - pow( dist / color.w, 4 ) ), 2 );"
+		"	}"
+		"	attenuation *= smoothstep( spot.w, spot.w + 0.05, dot( -lightDir.xyz / dist, spot.xyz ) );"
+		"	if( attenuation > 0 )"
+		"	{"
+		"		float shadow = ( shadowLayers.y > 0 ) ? shadowFactor( In.posWS, position, shadowLayers ) : 1;"
+		"		return float4( color.xyz, 1 ) * NdotL * attenuation * 10 * shadow;"
+		"	}"
+		"	return 0;"
+		"}"
+
 		"FS_OUTPUT FS( FS_INPUT In )"
 		"{"
 		"	FS_OUTPUT Out;"
 		"	float4 light = float4( 0, 0, 0, 0 );"
-		"	for(float i = 0; i < LightCount; i++)"
+
+		// Lights without a radius come first and reach every pixel, the others are listed by
+		// the cell of the view grid they reach. Cells split the view evenly across and
+		// logarithmically in depth, the first slice ending at ClusterView.z.
+		"	for( int i = 0; i < (int)ClusterView.w; i++ )"
+		"	{"
+		"		light += shadeLight( i, In );"
+		"	}"
+		"	float3 posView = mul( In.posWS, View ).xyz;"
+		"	float2 ratio = posView.xy / ( max( posView.z, 0.0001 ) * ClusterView.xy );"
+		"	float2 cell = min( floor( saturate( ratio * 0.5 + 0.5 ) * ClusterGrid.xy ), ClusterGrid.xy - 1 );"
+		"	float slice = ( posView.z < ClusterView.z ) ? 0 : min( 1 + floor( log( posView.z / ClusterView.z ) * ClusterGrid.w ), ClusterGrid.z - 1 );"
+		"	float2 range = texBUF( txClusters, (int)( ( slice * ClusterGrid.y + cell.y ) * ClusterGrid.x + cell.x ) ).xy;"
+		"	for( int i = 0; i < (int)range.y; i++ )"
 		"	{"
-		"		float4 lightDir = Lights[i] - In.posWS;"
-		"		float4 NdotL = saturate(dot(In.norm, normalize(lightDir)));"
-		"		float4 attenuation = 1 / length(lightDir);"
-		"		light += LightColors[i] * NdotL * attenuation * 10;"
+		"		light += shadeLight( (int)texBUF( txClusterLights, (int)range.x + i ).x, In );"
 		"	}"
 		"	float4 envColor = texCUBE( txEnvironment, reflect( normalize( In.posWS.xyz - ViewPos.xyz ), In.norm.xyz ) ) * EMI;"
+		"\n#ifdef UNTEXTURED\n"
+		"	float4 texColor = 1;"
+		"\n#else\n"
 		"	float4 texColor = tex2D( txDiffuse, In.tex );"
+		"\n#endif\n"
 		"	Out.color = ( (texColor + envColor) * Diffuse) * (light + Ambient);"
 		"	Out.color.w = min(1.0, Out.color.w);"
 		"	return Out;"
@@ -163,13 +278,36 @@ void buildDefaultMedia( Context* context )
 		"   }"
 		"}";
 
-	defaultEffect->effect = cgCreateEffect(context->cgContext, shader.c_str(), NULL);
-	string = cgGetLastErrorString(&error);
-	if(error)
+	// Compile the same source once for every combination of permutation flags, the first one
+	// being the default effect itself.
+	Shader* defaultPermutations[SHADER_PERMUTATION_COUNT];
+	for( uint32_t p = 0; p < SHADER_PERMUTATION_COUNT; p++ )
 	{
-		fprintf(stderr, "Error: %s\n", string);
-		string = cgGetLastListing(context->cgContext);
-		fprintf(stderr, "Compiler: %s\n", string);
+		defaultPermutations[p] = p ? new Shader : defaultEffect;
+		defaultPermutations[p]->mLibrary = context->defaultMedia;
+		const char* arguments[4];
+		uint32_t argumentCount = 0;
+		if( p & SHADER_INSTANCED )
+		{
+			arguments[argumentCount++] = "-DINSTANCED";
+		}
+		if( p & SHADER_STATIC )
+		{
+			arguments[argumentCount++] = "-DSTATIC";
+		}
+		if( p & SHADER_UNTEXTURED )
+		{
+			arguments[argumentCount++] = "-DUNTEXTURED";
+		}
+		arguments[argumentCount] = NULL;
+		defaultPermutations[p]->effect = cgCreateEffect(context->cgContext, shader.c_str(), argumentCount ? arguments : NULL);
+		string = cgGetLastErrorString(&error);
+		if(error)
+		{
+			fprintf(stderr, "Error: %s\n", string);
+			string = cgGetLastListing(context->cgContext);
+			fprintf(stderr, "Compiler: %s\n", string);
+		}
 	}
 
 	shader =
@@ -230,7 +368,9 @@ void buildDefaultMedia( Context* context )
 		fprintf(stderr, "Compiler: %s\n", string);
 	}
 
-	shader =
+	// Dual filter bloom. Each downsample averages five bilinear taps of the level above, the
+	// first one also applies the exposure and keeps only what exceeds full brightness.
+	shader = std::string( fullScreenProgram ) +
 		"struct FS_INPUT"
 		"{"
 		"  float3 pos               : POSITION;"
@@ -242,53 +382,20 @@ void buildDefaultMedia( Context* context )
 		"  float4 color             : COLOR;"
 		"};"
 
-		"float PixelKernel[13] ="
-		"{"
-		"	-6,"
-		"	-5,"
-		"	-4,"
-		"	-3,"
-		"	-2,"
-		"	-1,"
-		"	0,"
-		"	1,"
-		"	2,"
-		"	3,"
-		"	4,"
-		"	5,"
-		"	6,"
-		"};"
-
-		"static const float BlurWeights[13] ="
-		"{"
-		"	0.002216,"
-		"	0.008764,"
-		"	0.026995,"
-		"	0.064759,"
-		"	0.120985,"
-		"	0.176033,"
-		"	0.199471,"
-		"	0.176033,"
-		"	0.120985,"
-		"	0.064759,"
-		"	0.026995,"
-		"	0.008764,"
-		"	0.002216,"
-		"};"
-
-		"float2 direction;"
-
-		"uniform sampler2D txDiffuse;"
+		"uniform sampler2D txSource;"
+		"float2 HalfPixel;"
+		"float Brightness = 1.0f;"
+		"float Threshold = 0.0f;"
 
 		"FS_OUTPUT FS( FS_INPUT In)"
 		"{"
 		"	FS_OUTPUT Out;"
-		"	float2 samp = In.tex;"
-		"	for (int i = 0; i < 13; i++)"
-		"	{"
-		"		samp = In.tex + (direction * PixelKernel[i]);"
-		"		Out.color += tex2D(txDiffuse, samp) * BlurWeights[i];"
-		"	}"
+		"	float4 sum = tex2D( txSource, In.tex ) * 4.0;"
+		"	sum += tex2D( txSource, In.tex - HalfPixel );"
+		"	sum += tex2D( txSource, In.tex + HalfPixel );"
+		"	sum += tex2D( txSource, In.tex + float2( HalfPixel.x, -HalfPixel.y ) );"
+		"	sum += tex2D( txSource, In.tex - float2( HalfPixel.x, -HalfPixel.y ) );"
+		"	Out.color = max( float4( 0.0, 0.0, 0.0, 0.0 ), sum * ( Brightness / 8.0 ) - Threshold );"
 		"	return Out;"
 		"}"
 
@@ -296,62 +403,22 @@ void buildDefaultMedia( Context* context )
 		"{"
 		"   pass p0"
 		"   {"
+		"      VertexProgram = compile gp4vp FullScreenVS();"
 		"      FragmentProgram = compile gp4fp FS();"
 		"   }"
 		"}";
 
-	blurEffect->effect = cgCreateEffect(context->cgContext, shader.c_str(), NULL);
+	downsampleEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
 	string = cgGetLastErrorString(&error);
 	if(error)
 	{
-		fprintf(stderr, "Error: %s\n", string);
-		string = cgGetLastListing(context->cgContext);
-		fprintf(stderr, "Compiler: %s\n", string);
-	}
-
-	shader =
-		"struct FS_INPUT"
-		"{"
-		"  float3 pos               : POSITION;"
-		"  float2 tex               : TEXCOORD0;"
-		"};"
-
-		"struct FS_OUTPUT"
-		"{"
-		"  float4 color             : COLOR;"
-		"};"
-
-		"float Luminance = 1.0f;"
-
-		"uniform sampler2D txDiffuse;"
-
-		"FS_OUTPUT FS( FS_INPUT In)"
-		"{"
-		"	FS_OUTPUT Out;"
-		"	Out.color = tex2D(txDiffuse, In.tex);"
-		"	Out.color = Out.color - Luminance;"
-		"	Out.color = max(float4(0.0, 0.0, 0.0, 0.0), Out.color);"
-		"	return Out;"
-		"}"
-
-		"technique t0"
-		"{"
-		"   pass p0"
-		"   {"
-		"      FragmentProgram = compile gp4fp FS();"
-		"   }"
-		"}";
-
-	bloomEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
-	string = cgGetLastErrorString( &error );
-	if( error )
-	{
-		fprintf(stderr, "Error: %s\n", string);
+		fprintf( stderr, "Error: %s\n", string );
 		string = cgGetLastListing( context->cgContext );
-		fprintf(stderr, "Compiler: %s\n", string);
+		fprintf( stderr, "Compiler: %s\n", string );
 	}
 
-	shader =
+	// Each upsample spreads a level over the one above it with an eight tap tent.
+	shader = std::string( fullScreenProgram ) +
 		"struct FS_INPUT"
 		"{"
 		"  float3 pos               : POSITION;"
@@ -363,15 +430,21 @@ void buildDefaultMedia( Context* context )
 		"  float4 color             : COLOR;"
 		"};"
 
-		"uniform sampler2D txDiffuse1;"
-		"uniform sampler2D txDiffuse2;"
+		"uniform sampler2D txSource;"
+		"float2 HalfPixel;"
 
 		"FS_OUTPUT FS( FS_INPUT In)"
 		"{"
 		"	FS_OUTPUT Out;"
-		"	Out.color = tex2D(txDiffuse1, In.tex);"
-		"	Out.color += tex2D(txDiffuse2, In.tex);"
-		"	Out.color.w = 1.0;"
+		"	float4 sum = tex2D( txSource, In.tex + float2( -HalfPixel.x * 2.0, 0.0 ) );"
+		"	sum += tex2D( txSource, In.tex + float2( -HalfPixel.x, HalfPixel.y ) ) * 2.0;"
+		"	sum += tex2D( txSource, In.tex + float2( 0.0, HalfPixel.y * 2.0 ) );"
+		"	sum += tex2D( txSource, In.tex + float2( HalfPixel.x, HalfPixel.y ) ) * 2.0;"
+		"	sum += tex2D( txSource, In.tex + float2( HalfPixel.x * 2.0, 0.0 ) );"
+		"	sum += tex2D( txSource, In.tex + float2( HalfPixel.x, -HalfPixel.y ) ) * 2.0;"
+		"	sum += tex2D( txSource, In.tex + float2( 0.0, -HalfPixel.y * 2.0 ) );"
+		"	sum += tex2D( txSource, In.tex + float2( -HalfPixel.x, -HalfPixel.y ) ) * 2.0;"
+		"	Out.color = sum / 12.0;"
 		"	return Out;"
 		"}"
 
@@ -379,12 +452,13 @@ void buildDefaultMedia( Context* context )
 		"{"
 		"   pass p0"
 		"   {"
+		"      VertexProgram = compile gp4vp FullScreenVS();"
 		"      FragmentProgram = compile gp4fp FS();"
 		"   }"
 		"}";
 
-	addEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
-	string = cgGetLastErrorString( &error );
+	upsampleEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
+	string = cgGetLastErrorString(&error);
 	if(error)
 	{
 		fprintf( stderr, "Error: %s\n", string );
@@ -392,7 +466,9 @@ void buildDefaultMedia( Context* context )
 		fprintf( stderr, "Compiler: %s\n", string );
 	}
 
-	shader =
+	// Final composite. Exposure, bloom and motion blur are applied in one pass while writing to
+	// the destination, with a variant compiled for each combination of the optional effects.
+	shader = std::string( fullScreenProgram ) +
 		"struct FS_INPUT"
 		"{"
 		"  float3 pos               : POSITION;"
@@ -404,15 +480,39 @@ void buildDefaultMedia( Context* context )
 		"  float4 color             : COLOR;"
 		"};"
 
-		"uniform sampler2D txDiffuse;"
-		"float Brightness;"
+		"uniform sampler2D txScene;"
+		"uniform sampler2D txBloom;"
+		"uniform sampler2D txDepth;"
+		"float Brightness = 1.0f;"
+		"float4x4 InverseViewProj;"
+		"float4x4 PreviousViewProj;"
 
 		"FS_OUTPUT FS( FS_INPUT In)"
 		"{"
 		"	FS_OUTPUT Out;"
-		"	Out.color = tex2D(txDiffuse, In.tex);"
-		"	Out.color = Out.color * Brightness;"
-		"	Out.color.w = 1.0;"
+		"	float2 texCoord = In.tex;"
+		"\n#ifdef MOTION_BLUR\n"
+		"	float zOverW = tex2D( txDepth, texCoord ).x;"
+		"	float4 H = float4( texCoord.x * 2 - 1, ( 1 - texCoord.y ) * 2 - 1, zOverW, 1 );"
+		"	float4 D = mul( H, InverseViewProj );"
+		"	float4 worldPos = D / D.w;"
+		"	float4 previousPos = mul( worldPos, PreviousViewProj );"
+		"	previousPos /= previousPos.w;"
+		"	float2 velocity = ( ( H - previousPos ) / 16.f ).xy;"
+		"	float4 color = 0;"
+		"	for( int i = 0; i < 4; i++, texCoord += velocity )"
+		"	{"
+		"		color += tex2D( txScene, texCoord );"
+		"	}"
+		"	color /= 4;"
+		"\n#else\n"
+		"	float4 color = tex2D( txScene, texCoord );"
+		"\n#endif\n"
+		"	color *= Brightness;"
+		"\n#ifdef BLOOM\n"
+		"	color += tex2D( txBloom, In.tex );"
+		"\n#endif\n"
+		"	Out.color = float4( color.xyz, 1.0 );"
 		"	return Out;"
 		"}"
 
@@ -420,85 +520,145 @@ void buildDefaultMedia( Context* context )
 		"{"
 		"   pass p0"
 		"   {"
+		"      VertexProgram = compile gp4vp FullScreenVS();"
 		"      FragmentProgram = compile gp4fp FS();"
 		"   }"
 		"}";
 
-	brightnessEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
-	string = cgGetLastErrorString( &error );
-	if(error)
+	const char* compositeArguments[4][3] = { { NULL }, { "-DBLOOM", NULL }, { "-DMOTION_BLUR", NULL }, { "-DBLOOM", "-DMOTION_BLUR", NULL } };
+	Shader* compositeEffects[4];
+	for( uint32_t i = 0; i < 4; i++ )
 	{
-		fprintf(stderr, "Error: %s\n", string);
-		string = cgGetLastListing( context->cgContext );
-		fprintf(stderr, "Compiler: %s\n", string);
+		compositeEffects[i] = new Shader;
+		compositeEffects[i]->mLibrary = context->defaultMedia;
+		compositeEffects[i]->effect = cgCreateEffect( context->cgContext, shader.c_str(), compositeArguments[i] );
+		string = cgGetLastErrorString(&error);
+		if(error)
+		{
+			fprintf( stderr, "Error: %s\n", string );
+			string = cgGetLastListing( context->cgContext );
+			fprintf( stderr, "Compiler: %s\n", string );
+		}
 	}
 
+	// Shadow casters only write depth.
 	shader =
-		"struct FS_INPUT"
+		"struct VS_INPUT"
 		"{"
-		"  float3 pos               : POSITION;"
-		"  float2 tex               : TEXCOORD0;"
+		"	float3 pos              : ATTR0;"
+		"	float3 norm             : ATTR1;"
+		"	float2 tex              : ATTR2;"
+		"	float4 bw               : ATTR3;"
+		"	float4 bi               : ATTR4;"
 		"};"
 
-		"struct FS_OUTPUT"
-		"{"
-		"  float4 color             : COLOR;"
-		"};"
+		"float4x4 ViewProj;"
 
-		"float g_numSamples = 4;"
-		"uniform sampler2D sceneSampler;"
-		"uniform sampler2D depthTexture;"
-		"float4x4 g_ViewProjectionInverseMatrix;"
-		"float4x4 g_previousViewProjectionMatrix;"
+		// Bones are found the same ways the default effect finds them.
+		"\n#ifdef INSTANCED\n"
+		"uniform samplerBUF Palettes;"
+		"float InstanceBase;"
+		"float BoneCount;"
+		"float4x4 instanceBone( int instance, float index )"
+		"{"
+		"	int row = ( (int)InstanceBase + instance * (int)BoneCount + (int)index ) * 4;"
+		"	return float4x4( texBUF( Palettes, row ), texBUF( Palettes, row + 1 ), texBUF( Palettes, row + 2 ), texBUF( Palettes, row + 3 ) );"
+		"}"
+		"\n#define BONE( index ) instanceBone( instance, index )\n"
+		"float4 VS( VS_INPUT In, int instance : INSTANCEID ) : POSITION"
+		"\n#elif defined( STATIC )\n"
+		"float4x4 Model;"
+		"\n#define BONE( index ) Model\n"
+		"float4 VS( VS_INPUT In ) : POSITION"
+		"\n#else\n"
+		"float4x4 Bones[128];"
+		"\n#define BONE( index ) Bones[index]\n"
+		"float4 VS( VS_INPUT In ) : POSITION"
+		"\n#endif\n"
+		"{"
+		"\n#ifdef STATIC\n"
+		"	float4x4 skinTransform = BONE( 0 );"
+		"\n#else\n"
+		"	float4x4 skinTransform = 0;"
+		"	skinTransform += BONE( In.bi.x ) * In.bw.x;"
+		"	skinTransform += BONE( In.bi.y ) * In.bw.y;"
+		"	skinTransform += BONE( In.bi.z ) * In.bw.z;"
+		"	skinTransform += BONE( In.bi.w ) * In.bw.w;"
+		"\n#endif\n"
+		"	return mul( mul( float4( In.pos, 1 ), skinTransform ), ViewProj );"
+		"}"
 
-		"FS_OUTPUT FS( FS_INPUT In)"
+		"float4 FS() : COLOR"
 		"{"
-		"	FS_OUTPUT Out;"
-		"   float2 texCoord = In.tex;"
-		"   float zOverW = tex2D(depthTexture, texCoord);"
-		"   float4 H = float4(texCoord.x * 2 - 1, (1 - texCoord.y) * 2 - 1, zOverW, 1);"
-		"   float4 D = mul(H, g_ViewProjectionInverseMatrix);"
-		"   float4 worldPos = D / D.w;"
-		"   float4 currentPos = H;"
-		"   float4 previousPos = mul(worldPos, g_previousViewProjectionMatrix);"
-		"   previousPos /= previousPos.w;"
-		"   float2 velocity = ((currentPos - previousPos) / 16.f);"
-		"   float4 color = tex2D(sceneSampler, texCoord);"
-		"   texCoord += velocity;"
-		"   for(int i = 1; i < g_numSamples; ++i, texCoord += velocity)"
-		"   {"
-		"       float4 currentColor = tex2D(sceneSampler, texCoord);"
-		"       color += currentColor;"
-		"   }"
-		"   float4 finalColor = color / g_numSamples;"
-		"	Out.color = finalColor;"
-		"	return Out;"
+		"	return 0;"
 		"}"
 
 		"technique t0"
 		"{"
 		"   pass p0"
 		"   {"
+		"      VertexProgram = compile gp4vp VS();"
 		"      FragmentProgram = compile gp4fp FS();"
 		"   }"
 		"}";
 
-	motionBlurEffect->effect = cgCreateEffect( context->cgContext, shader.c_str(), NULL );
-	string = cgGetLastErrorString(&error);
-	if(error)
+	// Casters get the permutations of the default effect that place vertices differently,
+	// static and instanced, in the order of their flags.
+	Shader* shadowEffect = new Shader;
+	Shader* shadowPermutations[4] = { shadowEffect, new Shader, new Shader, new Shader };
+	const char* shadowArguments[4][3] = { { NULL }, { "-DINSTANCED", NULL }, { "-DSTATIC", NULL }, { "-DINSTANCED", "-DSTATIC", NULL } };
+	for( uint32_t p = 0; p < 4; p++ )
 	{
-		fprintf( stderr, "Error: %s\n", string );
-		string = cgGetLastListing( context->cgContext );
-		fprintf( stderr, "Compiler: %s\n", string );
+		shadowPermutations[p]->mLibrary = context->defaultMedia;
+		shadowPermutations[p]->effect = cgCreateEffect( context->cgContext, shader.c_str(), p ? shadowArguments[p] : NULL );
+		string = cgGetLastErrorString(&error);
+		if(error)
+		{
+			fprintf( stderr, "Error: %s\n", string );
+			string = cgGetLastListing( context->cgContext );
+			fprintf( stderr, "Compiler: %s\n", string );
+		}
 	}
 
-	context->defaultMedia->shaders.push_back( defaultEffect );
-	context->defaultMedia->shaders.push_back( skyboxEffect );
-	context->defaultMedia->shaders.push_back( blurEffect );
-	context->defaultMedia->shaders.push_back( bloomEffect );
-	context->defaultMedia->shaders.push_back( addEffect );
-	context->defaultMedia->shaders.push_back( brightnessEffect );
-	context->defaultMedia->shaders.push_back( motionBlurEffect );
+	std::vector< Shader* >& shaders = context->defaultMedia->shaders;
+	shaders.resize( DEFAULT_SHADER_COUNT );
+	shaders[DEFAULT_SHADER_MESH] = defaultEffect;
+	shaders[DEFAULT_SHADER_SKYBOX] = skyboxEffect;
+	shaders[DEFAULT_SHADER_MESH_INSTANCED] = defaultPermutations[SHADER_INSTANCED];
+	shaders[DEFAULT_SHADER_BLOOM_DOWNSAMPLE] = downsampleEffect;
+	shaders[DEFAULT_SHADER_BLOOM_UPSAMPLE] = upsampleEffect;
+	for( uint32_t i = 0; i < 4; i++ )
+	{
+		shaders[DEFAULT_SHADER_COMPOSITE + i] = compositeEffects[i];
+	}
+	shaders[DEFAULT_SHADER_CASTER] = shadowEffect;
+	for( uint32_t p = 2; p < SHADER_PERMUTATION_COUNT; p++ )
+	{
+		shaders[DEFAULT_SHADER_MESH_PERMUTATIONS + p - 2] = defaultPermutations[p];
+	}
+	for( uint32_t p = 1; p < 4; p++ )
+	{
+		shaders[DEFAULT_SHADER_CASTER_PERMUTATIONS + p - 1] = shadowPermutations[p];
+	}
+	for( uint32_t i = 0; i < shaders.size(); i++ )
+	{
+		shaders[i]->resolveParameters();
+	}
+	for( uint32_t p = 1; p < SHADER_PERMUTATION_COUNT; p++ )
+	{
+		if( defaultPermutations[p]->effect )
+		{
+			defaultPermutations[p]->resolveSharedParameters( defaultEffect );
+			defaultEffect->permutations[p] = defaultPermutations[p];
+		}
+	}
+	for( uint32_t p = 1; p < 4; p++ )
+	{
+		if( shadowPermutations[p]->effect )
+		{
+			shadowEffect->permutations[p] = shadowPermutations[p];
+		}
+	}
 
 	// Create Default Material
 	Material* defaultMaterial = new Material;
@@ -510,6 +670,7 @@ void buildDefaultMedia( Context* context )
 	defaultMaterial->noZBuffer = false;
 	defaultMaterial->noZWrite = false;
 	defaultMaterial->postRender = false;
+	defaultMaterial->revision = 0;
 	context->defaultMedia->materials.push_back(defaultMaterial);
 
 	// Create Sky Box
@@ -588,8 +749,10 @@ void buildDefaultMedia( Context* context )
 	mesh->vertices = vertices;
 	mesh->faces = faces;
 	mesh->attributes = attributes;
-	mesh->indexBuffers = 0;
+	mesh->indexBuffer = 0;
+	mesh->positionBuffer = 0;
 	mesh->vertexBuffer = 0;
+	mesh->skinBuffer = 0;
 	Bone* bone = new Bone;
 	bone->matrix = matrixIdentity();
 	bone->length = 1.0f;
@@ -601,9 +764,65 @@ void buildDefaultMedia( Context* context )
 	context->defaultMedia->meshes.push_back( mesh );
 }
 
+void Context::releaseVertexArray( void* glContext, uint32_t vertexArray )
+{
+	if( glContext == SDL_GL_GetCurrentContext() )
+	{
+		glDeleteVertexArrays( 1, &vertexArray );
+	}
+	else
+	{
+		releasedVertexArrays[glContext].push_back( vertexArray );
+	}
+}
+
+void Context::deleteReleasedVertexArrays()
+{
+	std::map< void*, std::vector< uint32_t > >::iterator found = releasedVertexArrays.find( SDL_GL_GetCurrentContext() );
+	if( found != releasedVertexArrays.end() )
+	{
+		glDeleteVertexArrays( found->second.size(), &found->second[0] );
+		releasedVertexArrays.erase( found );
+	}
+}
+
+// Start data of a worker thread, the slice of every job the worker runs.
+class WorkerStart
+{
+	public:
+		Context* context;
+		uint32_t slice;
+};
+
+// Waits for parallelFor to hand out a job and runs the worker's slice of it until the context stops.
+static int SDLCALL workerMain( void* data )
+{
+	WorkerStart* start = (WorkerStart*)data;
+	Context* context = start->context;
+	uint32_t slices = (uint32_t)context->workers.size() + 1;
+	while( true )
+	{
+		SDL_SemWait( context->workStart[start->slice - 1] );
+		if( context->workStop )
+		{
+			break;
+		}
+		uint32_t begin = (uint32_t)( (uint64_t)context->workCount * start->slice / slices );
+		uint32_t end = (uint32_t)( (uint64_t)context->workCount * ( start->slice + 1 ) / slices );
+		if( begin < end )
+		{
+			context->workJob( context->workData, begin, end );
+		}
+		SDL_SemPost( context->workDone );
+	}
+	delete start;
+	return 0;
+}
+
 Context::Context( uint32_t flags )
 {
 	gQuit = false;
+	shaderStamp = 0;
 
 	// Initialize SDL
 	SDL_Init(SDL_INIT_VIDEO);
@@ -666,20 +885,58 @@ Context::Context( uint32_t flags )
 	// Initialize FreeImage
 	FreeImage_Initialise();
 
+	// Intermediate textures of every render target come from one pool.
+	texturePool = new TexturePool();
+
+	// Skinned meshes drawn several times a frame are skinned once into copies kept here.
+	skinCache = new SkinCache( this );
+
+	// One worker per spare processor, the thread calling parallelFor runs the first slice itself.
+	// Each worker waits on its own semaphore so no worker can take another's slice.
+	workDone = SDL_CreateSemaphore( 0 );
+	workJob = NULL;
+	workData = NULL;
+	workCount = 0;
+	workStop = false;
+	uint32_t workerCount = (uint32_t)std::min( std::max( SDL_GetCPUCount() - 1, 0 ), 7 );
+	workers.resize( workerCount );
+	workStart.resize( workerCount );
+	for( uint32_t i = 0; i < workerCount; i++ )
+	{
+		workStart[i] = SDL_CreateSemaphore( 0 );
+		WorkerStart* start = new WorkerStart;
+		start->context = this;
+		start->slice = i + 1;
+		workers[i] = SDL_CreateThread( workerMain, "OvglWorker", start );
+	}
+
 	// Build the default media.
 	buildDefaultMedia( this );
 }
 
 Context::~Context()
 {
+	// Windows go first, they release what the meshes built in their GL contexts.
+	for( uint32_t i = 0; i < windows.size(); i++ )
+	{
+		delete windows[i];
+	}
+	SDL_GL_MakeCurrent( contextWindow, glContext );
 	for( uint32_t i = 0; i < mediaLibraries.size(); i++ )
 	{
 		delete mediaLibraries[i];
 	}
-	for( uint32_t i = 0; i < windows.size(); i++ )
+	workStop = true;
+	for( uint32_t i = 0; i < workers.size(); i++ )
 	{
-		delete windows[i];
+		SDL_SemPost( workStart[i] );
+		SDL_WaitThread( workers[i], NULL );
+		SDL_DestroySemaphore( workStart[i] );
 	}
+	SDL_DestroySemaphore( workDone );
+	SDL_GL_MakeCurrent( contextWindow, glContext );
+	delete texturePool;
+	delete skinCache;
 	delete physicsSolver;
 	delete physicsBroadphase;
 	delete physicsDispatcher;
@@ -709,6 +966,7 @@ void Material::setEffectVariable( const std::string& variable, const std::vector
 	{
 		variables.push_back( std::make_pair( cgVariable, data ) );
 	}
+	revision++;
 }
 
 void Material::setEffectTexture(const std::string& variable, Texture* texture)
@@ -736,6 +994,93 @@ void Material::release()
 	delete this;
 }
 
+Shader::Shader()
+{
+	mLibrary = NULL;
+	effect = NULL;
+	for( uint32_t i = 0; i < SHADER_PERMUTATION_COUNT; i++ )
+	{
+		permutations[i] = NULL;
+	}
+	permutations[0] = this;
+	for( uint32_t i = 0; i < SHADER_PARAMETER_COUNT; i++ )
+	{
+		parameters[i] = NULL;
+		stamps[i] = 0;
+	}
+	boneCapacity = 0;
+	lightCapacity = 0;
+	shadowCapacity = 0;
+	lastMaterial = NULL;
+	lastMaterialRevision = 0;
+}
+
+void Shader::resolveParameters()
+{
+	static const char* names[SHADER_PARAMETER_COUNT] = { "World", "ViewProj", "ViewPos", "Bones", "LightCount", "Lights", "LightColors", "Palettes", "InstanceBase", "BoneCount",
+		"txSource", "txScene", "txBloom", "txDepth", "Brightness", "Threshold", "HalfPixel", "InverseViewProj", "PreviousViewProj",
+		"LightShadows", "ShadowMatrices", "txShadow", "ShadowTexel", "LightSpots",
+		"View", "txLights", "txClusters", "txClusterLights", "ClusterGrid", "ClusterView", "Model", "txDiffuse" };
+	for( uint32_t i = 0; i < SHADER_PARAMETER_COUNT; i++ )
+	{
+		parameters[i] = effect ? cgGetNamedEffectParameter( effect, names[i] ) : NULL;
+		stamps[i] = 0;
+	}
+
+	// Arrays are uploaded whole, only their sizes are needed to clamp the uploads.
+	uint32_t sizes[6] = { 0, 0, 0, 0, 0, 0 };
+	CGparameter arrayParameters[6] = { parameters[SHADER_BONES], parameters[SHADER_LIGHTS], parameters[SHADER_LIGHT_COLORS], parameters[SHADER_LIGHT_SHADOWS], parameters[SHADER_SHADOW_MATRICES], parameters[SHADER_LIGHT_SPOTS] };
+	for( uint32_t a = 0; a < 6; a++ )
+	{
+		if( arrayParameters[a] && cgGetArrayDimension( arrayParameters[a] ) == 1 )
+		{
+			sizes[a] = (uint32_t)cgGetArraySize( arrayParameters[a], 0 );
+		}
+	}
+	boneCapacity = sizes[0];
+	lightCapacity = std::min( sizes[1], sizes[2] );
+	if( parameters[SHADER_LIGHT_SHADOWS] )
+	{
+		lightCapacity = std::min( lightCapacity, sizes[3] );
+	}
+	if( parameters[SHADER_LIGHT_SPOTS] )
+	{
+		lightCapacity = std::min( lightCapacity, sizes[5] );
+	}
+	shadowCapacity = sizes[4];
+	lastMaterial = NULL;
+	lastMaterialRevision = 0;
+}
+
+bool Shader::needsUpload( ShaderParameter parameter, uint32_t stamp )
+{
+	if( !parameters[parameter] || stamps[parameter] == stamp )
+	{
+		return false;
+	}
+	stamps[parameter] = stamp;
+	return true;
+}
+
+void Shader::resolveSharedParameters( Shader* base )
+{
+	sharedParameters.clear();
+	for( CGparameter parameter = cgGetFirstEffectParameter( effect ); parameter; parameter = cgGetNextParameter( parameter ) )
+	{
+		CGparameter baseParameter = cgGetNamedEffectParameter( base->effect, cgGetParameterName( parameter ) );
+		if( baseParameter )
+		{
+			sharedParameters[baseParameter] = parameter;
+		}
+	}
+}
+
+CGparameter Shader::getSharedParameter( CGparameter parameter )
+{
+	std::map< CGparameter, CGparameter >::iterator found = sharedParameters.find( parameter );
+	return ( found != sharedParameters.end() ) ? found->second : NULL;
+}
+
 void Shader::release()
 {
 	for( uint32_t e = 0; e < mLibrary->shaders.size(); e++ )
@@ -785,6 +1130,12 @@ void Context::start()
 				windows[w]->renderTargets[r]->render();
 			}
 		}
+
+		// Textures no render target asked for in the last few frames belong to sizes that are gone.
+		SDL_GL_MakeCurrent( contextWindow, glContext );
+		texturePool->collect( 3 );
+		deleteReleasedVertexArrays();
+		SDL_GL_MakeCurrent( NULL, NULL );
 		for( uint32_t w = 0; w < windows.size(); w++ )
 		{
 			windows[w]->doEvents();
@@ -793,6 +1144,34 @@ void Context::start()
 	}
 }
 
+void Context::parallelFor( uint32_t count, void (*job)( void* data, uint32_t begin, uint32_t end ), void* data )
+{
+	// Small jobs are not worth waking the workers for.
+	uint32_t slices = (uint32_t)workers.size() + 1;
+	if( slices == 1 || count < slices )
+	{
+		if( count )
+		{
+			job( data, 0, count );
+		}
+		return;
+	}
+
+	// The semaphores order the job's fields before the workers read them.
+	workJob = job;
+	workData = data;
+	workCount = count;
+	for( uint32_t i = 0; i < workers.size(); i++ )
+	{
+		SDL_SemPost( workStart[i] );
+	}
+	job( data, 0, count / slices );
+	for( uint32_t i = 0; i < workers.size(); i++ )
+	{
+		SDL_SemWait( workDone );
+	}
+}
+
 UDim::UDim()
 {
 	this->offset = 0;
@@ -28,6 +28,8 @@
 #include <GL/glew.h>
 #include <Cg/cg.h>
 #include <Cg/cgGL.h>
+#include <string.h>
+#include <float.h>
  
 namespace Ovgl
 {
@@ -128,17 +130,60 @@ RenderTarget::RenderTarget( Context* pcontext, Window* hWindow, const URect& vie
 	bloom = 0;
 	motionBlur = false;
 	multiSample = false;
+	frustumCulling = true;
+	visibleCount = 0;
+	culledCount = 0;
+	culledLights = 0;
+	drawCalls = 0;
+	stateChanges = 0;
+	instancing = true;
+	instanceBuffer = 0;
+	depthPrepass = false;
+	prepassDraws = 0;
+	litQueries[0] = 0;
+	litQueries[1] = 0;
+	litSamples = 0;
+	litMilliseconds = 0.0;
+	instanceTexture = 0;
+	instanceCapacity = 0;
 	eyeLuminance = 0.0f;
+	asyncLuminance = true;
+	luminanceFrame = 0;
+	for( uint32_t i = 0; i < 3; i++ )
+	{
+		luminanceBuffers[i] = 0;
+		luminanceFences[i] = NULL;
+	}
 	rect = viewport;
 	multiSampleFrameBuffer = 0;
 	effectFrameBuffer = 0;
 	colorBuffer = 0;
 	depthBuffer = 0;
+	depthTexture = 0;
 	primaryTex = 0;
-	secondaryTex = 0;
-	primaryBloomTex = 0;
-	secondaryBloomTex = 0;
-	update();
+	frameTargetHeight = 0;
+	effectWidth = 0;
+	effectHeight = 0;
+	previousViewProj = matrixIdentity();
+	postPasses = 0;
+	postBandwidth = 0;
+	fullScreenBuffer = 0;
+	fullScreenArray = 0;
+	fullScreenContext = NULL;
+	shadows = true;
+	shadowResolution = 1024;
+	shadowDistance = 100.0f;
+	shadowCascades = 3;
+	shadowTexture = 0;
+	staticShadowTexture = 0;
+	shadowLayers = 0;
+	shadowTextureResolution = 0;
+	shadowFrameBuffer = 0;
+	shadowCacheFrameBuffer = 0;
+	staticShadowScene = NULL;
+	staticShadowRevision = 0;
+	shadowDraws = 0;
+	staticShadowUpdates = 0;
 	window->renderTargets.push_back(this);
 };
 
@@ -160,466 +205,2341 @@ RenderTarget::RenderTarget( Context* pContext, Texture* hTexture, const URect& v
 	bloom = 4;
 	motionBlur = true;
 	multiSample = true;
+	frustumCulling = true;
+	visibleCount = 0;
+	culledCount = 0;
+	culledLights = 0;
+	drawCalls = 0;
+	stateChanges = 0;
+	instancing = true;
+	instanceBuffer = 0;
+	depthPrepass = false;
+	prepassDraws = 0;
+	litQueries[0] = 0;
+	litQueries[1] = 0;
+	litSamples = 0;
+	litMilliseconds = 0.0;
+	instanceTexture = 0;
+	instanceCapacity = 0;
 	eyeLuminance = 0.0f;
+	asyncLuminance = true;
+	luminanceFrame = 0;
+	for( uint32_t i = 0; i < 3; i++ )
+	{
+		luminanceBuffers[i] = 0;
+		luminanceFences[i] = NULL;
+	}
 	rect = viewport;
 	multiSampleFrameBuffer = 0;
 	effectFrameBuffer = 0;
 	colorBuffer = 0;
 	depthBuffer = 0;
+	depthTexture = 0;
 	primaryTex = 0;
-	secondaryTex = 0;
-	primaryBloomTex = 0;
-	secondaryBloomTex = 0;
-	update();
+	frameTargetHeight = 0;
+	effectWidth = 0;
+	effectHeight = 0;
+	previousViewProj = matrixIdentity();
+	postPasses = 0;
+	postBandwidth = 0;
+	fullScreenBuffer = 0;
+	fullScreenArray = 0;
+	fullScreenContext = NULL;
+	shadows = true;
+	shadowResolution = 1024;
+	shadowDistance = 100.0f;
+	shadowCascades = 3;
+	shadowTexture = 0;
+	staticShadowTexture = 0;
+	shadowLayers = 0;
+	shadowTextureResolution = 0;
+	shadowFrameBuffer = 0;
+	shadowCacheFrameBuffer = 0;
+	staticShadowScene = NULL;
+	staticShadowRevision = 0;
+	shadowDraws = 0;
+	staticShadowUpdates = 0;
 };
 
 RenderTarget::~RenderTarget()
 {
-	for( uint32_t r = 0; r < window->renderTargets.size(); r++)
+	// Frame buffers and queries are not shared, so a window's target deletes them from the
+	// window's own GL context, whichever one the caller has current.
+	SDL_Window* currentWindow = SDL_GL_GetCurrentWindow();
+	SDL_GLContext currentContext = SDL_GL_GetCurrentContext();
+	if( window )
+	{
+		SDL_GL_MakeCurrent( window->sdlWindow, window->windowContext );
+	}
+	for( uint32_t i = 0; i < 3; i++ )
+	{
+		if( luminanceFences[i] )
+		{
+			glDeleteSync( (GLsync)luminanceFences[i] );
+		}
+	}
+	if( luminanceBuffers[0] )
+	{
+		glDeleteBuffers( 3, luminanceBuffers );
+	}
+	if( multiSampleFrameBuffer )
+	{
+		glDeleteFramebuffers( 1, &multiSampleFrameBuffer );
+		glDeleteFramebuffers( 1, &effectFrameBuffer );
+	}
+	if( shadowFrameBuffer )
+	{
+		glDeleteFramebuffers( 1, &shadowFrameBuffer );
+		glDeleteFramebuffers( 1, &shadowCacheFrameBuffer );
+	}
+	if( shadowTexture )
+	{
+		glDeleteTextures( 1, &shadowTexture );
+		glDeleteTextures( 1, &staticShadowTexture );
+	}
+	if( fullScreenArray )
+	{
+		context->releaseVertexArray( fullScreenContext, fullScreenArray );
+		glDeleteBuffers( 1, &fullScreenBuffer );
+	}
+	if( instanceTexture )
+	{
+		glDeleteTextures( 1, &instanceTexture );
+	}
+	if( litQueries[0] )
+	{
+		glDeleteQueries( 2, litQueries );
+	}
+	if( instanceBuffer )
+	{
+		glDeleteBuffers( 1, &instanceBuffer );
+	}
+	if( window )
+	{
+		SDL_GL_MakeCurrent( currentWindow, currentContext );
+		for( uint32_t r = 0; r < window->renderTargets.size(); r++)
+		{
+			if(window->renderTargets[r] == this)
+			{
+				window->renderTargets.erase( window->renderTargets.begin() + r );
+			}
+		}
+	}
+}
+
+// Returns a sphere around everything a point or spot light with a radius can light.
+static BoundingSphere lightBounds( const Light* light, const Matrix44& lightPose )
+{
+	Vector3 position( lightPose._41, lightPose._42, lightPose._43 );
+	if( light->type != SPOT_LIGHT )
+	{
+		return BoundingSphere( position, light->radius );
+	}
+
+	// Wide cones are bounded around their cap, narrow ones by the sphere through their tip and rim.
+	Vector3 direction( lightPose._31, lightPose._32, lightPose._33 );
+	float halfAngle = std::min( light->angle * 0.5f, (float)OvglPi * 0.5f );
+	if( halfAngle > (float)OvglPi * 0.25f )
+	{
+		return BoundingSphere( position + direction * ( light->radius * cosf( halfAngle ) ), light->radius * sinf( halfAngle ) );
+	}
+	float radius = light->radius / ( 2.0f * cosf( halfAngle ) );
+	return BoundingSphere( position + direction * radius, radius );
+}
+
+FrameConstants RenderTarget::getFrameConstants()
+{
+	FrameConstants frame;
+	Matrix44 viewPose = view->getPose();
+	frame.view = matrixInverseRigid( viewPose );
+	frame.projection = view->projMat;
+	frame.viewProj = frame.view * frame.projection;
+	frame.viewPosition = Vector4( viewPose._41, viewPose._42, viewPose._43, viewPose._44 );
+	Frustum frustum = frustumMatrix( frame.viewProj );
+	culledLights = 0;
+
+	// Lights without a radius go first, the light clusters only list the lights after them.
+	frame.globalLights = 0;
+	for( uint32_t pass = 0; pass < 2; pass++ )
+	{
+		for( uint32_t l = 0; l < view->scene->lights.size(); l++)
+		{
+			Light* light = view->scene->lights[l];
+			bool bounded = ( light->type == POINT_LIGHT || light->type == SPOT_LIGHT ) && light->radius > 0.0f;
+			if( bounded != ( pass == 1 ) )
+			{
+				continue;
+			}
+			Matrix44 lightPose = light->getPose();
+			BoundingSphere sphere( Vector3( lightPose._41, lightPose._42, lightPose._43 ), 0.0f );
+			if( bounded )
+			{
+				sphere = lightBounds( light, lightPose );
+
+				// Lights that cannot reach anything in view are left out of the lighting and shadows.
+				if( frustumCulling && !frustumIntersectsSphere( frustum, sphere ) )
+				{
+					culledLights++;
+					continue;
+				}
+			}
+			frame.lightSources.push_back( light );
+			if( light->type == DIRECTIONAL_LIGHT )
+			{
+				// Directional lights shine along the z axis of their pose from infinitely far away.
+				frame.lights.push_back( Vector4( -lightPose._31, -lightPose._32, -lightPose._33, 0.0f ) );
+			}
+			else
+			{
+				frame.lights.push_back( Vector4( lightPose._41, lightPose._42, lightPose._43, 1.0f ) );
+			}
+			frame.lightColors.push_back( Vector4( light->color.x, light->color.y, light->color.z, bounded ? light->radius : 0.0f ) );
+			if( light->type == SPOT_LIGHT )
+			{
+				frame.lightSpots.push_back( Vector4( lightPose._31, lightPose._32, lightPose._33, cosf( light->angle * 0.5f ) ) );
+			}
+			else
+			{
+				frame.lightSpots.push_back( Vector4( 0.0f, 0.0f, 0.0f, -1.0f ) );
+			}
+			frame.lightSpheres.push_back( Vector4( sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius ) );
+			frame.lightShadows.push_back( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+			if( !bounded )
+			{
+				frame.globalLights++;
+			}
+		}
+	}
+	frame.stamp = ++context->shaderStamp;
+	return frame;
+}
+
+LightClusters::LightClusters()
+{
+	gridX = 16;
+	gridY = 9;
+	gridZ = 24;
+	nearDistance = 1.0f;
+	farDistance = 1000.0f;
+	tanX = 1.0f;
+	tanY = 1.0f;
+	sliceScale = 1.0f;
+	globalLights = 0;
+	lightBuffer = 0;
+	lightTexture = 0;
+	tableBuffer = 0;
+	tableTexture = 0;
+	indexBuffer = 0;
+	indexTexture = 0;
+}
+
+LightClusters::~LightClusters()
+{
+	if( lightBuffer )
+	{
+		GLuint buffers[3] = { lightBuffer, tableBuffer, indexBuffer };
+		GLuint textures[3] = { lightTexture, tableTexture, indexTexture };
+		glDeleteTextures( 3, textures );
+		glDeleteBuffers( 3, buffers );
+	}
+}
+
+uint32_t LightClusters::getSlice( float depth ) const
+{
+	if( depth < nearDistance )
+	{
+		return 0;
+	}
+	return std::min( 1 + (uint32_t)( logf( depth / nearDistance ) * sliceScale ), gridZ - 1 );
+}
+
+// Returns the column or row of cells a ratio of view space offset to depth falls in, scaled so
+// the edges of the view lie at -1 and 1.
+static uint32_t clusterCell( float ratio, uint32_t cells )
+{
+	float t = std::min( std::max( ratio * 0.5f + 0.5f, 0.0f ), 1.0f );
+	return std::min( (uint32_t)( t * cells ), cells - 1 );
+}
+
+void LightClusters::assignSlices( uint32_t begin, uint32_t end, bool fill )
+{
+	uint32_t lightCount = (uint32_t)radii.size();
+	uint32_t sliceCells = gridX * gridY;
+	for( uint32_t s = begin; s < end; s++ )
+	{
+		// The first slice reaches the camera and the last one never ends.
+		float sliceNear = ( s == 0 ) ? 0.0f : nearDistance * expf( ( s - 1 ) / sliceScale );
+		float sliceFar = ( s == gridZ - 1 ) ? FLT_MAX : nearDistance * expf( s / sliceScale );
+		uint32_t* sliceCounts = &counts[s * sliceCells];
+		const uint32_t* sliceOffsets = &offsets[s * sliceCells];
+		for( uint32_t l = 0; l < lightCount; l++ )
+		{
+			float zNear = std::max( centerZ[l] - radii[l], sliceNear );
+			float zFar = std::min( centerZ[l] + radii[l], sliceFar );
+			if( zNear > zFar || zFar <= 0.0f )
+			{
+				continue;
+			}
+
+			// The part of the box around the sphere inside the slice spans the screen between
+			// the ratios at its corners.
+			zNear = std::max( zNear, 0.0001f );
+			float left = centerX[l] - radii[l];
+			float right = centerX[l] + radii[l];
+			float bottom = centerY[l] - radii[l];
+			float top = centerY[l] + radii[l];
+			uint32_t x0 = clusterCell( std::min( left / zNear, left / zFar ) / tanX, gridX );
+			uint32_t x1 = clusterCell( std::max( right / zNear, right / zFar ) / tanX, gridX );
+			uint32_t y0 = clusterCell( std::min( bottom / zNear, bottom / zFar ) / tanY, gridY );
+			uint32_t y1 = clusterCell( std::max( top / zNear, top / zFar ) / tanY, gridY );
+			for( uint32_t y = y0; y <= y1; y++ )
+			{
+				for( uint32_t x = x0; x <= x1; x++ )
+				{
+					uint32_t cell = y * gridX + x;
+					if( fill )
+					{
+						indices[sliceOffsets[cell] + sliceCounts[cell]] = (float)( globalLights + l );
+					}
+					sliceCounts[cell]++;
+				}
+			}
+		}
+	}
+}
+
+// Work shared by the threads assigning lights to the depth slices of the clusters.
+class ClusterJob
+{
+	public:
+		LightClusters* clusters;
+		bool fill;
+};
+
+static void assignClusterSlices( void* data, uint32_t begin, uint32_t end )
+{
+	ClusterJob* job = (ClusterJob*)data;
+	job->clusters->assignSlices( begin, end, job->fill );
+}
+
+void LightClusters::build( Context* context, const FrameConstants& frame )
+{
+	tanX = 1.0f / fabsf( frame.projection._11 );
+	tanY = 1.0f / fabsf( frame.projection._22 );
+	sliceScale = ( gridZ - 2 ) / logf( farDistance / nearDistance );
+	globalLights = frame.globalLights;
+
+	// The spheres of the lights with a radius are moved into view space four at a time.
+	uint32_t lightCount = (uint32_t)frame.lights.size() - globalLights;
+	centerX.resize( lightCount );
+	centerY.resize( lightCount );
+	centerZ.resize( lightCount );
+	radii.resize( lightCount );
+	for( uint32_t l = 0; l < lightCount; l++ )
+	{
+		const Vector4& sphere = frame.lightSpheres[globalLights + l];
+		centerX[l] = sphere.x;
+		centerY[l] = sphere.y;
+		centerZ[l] = sphere.z;
+		radii[l] = sphere.w;
+	}
+	if( lightCount )
+	{
+		vector3TransformStreams( frame.view, &centerX[0], &centerY[0], &centerZ[0], &centerX[0], &centerY[0], &centerZ[0], lightCount, false );
+	}
+
+	// The cells are counted, given their place in the index list and then filled. Both passes
+	// split the depth slices between the worker threads, so no two threads touch the same
+	// cell. A few lights are not worth waking the workers for.
+	uint32_t cellCount = gridX * gridY * gridZ;
+	counts.assign( cellCount, 0 );
+	offsets.assign( cellCount, 0 );
+	ClusterJob job;
+	job.clusters = this;
+	job.fill = false;
+	if( lightCount >= 64 )
+	{
+		context->parallelFor( gridZ, assignClusterSlices, &job );
+	}
+	else
+	{
+		assignSlices( 0, gridZ, false );
+	}
+	uint32_t total = 0;
+	table.resize( cellCount * 2 );
+	for( uint32_t c = 0; c < cellCount; c++ )
+	{
+		offsets[c] = total;
+		table[c * 2] = (float)total;
+		table[c * 2 + 1] = (float)counts[c];
+		total += counts[c];
+		counts[c] = 0;
+	}
+	indices.resize( std::max( total, (uint32_t)1 ) );
+	job.fill = true;
+	if( lightCount >= 64 )
+	{
+		context->parallelFor( gridZ, assignClusterSlices, &job );
+	}
+	else
+	{
+		assignSlices( 0, gridZ, true );
+	}
+
+	// Every light takes four texels of the light data.
+	lightData.assign( std::max( frame.lights.size(), (size_t)1 ) * 4, Vector4( 0.0f, 0.0f, 0.0f, 0.0f ) );
+	for( uint32_t l = 0; l < frame.lights.size(); l++ )
+	{
+		lightData[l * 4] = frame.lights[l];
+		lightData[l * 4 + 1] = frame.lightColors[l];
+		lightData[l * 4 + 2] = frame.lightSpots[l];
+		lightData[l * 4 + 3] = frame.lightShadows[l];
+	}
+
+	// The buffers are created on first use and refilled every frame.
+	if( !lightBuffer )
+	{
+		uint32_t* buffers[3] = { &lightBuffer, &tableBuffer, &indexBuffer };
+		uint32_t* textures[3] = { &lightTexture, &tableTexture, &indexTexture };
+		GLenum formats[3] = { GL_RGBA32F, GL_RG32F, GL_R32F };
+		for( uint32_t i = 0; i < 3; i++ )
+		{
+			glGenBuffers( 1, buffers[i] );
+			glGenTextures( 1, textures[i] );
+			glBindBuffer( GL_TEXTURE_BUFFER, *buffers[i] );
+			glBindTexture( GL_TEXTURE_BUFFER, *textures[i] );
+			glTexBuffer( GL_TEXTURE_BUFFER, formats[i], *buffers[i] );
+		}
+		glBindTexture( GL_TEXTURE_BUFFER, 0 );
+	}
+	glBindBuffer( GL_TEXTURE_BUFFER, lightBuffer );
+	glBufferData( GL_TEXTURE_BUFFER, lightData.size() * sizeof( Vector4 ), &lightData[0], GL_STREAM_DRAW );
+	glBindBuffer( GL_TEXTURE_BUFFER, tableBuffer );
+	glBufferData( GL_TEXTURE_BUFFER, table.size() * sizeof( float ), &table[0], GL_STREAM_DRAW );
+	glBindBuffer( GL_TEXTURE_BUFFER, indexBuffer );
+	glBufferData( GL_TEXTURE_BUFFER, indices.size() * sizeof( float ), &indices[0], GL_STREAM_DRAW );
+	glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+}
+
+RenderQueue::RenderQueue()
+{
+	overflow = false;
+}
+
+void RenderQueue::clear()
+{
+	items.clear();
+	order.clear();
+	runs.clear();
+	palettes.clear();
+	ids.clear();
+	overflow = false;
+}
+
+uint32_t RenderQueue::getId( const void* pointer )
+{
+	std::map< const void*, uint32_t >::iterator found = ids.find( pointer );
+	if( found != ids.end() )
+	{
+		return found->second;
+	}
+	uint32_t id = (uint32_t)ids.size();
+	ids[pointer] = id;
+	return id;
+}
+
+// Compares two queue entries by their sort keys.
+class DrawItemOrder
+{
+	public:
+		DrawItemOrder( const std::vector< DrawItem >& newItems ) : items( newItems ) {}
+		bool operator()( uint32_t a, uint32_t b ) const { return items[a].key < items[b].key; }
+		const std::vector< DrawItem >& items;
+};
+
+// Compares two queue entries by what their sort keys encode, with the shaders, materials,
+// meshes and subsets themselves in place of ids that did not fit the keys.
+class DrawItemStateOrder
+{
+	public:
+		DrawItemStateOrder( const std::vector< DrawItem >& newItems ) : items( newItems ) {}
+		bool operator()( uint32_t a, uint32_t b ) const
+		{
+			const DrawItem& x = items[a];
+			const DrawItem& y = items[b];
+
+			// Opaque items come first, post render ones after them back to front.
+			uint64_t xBlend = ( x.key >> 63 ) ? ( x.key >> 38 ) : 0;
+			uint64_t yBlend = ( y.key >> 63 ) ? ( y.key >> 38 ) : 0;
+			if( xBlend != yBlend )
+			{
+				return xBlend < yBlend;
+			}
+			const void* xState[3] = { x.material->shaderProgram->permutations[x.permutation], x.material, x.skinned ? (const void*)x.skinned : (const void*)x.mesh };
+			const void* yState[3] = { y.material->shaderProgram->permutations[y.permutation], y.material, y.skinned ? (const void*)y.skinned : (const void*)y.mesh };
+			for( uint32_t i = 0; i < 3; i++ )
+			{
+				if( xState[i] != yState[i] )
+				{
+					return std::less< const void* >()( xState[i], yState[i] );
+				}
+			}
+			if( x.subset != y.subset )
+			{
+				return x.subset < y.subset;
+			}
+			return x.key < y.key;
+		}
+		const std::vector< DrawItem >& items;
+};
+
+void RenderQueue::sort()
+{
+	order.resize( items.size() );
+	for( uint32_t i = 0; i < items.size(); i++ )
+	{
+		order[i] = i;
+	}
+	if( overflow )
+	{
+		std::sort( order.begin(), order.end(), DrawItemStateOrder( items ) );
+	}
+	else
+	{
+		std::sort( order.begin(), order.end(), DrawItemOrder( items ) );
+	}
+}
+
+// Returns the ShaderPermutation flags of the permutation of a material's shader that leaves out
+// what a draw does not need. Meshes with a single bone need no bone blending and materials
+// without a diffuse texture need no diffuse lookup.
+static uint32_t selectPermutation( Material* material, uint32_t boneCount )
+{
+	Shader* shader = material->shaderProgram;
+	uint32_t flags = 0;
+	if( boneCount == 1 && shader->permutations[SHADER_STATIC] )
+	{
+		flags |= SHADER_STATIC;
+	}
+	if( shader->parameters[SHADER_DIFFUSE] && shader->permutations[flags | SHADER_UNTEXTURED] )
+	{
+		bool textured = false;
+		for( uint32_t t = 0; t < material->textures.size(); t++ )
+		{
+			if( material->textures[t].first == shader->parameters[SHADER_DIFFUSE] && material->textures[t].second )
+			{
+				textured = true;
+			}
+		}
+		if( !textured )
+		{
+			flags |= SHADER_UNTEXTURED;
+		}
+	}
+	return flags;
+}
+
+// Returns an id limited to the largest value of its sort key field. Ids that reach it are
+// shared, so the queue is flagged to be sorted by the objects themselves.
+static uint64_t clampSortId( RenderQueue& queue, uint32_t id, uint32_t largest )
+{
+	if( id >= largest )
+	{
+		queue.overflow = true;
+		return largest;
+	}
+	return id;
+}
+
+// The palette of meshes drawn from the skinning cache, their vertices are already in world space.
+static const Matrix44 skinnedPose = matrixIdentity();
+
+void RenderTarget::queueMesh( const FrameConstants& frame, const Mesh& mesh, const Matrix44& matrix, const Matrix44* pose, uint32_t boneCount, std::vector< Material* >& materials )
+{
+	DrawItem item;
+	item.mesh = &mesh;
+	item.world = matrix * frame.viewProj;
+	item.skinned = NULL;
+
+	// Meshes without weights follow their first bone completely.
+	if( !mesh.skinned )
+	{
+		boneCount = 1;
+	}
+
+	// Meshes skinned once this frame are drawn from their copy like single bone meshes.
+	if( boneCount > 1 )
+	{
+		item.skinned = context->skinCache->draw( &mesh, pose, depthPrepass ? 2 : 1 );
+		if( item.skinned )
+		{
+			pose = &skinnedPose;
+			boneCount = 1;
+		}
+	}
+	item.pose = pose;
+	item.boneCount = boneCount;
+
+	// Every subset of this mesh shares one stamp, so its world matrix and bones are uploaded
+	// once per shader however the subsets end up ordered.
+	item.stamp = ++context->shaderStamp;
+
+	// Camera space depth of the mesh origin. Positive floats keep their order when compared as
+	// integers, 20 to 24 bits of that are plenty to order draws.
+	float depth = std::max( 0.0f, matrix._41 * frame.view._13 + matrix._42 * frame.view._23 + matrix._43 * frame.view._33 + frame.view._43 );
+	uint32_t depthBits;
+	memcpy( &depthBits, &depth, sizeof( depthBits ) );
+	uint64_t depthKey = ( depthBits >> 7 ) & 0xFFFFFF;
+	uint64_t nearKey = ( depthBits >> 11 ) & 0xFFFFF;
+	uint64_t meshKey = clampSortId( queue, queue.getId( item.skinned ? (const void*)item.skinned : (const void*)&mesh ), 0x3FFF );
+
+	for( uint32_t s = 0; s < mesh.subsetCount; s++ )
+	{
+		item.subset = s;
+		uint64_t subsetKey = clampSortId( queue, s, 0x1F );
+		item.material = materials[s];
+		item.permutation = selectPermutation( materials[s], boneCount );
+		uint64_t shaderKey = clampSortId( queue, queue.getId( materials[s]->shaderProgram->permutations[item.permutation] ), 0x3FF );
+		uint64_t materialKey = clampSortId( queue, queue.getId( materials[s] ), 0x3FFF );
+		if( materials[s]->postRender )
+		{
+			// Blended surfaces go last and back to front.
+			item.key = ( (uint64_t)1 << 63 ) | ( ( depthKey ^ 0xFFFFFF ) << 38 ) | ( shaderKey << 28 ) | ( materialKey << 14 ) | meshKey;
+		}
+		else
+		{
+			// Opaque surfaces are grouped by state, then drawn front to back. Keeping the subsets
+			// of a mesh together lets repeated draws of one subset merge into instanced draws.
+			item.key = ( shaderKey << 53 ) | ( materialKey << 39 ) | ( meshKey << 25 ) | ( subsetKey << 20 ) | nearKey;
+		}
+		queue.items.push_back( item );
+	}
+}
+
+// Binds a texture to an effect sampler, which may be NULL when the effect does not use it.
+static void bindEffectTexture( CGparameter parameter, uint32_t texture )
+{
+	if( parameter )
+	{
+		cgGLSetTextureParameter( parameter, texture );
+		cgGLEnableTextureParameter( parameter );
+	}
+}
+
+// Unbinds a texture bound by bindEffectTexture.
+static void unbindEffectTexture( CGparameter parameter )
+{
+	if( parameter )
+	{
+		cgGLDisableTextureParameter( parameter );
+	}
+}
+
+// Returns the parameter a material sets in the given shader, which is either the material's own
+// shader or a variant of it.
+static CGparameter materialParameter( Material* material, Shader* shader, CGparameter parameter )
+{
+	return ( shader == material->shaderProgram ) ? parameter : shader->getSharedParameter( parameter );
+}
+
+// Binds the textures of a material to a shader and uploads its variables when they differ from
+// what the shader last received.
+static void bindMaterial( Material* material, Shader* shader )
+{
+	for( uint32_t v = 0; v < material->textures.size(); v++)
 	{
-		if(window->renderTargets[r] == this)
+		CGparameter CgTexture = materialParameter( material, shader, material->textures[v].first );
+		if( CgTexture )
 		{
-			window->renderTargets.erase( window->renderTargets.begin() + r );
+			cgGLSetTextureParameter( CgTexture, material->textures[v].second->image );
+			cgGLEnableTextureParameter( CgTexture );
+		}
+	}
+
+	// Material variables only need uploading when another material used the shader since or they were changed.
+	if( shader->lastMaterial != material || shader->lastMaterialRevision != material->revision )
+	{
+		for( uint32_t v = 0; v < material->variables.size(); v++)
+		{
+			CGparameter CgVariable = materialParameter( material, shader, material->variables[v].first );
+			if( CgVariable )
+			{
+				cgSetParameterValuefr( CgVariable, material->variables[v].second.size(), (float*)&material->variables[v].second[0] );
+			}
+		}
+		shader->lastMaterial = material;
+		shader->lastMaterialRevision = material->revision;
+	}
+}
+
+// Unbinds the textures bindMaterial bound.
+static void unbindMaterial( Material* material, Shader* shader )
+{
+	for( uint32_t v = 0; v < material->textures.size(); v++)
+	{
+		CGparameter CgTexture = materialParameter( material, shader, material->textures[v].first );
+		if( CgTexture )
+		{
+			cgGLDisableTextureParameter( CgTexture );
+		}
+	}
+}
+
+// Draws one subset of the bound mesh, instanced when more than one copy is drawn.
+static void drawSubset( const Mesh* mesh, uint32_t subset, uint32_t instances )
+{
+	const char* indices = (char *)NULL + mesh->indexStarts[subset] * sizeof( uint32_t );
+	if( instances > 1 )
+	{
+		glDrawElementsInstanced( GL_TRIANGLES, mesh->indexCounts[subset], GL_UNSIGNED_INT, indices, instances );
+	}
+	else
+	{
+		glDrawElements( GL_TRIANGLES, mesh->indexCounts[subset], GL_UNSIGNED_INT, indices );
+	}
+}
+
+// Binds a mesh's vertex array object. Meshes without weights read their bone weights and
+// indices from the context's current values, which are set so every vertex follows bone 0.
+static void bindMeshVertices( const Mesh& mesh, bool depthOnly )
+{
+	glBindVertexArray( depthOnly ? mesh.getDepthVertexArray() : mesh.getVertexArray() );
+	if( !mesh.skinned )
+	{
+		glVertexAttrib4f( 3, 1.0f, 0.0f, 0.0f, 0.0f );
+		glVertexAttrib4f( 4, 0.0f, 0.0f, 0.0f, 0.0f );
+	}
+}
+
+// Binds the vertices a queued draw reads, either its mesh or the mesh's skinned copy. Depth
+// only passes leave out the mesh's shading stream.
+static void bindVertices( SkinCache* skinCache, const DrawItem& item, bool depthOnly )
+{
+	if( item.skinned )
+	{
+		skinCache->bind( item.skinned, depthOnly );
+	}
+	else
+	{
+		bindMeshVertices( *item.mesh, depthOnly );
+	}
+}
+
+// Returns true if a material's surfaces are opaque and write the depth they are tested
+// against, which is what the depth pre-pass draws.
+static bool coversDepth( const Material* material )
+{
+	return !material->postRender && !material->noZBuffer && !material->noZWrite;
+}
+
+bool RenderTarget::renderDepthPrepass( const FrameConstants& frame )
+{
+	Shader* caster = context->defaultMedia->shaders[DEFAULT_SHADER_CASTER];
+	prepassDraws = 0;
+	if( !caster->effect )
+	{
+		return false;
+	}
+
+	// The caster effect has the permutations of the lit effects that change how vertices are
+	// placed. The runs the lit pass merges are merged here too, reading the palettes the lit
+	// pass uploaded.
+	glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+	glEnable( GL_DEPTH_TEST );
+	glDepthMask( GL_TRUE );
+	Shader* currentShader = NULL;
+	CGpass pass = NULL;
+	const void* currentVertices = NULL;
+	uint32_t instanceBase = 0;
+	for( uint32_t i = 0; i < queue.order.size(); )
+	{
+		const DrawItem& first = queue.items[queue.order[i]];
+		uint32_t instances = queue.runs[i];
+		uint32_t end = i + ( instances ? instances : 1 );
+		uint32_t runBase = instanceBase;
+		instanceBase += instances * first.boneCount;
+		if( !coversDepth( first.material ) )
+		{
+			i = end;
+			continue;
+		}
+
+		// Runs are drawn one item at a time if the caster has no instanced permutation.
+		uint32_t flags = first.permutation & SHADER_STATIC;
+		Shader* single = caster->permutations[flags] ? caster->permutations[flags] : caster;
+		Shader* instanced = instances ? caster->permutations[flags | SHADER_INSTANCED] : NULL;
+		bool merged = instanced && instanced->parameters[SHADER_PALETTES];
+		for( uint32_t r = i; r < ( merged ? i + 1 : end ); r++ )
+		{
+			const DrawItem& item = queue.items[queue.order[r]];
+			Shader* shader = merged ? instanced : single;
+			if( shader != currentShader )
+			{
+				if( pass )
+				{
+					cgResetPassState( pass );
+				}
+				currentShader = shader;
+				pass = cgGetFirstPass( cgGetFirstTechnique( shader->effect ) );
+				cgGLSetMatrixParameterfr( shader->parameters[SHADER_VIEW_PROJ], (float*)&frame.viewProj );
+				cgSetPassState( pass );
+				stateChanges++;
+			}
+			if( merged )
+			{
+				cgGLSetTextureParameter( shader->parameters[SHADER_PALETTES], instanceTexture );
+				cgGLEnableTextureParameter( shader->parameters[SHADER_PALETTES] );
+				cgGLSetParameter1f( shader->parameters[SHADER_INSTANCE_BASE], (float)runBase );
+				cgGLSetParameter1f( shader->parameters[SHADER_BONE_COUNT], (float)item.boneCount );
+			}
+			else
+			{
+				if( shader->needsUpload( SHADER_MODEL, item.stamp ) )
+				{
+					cgGLSetMatrixParameterfr( shader->parameters[SHADER_MODEL], (float*)item.pose );
+				}
+				uint32_t boneCount = std::min( item.boneCount, shader->boneCapacity );
+				if( boneCount && shader->needsUpload( SHADER_BONES, item.stamp ) )
+				{
+					cgGLSetMatrixParameterArrayfr( shader->parameters[SHADER_BONES], 0, boneCount, (float*)item.pose );
+				}
+			}
+			cgUpdatePassParameters( pass );
+			const void* vertices = item.skinned ? (const void*)item.skinned : (const void*)item.mesh;
+			if( vertices != currentVertices )
+			{
+				bindVertices( context->skinCache, item, true );
+				currentVertices = vertices;
+			}
+			drawSubset( item.mesh, item.subset, merged ? instances : 1 );
+			if( merged )
+			{
+				cgGLDisableTextureParameter( shader->parameters[SHADER_PALETTES] );
+			}
+			prepassDraws++;
+			drawCalls++;
+		}
+		i = end;
+	}
+	if( pass )
+	{
+		cgResetPassState( pass );
+	}
+	glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+	return true;
+}
+
+void RenderTarget::renderQueue( const FrameConstants& frame )
+{
+	queue.sort();
+	drawCalls = 0;
+	stateChanges = 0;
+
+	// Opaque neighbours in draw order that share a mesh subset, material and palette size are
+	// merged into runs drawn by a single instanced call. Their palettes are packed one after
+	// another and uploaded together.
+	if( instancing && !instanceBuffer )
+	{
+		GLint maxTexels = 0;
+		glGetIntegerv( GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels );
+		instanceCapacity = (uint32_t)maxTexels / 4;
+		glGenBuffers( 1, &instanceBuffer );
+		glGenTextures( 1, &instanceTexture );
+		glBindBuffer( GL_TEXTURE_BUFFER, instanceBuffer );
+		glBindTexture( GL_TEXTURE_BUFFER, instanceTexture );
+		glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, instanceBuffer );
+		glBindTexture( GL_TEXTURE_BUFFER, 0 );
+		glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+	}
+	queue.runs.assign( queue.order.size(), 0 );
+	queue.palettes.clear();
+	for( uint32_t i = 0; instancing && i < queue.order.size(); )
+	{
+		const DrawItem& first = queue.items[queue.order[i]];
+		Shader* instanced = first.material->shaderProgram->permutations[first.permutation | SHADER_INSTANCED];
+		uint32_t end = i + 1;
+		if( instanced && instanced->parameters[SHADER_PALETTES] && !first.material->postRender )
+		{
+			while( end < queue.order.size() )
+			{
+				const DrawItem& next = queue.items[queue.order[end]];
+				if( next.mesh != first.mesh || next.skinned != first.skinned || next.subset != first.subset || next.material != first.material || next.boneCount != first.boneCount )
+				{
+					break;
+				}
+				end++;
+			}
+		}
+		uint32_t count = end - i;
+		if( count > 1 && queue.palettes.size() + count * first.boneCount <= instanceCapacity )
+		{
+			queue.runs[i] = count;
+			for( uint32_t r = i; r < end; r++ )
+			{
+				const DrawItem& item = queue.items[queue.order[r]];
+				queue.palettes.insert( queue.palettes.end(), item.pose, item.pose + item.boneCount );
+			}
+		}
+		i = end;
+	}
+	if( !queue.palettes.empty() )
+	{
+		glBindBuffer( GL_TEXTURE_BUFFER, instanceBuffer );
+		glBufferData( GL_TEXTURE_BUFFER, queue.palettes.size() * sizeof( Matrix44 ), &queue.palettes[0], GL_STREAM_DRAW );
+		glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+	}
+
+	bool prepassed = depthPrepass && renderDepthPrepass( frame );
+
+	// Samples passed and GPU time of the lit pass are read back once the previous queries have
+	// finished, so the CPU never waits for them.
+	bool measure = false;
+	if( !litQueries[0] )
+	{
+		glGenQueries( 2, litQueries );
+		measure = true;
+	}
+	else
+	{
+		GLint available = 0;
+		glGetQueryObjectiv( litQueries[1], GL_QUERY_RESULT_AVAILABLE, &available );
+		if( available )
+		{
+			GLuint64 samples = 0;
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v( litQueries[0], GL_QUERY_RESULT, &samples );
+			glGetQueryObjectui64v( litQueries[1], GL_QUERY_RESULT, &nanoseconds );
+			litSamples = samples;
+			litMilliseconds = nanoseconds / 1000000.0;
+			measure = true;
+		}
+	}
+	if( measure )
+	{
+		glBeginQuery( GL_SAMPLES_PASSED, litQueries[0] );
+		glBeginQuery( GL_TIME_ELAPSED, litQueries[1] );
+	}
+
+	const void* currentVertices = NULL;
+	Material* currentMaterial = NULL;
+	Shader* materialShader = NULL;
+	Shader* currentShader = NULL;
+	CGpass firstPass = NULL;
+	CGpass activePass = NULL;
+	int depthTest = -1;
+	int depthWrite = -1;
+	int depthPrepassed = -1;
+	uint32_t instanceBase = 0;
+
+	// Textures every shader of the frame may read, bound again whenever the shader changes.
+	const ShaderParameter frameSamplers[4] = { SHADER_SHADOW_MAP, SHADER_LIGHT_DATA, SHADER_CLUSTER_TABLE, SHADER_CLUSTER_LIGHTS };
+	const uint32_t frameTextures[4] = { shadowTexture, clusters.lightTexture, clusters.tableTexture, clusters.indexTexture };
+	for( uint32_t i = 0; i < queue.order.size(); i++ )
+	{
+		const DrawItem& item = queue.items[queue.order[i]];
+		Material* material = item.material;
+		uint32_t instances = queue.runs[i];
+		Shader* shader = material->shaderProgram->permutations[item.permutation | ( instances ? SHADER_INSTANCED : 0 )];
+
+		if( depthTest != !material->noZBuffer )
+		{
+			depthTest = !material->noZBuffer;
+			if( depthTest )
+			{
+				glEnable( GL_DEPTH_TEST );
+			}
+			else
+			{
+				glDisable( GL_DEPTH_TEST );
+			}
+			stateChanges++;
+		}
+
+		// Surfaces the pre-pass drew only shade the pixels whose depth they wrote. The caster
+		// and the lit effects are different programs that may round positions differently, so
+		// the test also passes in front of the stored depth rather than only at it.
+		bool covered = prepassed && coversDepth( material );
+		if( depthPrepassed != covered )
+		{
+			depthPrepassed = covered;
+			glDepthFunc( covered ? GL_LEQUAL : GL_LESS );
+			stateChanges++;
+		}
+
+		if( depthWrite != ( !material->noZWrite && !covered ) )
+		{
+			depthWrite = !material->noZWrite && !covered;
+			glDepthMask( depthWrite ? GL_TRUE : GL_FALSE );
+			stateChanges++;
+		}
+
+		if( shader != currentShader )
+		{
+			if( activePass )
+			{
+				cgResetPassState( activePass );
+				activePass = NULL;
+			}
+			for( uint32_t t = 0; t < 4; t++ )
+			{
+				if( currentShader && frameTextures[t] )
+				{
+					unbindEffectTexture( currentShader->parameters[frameSamplers[t]] );
+				}
+				if( frameTextures[t] )
+				{
+					bindEffectTexture( shader->parameters[frameSamplers[t]], frameTextures[t] );
+				}
+			}
+			currentShader = shader;
+			firstPass = cgGetFirstPass( cgGetFirstTechnique( shader->effect ) );
+			stateChanges++;
+		}
+
+		// A material is bound again when it moves between permutations of its shader.
+		if( material != currentMaterial || shader != materialShader )
+		{
+			if( currentMaterial )
+			{
+				unbindMaterial( currentMaterial, materialShader );
+			}
+			bindMaterial( material, shader );
+			currentMaterial = material;
+			materialShader = shader;
+			stateChanges++;
+		}
+
+		// Matrices are sent with the row major setters, which matches the row vector
+		// convention of the shaders without transposed copies.
+		if( shader->needsUpload( SHADER_WORLD, item.stamp ) )
+		{
+			cgGLSetMatrixParameterfr( shader->parameters[SHADER_WORLD], (float*)&item.world );
+		}
+		if( shader->needsUpload( SHADER_VIEW_PROJ, frame.stamp ) )
+		{
+			cgGLSetMatrixParameterfr( shader->parameters[SHADER_VIEW_PROJ], (float*)&frame.viewProj );
+		}
+		if( shader->needsUpload( SHADER_VIEW_POS, frame.stamp ) )
+		{
+			cgGLSetParameter4fv( shader->parameters[SHADER_VIEW_POS], (float*)&frame.viewPosition );
+		}
+		if( shader->needsUpload( SHADER_VIEW, frame.stamp ) )
+		{
+			cgGLSetMatrixParameterfr( shader->parameters[SHADER_VIEW], (float*)&frame.view );
+		}
+
+		// Shaders reading the light clusters locate a pixel's cell from its view space position.
+		if( shader->needsUpload( SHADER_CLUSTER_GRID, frame.stamp ) )
+		{
+			cgGLSetParameter4f( shader->parameters[SHADER_CLUSTER_GRID], (float)clusters.gridX, (float)clusters.gridY, (float)clusters.gridZ, clusters.sliceScale );
+		}
+		if( shader->needsUpload( SHADER_CLUSTER_VIEW, frame.stamp ) )
+		{
+			cgGLSetParameter4f( shader->parameters[SHADER_CLUSTER_VIEW], clusters.tanX, clusters.tanY, clusters.nearDistance, (float)clusters.globalLights );
+		}
+
+		if( instances )
+		{
+			// Instanced runs read their palettes from the instance buffer, which holds the runs
+			// in draw order.
+			cgGLSetTextureParameter( shader->parameters[SHADER_PALETTES], instanceTexture );
+			cgGLEnableTextureParameter( shader->parameters[SHADER_PALETTES] );
+			cgGLSetParameter1f( shader->parameters[SHADER_INSTANCE_BASE], (float)instanceBase );
+			cgGLSetParameter1f( shader->parameters[SHADER_BONE_COUNT], (float)item.boneCount );
+		}
+		else if( shader->parameters[SHADER_MODEL] )
+		{
+			// Static permutations take their single bone as a plain matrix.
+			if( shader->needsUpload( SHADER_MODEL, item.stamp ) )
+			{
+				cgGLSetMatrixParameterfr( shader->parameters[SHADER_MODEL], (float*)item.pose );
+			}
+		}
+		else
+		{
+			// The whole palette goes up in one call, once per mesh however many subsets share the shader.
+			uint32_t boneCount = std::min( item.boneCount, shader->boneCapacity );
+			if( boneCount && shader->needsUpload( SHADER_BONES, item.stamp ) )
+			{
+				cgGLSetMatrixParameterArrayfr( shader->parameters[SHADER_BONES], 0, boneCount, (float*)item.pose );
+			}
+		}
+
+		// Shaders without light clusters get the lights as whole arrays, clamped to the array sizes they declare.
+		uint32_t lightCount = std::min( (uint32_t)frame.lights.size(), shader->lightCapacity );
+		if( shader->needsUpload( SHADER_LIGHT_COUNT, frame.stamp ) )
+		{
+			cgGLSetParameter1f( shader->parameters[SHADER_LIGHT_COUNT], (float)lightCount );
+		}
+
+		if( shader->needsUpload( SHADER_LIGHTS, frame.stamp ) && lightCount )
+		{
+			cgGLSetParameterArray4f( shader->parameters[SHADER_LIGHTS], 0, lightCount, (float*)&frame.lights[0] );
+		}
+
+		if( shader->needsUpload( SHADER_LIGHT_COLORS, frame.stamp ) && lightCount )
+		{
+			cgGLSetParameterArray4f( shader->parameters[SHADER_LIGHT_COLORS], 0, lightCount, (float*)&frame.lightColors[0] );
+		}
+
+		if( shader->needsUpload( SHADER_LIGHT_SPOTS, frame.stamp ) && lightCount )
+		{
+			cgGLSetParameterArray4f( shader->parameters[SHADER_LIGHT_SPOTS], 0, lightCount, (float*)&frame.lightSpots[0] );
+		}
+
+		if( shader->needsUpload( SHADER_LIGHT_SHADOWS, frame.stamp ) && lightCount )
+		{
+			cgGLSetParameterArray4f( shader->parameters[SHADER_LIGHT_SHADOWS], 0, lightCount, (float*)&frame.lightShadows[0] );
+		}
+
+		uint32_t shadowCount = std::min( (uint32_t)frame.shadowMatrices.size(), shader->shadowCapacity );
+		if( shader->needsUpload( SHADER_SHADOW_MATRICES, frame.stamp ) && shadowCount )
+		{
+			cgGLSetMatrixParameterArrayfr( shader->parameters[SHADER_SHADOW_MATRICES], 0, shadowCount, (float*)&frame.shadowMatrices[0] );
+		}
+
+		if( shader->needsUpload( SHADER_SHADOW_TEXEL, frame.stamp ) )
+		{
+			cgGLSetParameter1f( shader->parameters[SHADER_SHADOW_TEXEL], 1.0f / shadowResolution );
+		}
+
+		// The vertex array object holds the layout and the indices of every subset.
+		const void* vertices = item.skinned ? (const void*)item.skinned : (const void*)item.mesh;
+		if( vertices != currentVertices )
+		{
+			bindVertices( context->skinCache, item, false );
+			currentVertices = vertices;
+			stateChanges++;
+		}
+
+		if( !cgGetNextPass( firstPass ) )
+		{
+			// Single pass effects stay bound between draws, only changed parameters are pushed.
+			if( activePass )
+			{
+				cgUpdatePassParameters( activePass );
+			}
+			else
+			{
+				cgSetPassState( firstPass );
+				activePass = firstPass;
+			}
+			drawSubset( item.mesh, item.subset, instances );
+			drawCalls++;
+		}
+		else
+		{
+			CGpass pass = firstPass;
+			while (pass)
+			{
+				cgSetPassState(pass);
+				drawSubset( item.mesh, item.subset, instances );
+				cgResetPassState(pass);
+				pass = cgGetNextPass(pass);
+				drawCalls++;
+				stateChanges++;
+			}
+		}
+
+		if( instances )
+		{
+			cgGLDisableTextureParameter( shader->parameters[SHADER_PALETTES] );
+			instanceBase += instances * item.boneCount;
+
+			// The rest of the run was drawn with the first item.
+			i += instances - 1;
+		}
+	}
+
+	if( activePass )
+	{
+		cgResetPassState( activePass );
+	}
+	if( currentMaterial )
+	{
+		unbindMaterial( currentMaterial, materialShader );
+	}
+	for( uint32_t t = 0; currentShader && t < 4; t++ )
+	{
+		if( frameTextures[t] )
+		{
+			unbindEffectTexture( currentShader->parameters[frameSamplers[t]] );
+		}
+	}
+	if( measure )
+	{
+		glEndQuery( GL_TIME_ELAPSED );
+		glEndQuery( GL_SAMPLES_PASSED );
+	}
+	glDepthFunc( GL_LESS );
+
+	glBindVertexArray( 0 );
+}
+
+// Returns the milliseconds passed since a performance counter value.
+static double elapsedMilliseconds( uint64_t start )
+{
+	return (double)( SDL_GetPerformanceCounter() - start ) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+TextureDesc::TextureDesc()
+{
+	width = 0;
+	height = 0;
+	format = 0;
+	samples = 1;
+	mipmaps = false;
+}
+
+TextureDesc::TextureDesc( int w, int h, uint32_t f, uint32_t s, bool m )
+{
+	width = w;
+	height = h;
+	format = f;
+	samples = s;
+	mipmaps = m;
+}
+
+uint64_t TextureDesc::getBytes() const
+{
+	uint64_t pixelBytes = ( format == GL_RGBA16F ) ? 8 : 4;
+	uint64_t bytes = (uint64_t)width * height * pixelBytes * samples;
+	return mipmaps ? bytes * 4 / 3 : bytes;
+}
+
+bool TextureDesc::operator == ( const TextureDesc& desc ) const
+{
+	return width == desc.width && height == desc.height && format == desc.format && samples == desc.samples && mipmaps == desc.mipmaps;
+}
+
+TexturePool::TexturePool()
+{
+	frame = 0;
+	allocatedBytes = 0;
+}
+
+TexturePool::~TexturePool()
+{
+	for( uint32_t i = 0; i < textures.size(); i++ )
+	{
+		glDeleteTextures( 1, &textures[i].texture );
+	}
+}
+
+uint32_t TexturePool::acquire( const TextureDesc& desc )
+{
+	for( uint32_t i = 0; i < textures.size(); i++ )
+	{
+		if( !textures[i].inUse && textures[i].desc == desc )
+		{
+			textures[i].inUse = true;
+			textures[i].lastFrame = frame;
+			return textures[i].texture;
+		}
+	}
+
+	PooledTexture pooled;
+	pooled.desc = desc;
+	pooled.inUse = true;
+	pooled.lastFrame = frame;
+	glGenTextures( 1, &pooled.texture );
+	if( desc.samples > 1 )
+	{
+		glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, pooled.texture );
+		glTexImage2DMultisample( GL_TEXTURE_2D_MULTISAMPLE, desc.samples, desc.format, desc.width, desc.height, 0 );
+		glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, 0 );
+	}
+	else
+	{
+		// Depth is compared texel by texel, color is filtered.
+		bool depth = ( desc.format == GL_DEPTH_COMPONENT32 || desc.format == GL_DEPTH_COMPONENT24 );
+		GLint filter = depth ? GL_NEAREST : GL_LINEAR;
+		glBindTexture( GL_TEXTURE_2D, pooled.texture );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, desc.mipmaps ? maxLevel( desc.width, desc.height ) : 0 );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+		glTexImage2D( GL_TEXTURE_2D, 0, desc.format, desc.width, desc.height, 0, depth ? GL_DEPTH_COMPONENT : GL_RGBA, GL_FLOAT, NULL );
+		glBindTexture( GL_TEXTURE_2D, 0 );
+	}
+	textures.push_back( pooled );
+	allocatedBytes += desc.getBytes();
+	return pooled.texture;
+}
+
+void TexturePool::release( uint32_t texture )
+{
+	for( uint32_t i = 0; i < textures.size(); i++ )
+	{
+		if( textures[i].texture == texture )
+		{
+			textures[i].inUse = false;
+			return;
+		}
+	}
+	fprintf( stderr, "Error: Texture %u was not acquired from the texture pool.\n", texture );
+}
+
+void TexturePool::collect( uint32_t maxIdleFrames )
+{
+	for( uint32_t i = 0; i < textures.size(); )
+	{
+		if( !textures[i].inUse && frame - textures[i].lastFrame > maxIdleFrames )
+		{
+			glDeleteTextures( 1, &textures[i].texture );
+			allocatedBytes -= textures[i].desc.getBytes();
+			textures.erase( textures.begin() + i );
+		}
+		else
+		{
+			i++;
+		}
+	}
+	frame++;
+}
+
+// Skins the positions and normals of every vertex of a mesh into a buffer each. The palette
+// is row major for row vectors, which GL reads as the transposed matrices, so they multiply
+// column vectors from the left. Skinned vertices follow bone 0 completely, so they can be
+// drawn by static permutations and by skinned ones given an identity palette alike.
+static const char* skinningSource =
+	"#version 330\n"
+	"layout( location = 0 ) in vec3 position;\n"
+	"layout( location = 1 ) in vec3 normal;\n"
+	"layout( location = 2 ) in vec2 tex;\n"
+	"layout( location = 3 ) in vec4 weights;\n"
+	"layout( location = 4 ) in vec4 bones;\n"
+	"uniform mat4 Bones[128];\n"
+	"out vec3 skinnedPosition;\n"
+	"out vec3 skinnedNormal;\n"
+	"void main()\n"
+	"{\n"
+	"	mat4 skin = Bones[int( bones.x )] * weights.x + Bones[int( bones.y )] * weights.y + Bones[int( bones.z )] * weights.z + Bones[int( bones.w )] * weights.w;\n"
+	"	skinnedPosition = ( skin * vec4( position, 1.0 ) ).xyz;\n"
+	"	skinnedNormal = mat3( skin ) * normal;\n"
+	"}\n";
+
+SkinCache::SkinCache( Context* pContext )
+{
+	context = pContext;
+	enabled = true;
+	frame = 0;
+	program = 0;
+	paletteLocation = -1;
+	programFailed = false;
+	skinnedMeshes = 0;
+	cachedDraws = 0;
+}
+
+SkinCache::~SkinCache()
+{
+	for( std::map< std::pair< const Mesh*, const Matrix44* >, SkinnedMesh >::iterator i = meshes.begin(); i != meshes.end(); ++i )
+	{
+		if( i->second.positionBuffer )
+		{
+			glDeleteBuffers( 1, &i->second.positionBuffer );
+			glDeleteBuffers( 1, &i->second.shadingBuffer );
+		}
+	}
+
+	releaseVertexArrays( NULL );
+	if( program )
+	{
+		glDeleteProgram( program );
+	}
+}
+
+// Returns the cache entry of a mesh skinned by a palette, adding it if there is none.
+static SkinnedMesh& skinEntry( SkinCache* cache, const Mesh* mesh, const Matrix44* pose )
+{
+	std::pair< const Mesh*, const Matrix44* > key( mesh, pose );
+	std::map< std::pair< const Mesh*, const Matrix44* >, SkinnedMesh >::iterator found = cache->meshes.find( key );
+	if( found == cache->meshes.end() )
+	{
+		SkinnedMesh entry;
+		entry.mesh = mesh;
+		entry.positionBuffer = 0;
+		entry.shadingBuffer = 0;
+		entry.skinned = false;
+		entry.draws = 0;
+		entry.lastDraws = 0;
+		entry.lastFrame = cache->frame;
+		entry.readyFrame = cache->frame - 1;
+		found = cache->meshes.insert( std::make_pair( key, entry ) ).first;
+	}
+	return found->second;
+}
+
+// Builds the program skinning vertices into a transform feedback buffer.
+static uint32_t buildSkinningProgram()
+{
+	GLuint shader = glCreateShader( GL_VERTEX_SHADER );
+	glShaderSource( shader, 1, &skinningSource, NULL );
+	glCompileShader( shader );
+	GLint status = GL_FALSE;
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+	if( status != GL_TRUE )
+	{
+		char log[1024];
+		glGetShaderInfoLog( shader, sizeof( log ), NULL, log );
+		fprintf( stderr, "Error: %s\n", log );
+		glDeleteShader( shader );
+		return 0;
+	}
+	GLuint program = glCreateProgram();
+	glAttachShader( program, shader );
+
+	// Positions and normals go to buffers of their own, so depth only passes read the positions alone.
+	const char* outputs[2] = { "skinnedPosition", "skinnedNormal" };
+	glTransformFeedbackVaryings( program, 2, outputs, GL_SEPARATE_ATTRIBS );
+	glLinkProgram( program );
+	glDeleteShader( shader );
+	glGetProgramiv( program, GL_LINK_STATUS, &status );
+	if( status != GL_TRUE )
+	{
+		char log[1024];
+		glGetProgramInfoLog( program, sizeof( log ), NULL, log );
+		fprintf( stderr, "Error: %s\n", log );
+		glDeleteProgram( program );
+		return 0;
+	}
+	return program;
+}
+
+void SkinCache::prepare( const Mesh* mesh, const Matrix44* pose, uint32_t boneCount )
+{
+	// Single bone meshes and meshes without weights are drawn by static permutations already.
+	if( boneCount < 2 || !mesh->skinned )
+	{
+		return;
+	}
+	SkinnedMesh& entry = skinEntry( this, mesh, pose );
+	entry.lastFrame = frame;
+	if( entry.readyFrame == frame || !enabled || entry.lastDraws < 2 || mesh->vertices.empty() )
+	{
+		return;
+	}
+
+	// Palettes that did not change since they were last skinned leave the copy as it is.
+	if( entry.skinned && entry.palette.size() == boneCount && !memcmp( &entry.palette[0], pose, boneCount * sizeof( Matrix44 ) ) )
+	{
+		entry.readyFrame = frame;
+		return;
+	}
+
+	if( !program && !programFailed )
+	{
+		program = buildSkinningProgram();
+		programFailed = !program;
+		paletteLocation = program ? glGetUniformLocation( program, "Bones" ) : -1;
+	}
+	if( !program )
+	{
+		return;
+	}
+	if( !entry.positionBuffer )
+	{
+		glGenBuffers( 1, &entry.positionBuffer );
+		glGenBuffers( 1, &entry.shadingBuffer );
+	}
+	entry.palette.assign( pose, pose + boneCount );
+
+	// Every vertex is drawn as a point with rasterization off, the outputs land in the buffer.
+	glUseProgram( program );
+	glUniformMatrix4fv( paletteLocation, std::min( boneCount, (uint32_t)128 ), GL_FALSE, (const float*)pose );
+	uint32_t buffers[2] = { entry.positionBuffer, entry.shadingBuffer };
+	for( uint32_t b = 0; b < 2; b++ )
+	{
+		glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, buffers[b] );
+		glBufferData( GL_TRANSFORM_FEEDBACK_BUFFER, mesh->vertices.size() * sizeof( Vector3 ), NULL, GL_DYNAMIC_COPY );
+		glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, b, buffers[b] );
+	}
+	glBindVertexArray( mesh->getVertexArray() );
+	glEnable( GL_RASTERIZER_DISCARD );
+	glBeginTransformFeedback( GL_POINTS );
+	glDrawArrays( GL_POINTS, 0, (GLsizei)mesh->vertices.size() );
+	glEndTransformFeedback();
+	glDisable( GL_RASTERIZER_DISCARD );
+	glBindVertexArray( 0 );
+	glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0 );
+	glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, 1, 0 );
+	glBindBuffer( GL_TRANSFORM_FEEDBACK_BUFFER, 0 );
+	glUseProgram( 0 );
+	entry.skinned = true;
+	entry.readyFrame = frame;
+	skinnedMeshes++;
+}
+
+const SkinnedMesh* SkinCache::draw( const Mesh* mesh, const Matrix44* pose, uint32_t passes )
+{
+	SkinnedMesh& entry = skinEntry( this, mesh, pose );
+	entry.draws += passes;
+	entry.lastFrame = frame;
+	if( entry.skinned && entry.readyFrame == frame )
+	{
+		cachedDraws += passes;
+		return &entry;
+	}
+	return NULL;
+}
+
+void SkinCache::bind( const SkinnedMesh* skinnedMesh, bool depthOnly )
+{
+	// One vertex array object per GL context is pointed at whichever copy is drawn.
+	void* glContext = SDL_GL_GetCurrentContext();
+	std::map< void*, uint32_t >::iterator found = vertexArrays.find( glContext );
+	if( found == vertexArrays.end() )
+	{
+		uint32_t vertexArray;
+		glGenVertexArrays( 1, &vertexArray );
+		glBindVertexArray( vertexArray );
+		glEnableVertexAttribArray( 0 );
+		found = vertexArrays.insert( std::make_pair( glContext, vertexArray ) ).first;
+	}
+	glBindVertexArray( found->second );
+	glBindBuffer( GL_ARRAY_BUFFER, skinnedMesh->positionBuffer );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vector3 ), NULL );
+	if( depthOnly )
+	{
+		glDisableVertexAttribArray( 1 );
+		glDisableVertexAttribArray( 2 );
+	}
+	else
+	{
+		// Skinning leaves texture coordinates as they are, they come from the mesh's shading stream.
+		const Mesh* mesh = skinnedMesh->mesh;
+		glBindBuffer( GL_ARRAY_BUFFER, skinnedMesh->shadingBuffer );
+		glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( Vector3 ), NULL );
+		glBindBuffer( GL_ARRAY_BUFFER, mesh->vertexBuffer );
+		uint32_t textureOffset = ( mesh->vertexFormat & VERTEX_PACKED_NORMALS ) ? 4 : 12;
+		glVertexAttribPointer( 2, 2, ( mesh->vertexFormat & VERTEX_HALF_TEXTURE ) ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, mesh->getShadingStride(), ( (char *)NULL + textureOffset ) );
+		glEnableVertexAttribArray( 1 );
+		glEnableVertexAttribArray( 2 );
+	}
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, skinnedMesh->mesh->indexBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+	// The copies have no weights, every vertex follows bone 0 through the context's current values.
+	glVertexAttrib4f( 3, 1.0f, 0.0f, 0.0f, 0.0f );
+	glVertexAttrib4f( 4, 0.0f, 0.0f, 0.0f, 0.0f );
+}
+
+void SkinCache::releaseVertexArrays( void* glContext )
+{
+	for( std::map< void*, uint32_t >::iterator i = vertexArrays.begin(); i != vertexArrays.end(); )
+	{
+		if( !glContext || i->first == glContext )
+		{
+			context->releaseVertexArray( i->first, i->second );
+			vertexArrays.erase( i++ );
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void SkinCache::beginRender( const RenderTarget* target )
+{
+	// A target rendering twice in one frame means the frame is over.
+	if( std::find( renderedTargets.begin(), renderedTargets.end(), target ) != renderedTargets.end() )
+	{
+		collect( 3 );
+	}
+	renderedTargets.push_back( target );
+}
+
+void SkinCache::collect( uint32_t maxIdleFrames )
+{
+	renderedTargets.clear();
+	for( std::map< std::pair< const Mesh*, const Matrix44* >, SkinnedMesh >::iterator i = meshes.begin(); i != meshes.end(); )
+	{
+		if( frame - i->second.lastFrame > maxIdleFrames )
+		{
+			if( i->second.positionBuffer )
+			{
+				glDeleteBuffers( 1, &i->second.positionBuffer );
+				glDeleteBuffers( 1, &i->second.shadingBuffer );
+			}
+			meshes.erase( i++ );
+		}
+		else
+		{
+			i->second.lastDraws = i->second.draws;
+			i->second.draws = 0;
+			++i;
+		}
+	}
+	skinnedMeshes = 0;
+	cachedDraws = 0;
+	frame++;
+}
+
+void RenderGraph::clear()
+{
+	resources.clear();
+	passes.clear();
+}
+
+uint32_t RenderGraph::addTexture( const TextureDesc& desc, uint32_t* binding )
+{
+	RenderResource resource;
+	resource.desc = desc;
+	resource.binding = binding;
+	resource.firstPass = 0;
+	resource.lastPass = 0;
+	*binding = 0;
+	resources.push_back( resource );
+	return resources.size() - 1;
+}
+
+uint32_t RenderGraph::addPass( const std::string& name, void (RenderTarget::*execute)() )
+{
+	RenderPass pass;
+	pass.name = name;
+	pass.execute = execute;
+	passes.push_back( pass );
+	return passes.size() - 1;
+}
+
+void RenderGraph::read( uint32_t pass, uint32_t resource )
+{
+	passes[pass].reads.push_back( resource );
+}
+
+void RenderGraph::write( uint32_t pass, uint32_t resource )
+{
+	passes[pass].writes.push_back( resource );
+}
+
+void RenderGraph::execute( RenderTarget* target, TexturePool* pool )
+{
+	// Find the span of passes each resource is alive for, resources no pass uses are never created.
+	std::vector< char > used( resources.size(), 0 );
+	for( uint32_t p = 0; p < passes.size(); p++ )
+	{
+		for( uint32_t u = 0; u < passes[p].reads.size() + passes[p].writes.size(); u++ )
+		{
+			uint32_t r = ( u < passes[p].reads.size() ) ? passes[p].reads[u] : passes[p].writes[u - passes[p].reads.size()];
+			if( !used[r] )
+			{
+				resources[r].firstPass = p;
+				used[r] = 1;
+			}
+			resources[r].lastPass = p;
+		}
+	}
+
+	for( uint32_t p = 0; p < passes.size(); p++ )
+	{
+		for( uint32_t r = 0; r < resources.size(); r++ )
+		{
+			if( used[r] && resources[r].firstPass == p )
+			{
+				*resources[r].binding = pool->acquire( resources[r].desc );
+			}
+		}
+
+		// CPU time spent submitting each pass is kept for profiling.
+		uint64_t passStart = SDL_GetPerformanceCounter();
+		(target->*passes[p].execute)();
+		target->passTimes[passes[p].name] = elapsedMilliseconds( passStart );
+
+		// Textures are given back as soon as their last reader is done, later passes and
+		// other render targets can then reuse them.
+		for( uint32_t r = 0; r < resources.size(); r++ )
+		{
+			if( used[r] && resources[r].lastPass == p )
+			{
+				pool->release( *resources[r].binding );
+				*resources[r].binding = 0;
+			}
+		}
+	}
+}
+
+// Returns the pose of a view looking along an axis from a position.
+static Matrix44 axisPose( const Vector3& forward, const Vector3& up, const Vector3& position )
+{
+	Vector3 right = vector3Cross( up, forward );
+	Matrix44 pose = matrixIdentity();
+	pose._11 = right.x;
+	pose._12 = right.y;
+	pose._13 = right.z;
+	pose._21 = up.x;
+	pose._22 = up.y;
+	pose._23 = up.z;
+	pose._31 = forward.x;
+	pose._32 = forward.y;
+	pose._33 = forward.z;
+	pose._41 = position.x;
+	pose._42 = position.y;
+	pose._43 = position.z;
+	return pose;
+}
+
+// Fits the orthographic view of a directional light around the part of the camera's view
+// between two distances. The view is fitted to a sphere and snapped to whole shadow map
+// texels, so it only changes when the camera moves by a texel and the shadow edges hold still.
+static Matrix44 cascadeMatrix( const Matrix44& cameraPose, const Matrix44& projection, const Matrix44& lightPose, float nearDistance, float farDistance, float reach, uint32_t resolution )
+{
+	float tanX = 1.0f / fabsf( projection._11 );
+	float tanY = 1.0f / fabsf( projection._22 );
+	Vector3 corners[8];
+	Vector3 center( 0.0f, 0.0f, 0.0f );
+	for( uint32_t c = 0; c < 8; c++ )
+	{
+		float depth = ( c & 4 ) ? farDistance : nearDistance;
+		Vector3 corner( ( c & 1 ) ? depth * tanX : -depth * tanX, ( c & 2 ) ? depth * tanY : -depth * tanY, depth );
+		corners[c] = vector3Transform( corner, cameraPose );
+		center = center + corners[c];
+	}
+	center = center / 8.0f;
+	float radius = 0.0f;
+	for( uint32_t c = 0; c < 8; c++ )
+	{
+		radius = std::max( radius, distance( corners[c], center ) );
+	}
+	radius = ceilf( radius * 16.0f ) / 16.0f;
+
+	// Snapping happens in the light's orientation around the world origin.
+	Matrix44 lightRotation = lightPose;
+	lightRotation._41 = 0.0f;
+	lightRotation._42 = 0.0f;
+	lightRotation._43 = 0.0f;
+	Matrix44 lightView = matrixInverseRigid( lightRotation );
+	Vector3 lightCenter = vector3Transform( center, lightView );
+	float texel = 2.0f * radius / resolution;
+	lightCenter.x = floorf( lightCenter.x / texel ) * texel;
+	lightCenter.y = floorf( lightCenter.y / texel ) * texel;
+
+	// Casters up to the reach behind the sphere still throw their shadows into it.
+	return lightView * matrixOrthoOffCenterLH( lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius, lightCenter.z - radius - reach, lightCenter.z + radius );
+}
+
+// Draws every subset of a mesh into a shadow map with the pass of the caster shader already set.
+static void drawShadowCaster( Shader* caster, CGpass pass, const Mesh& mesh, const Matrix44* pose, uint32_t boneCount )
+{
+	if( caster->parameters[SHADER_MODEL] )
+	{
+		cgGLSetMatrixParameterfr( caster->parameters[SHADER_MODEL], (float*)pose );
+	}
+	else
+	{
+		cgGLSetMatrixParameterArrayfr( caster->parameters[SHADER_BONES], 0, std::min( boneCount, caster->boneCapacity ), (float*)pose );
+	}
+	cgUpdatePassParameters( pass );
+	bindMeshVertices( mesh, true );
+	for( uint32_t s = 0; s < mesh.subsetCount; s++ )
+	{
+		drawSubset( &mesh, s, 1 );
+	}
+}
+
+void RenderTarget::renderShadowCasters( const Matrix44& viewProj, const std::vector< AABB >& bounds, bool statics )
+{
+	Scene* scene = view->scene;
+	Shader* caster = context->defaultMedia->shaders[DEFAULT_SHADER_CASTER];
+	CGpass pass = cgGetFirstPass( cgGetFirstTechnique( caster->effect ) );
+	Frustum frustum = frustumMatrix( viewProj );
+	cgGLSetMatrixParameterfr( caster->parameters[SHADER_VIEW_PROJ], (float*)&viewProj );
+
+	// The bounds list the objects first, then the props and the actors with meshes.
+	uint32_t entry = 0;
+	if( statics )
+	{
+		// Objects have a single bone, so the static permutation draws them without a palette.
+		// The caller's pass is bound again afterwards.
+		Shader* staticCaster = caster->permutations[SHADER_STATIC];
+		CGpass staticPass = pass;
+		if( staticCaster )
+		{
+			staticPass = cgGetFirstPass( cgGetFirstTechnique( staticCaster->effect ) );
+			cgGLSetMatrixParameterfr( staticCaster->parameters[SHADER_VIEW_PROJ], (float*)&viewProj );
+			cgSetPassState( staticPass );
+		}
+		for( uint32_t i = 0; i < scene->objects.size(); i++ )
+		{
+			if( frustumIntersectsAABB( frustum, bounds[entry++] ) )
+			{
+				Matrix44 pose = scene->objects[i]->getPose();
+				drawShadowCaster( staticCaster ? staticCaster : caster, staticPass, *scene->objects[i]->mesh, &pose, 1 );
+				shadowDraws += scene->objects[i]->mesh->subsetCount;
+			}
+		}
+		if( staticCaster )
+		{
+			cgResetPassState( staticPass );
+			cgSetPassState( pass );
+		}
+	}
+	else
+	{
+		// Meshes skinned once this frame are drawn from their copies after the rest, and meshes
+		// without weights by their first bone like objects.
+		std::vector< const SkinnedMesh* > skinned;
+		std::vector< std::pair< const Mesh*, const Matrix44* > > singles;
+		entry = scene->objects.size();
+		for( uint32_t i = 0; i < scene->props.size(); i++ )
+		{
+			if( frustumIntersectsAABB( frustum, bounds[entry++] ) && !scene->props[i]->matrices.empty() )
+			{
+				if( !scene->props[i]->mesh->skinned )
+				{
+					singles.push_back( std::make_pair( scene->props[i]->mesh, &scene->props[i]->matrices[0] ) );
+					continue;
+				}
+				const SkinnedMesh* copy = context->skinCache->draw( scene->props[i]->mesh, &scene->props[i]->matrices[0], 1 );
+				if( copy )
+				{
+					skinned.push_back( copy );
+					continue;
+				}
+				drawShadowCaster( caster, pass, *scene->props[i]->mesh, &scene->props[i]->matrices[0], scene->props[i]->matrices.size() );
+				shadowDraws += scene->props[i]->mesh->subsetCount;
+			}
+		}
+		for( uint32_t i = 0; i < scene->actors.size(); i++ )
+		{
+			if( scene->actors[i]->mesh && frustumIntersectsAABB( frustum, bounds[entry++] ) && !scene->actors[i]->pose->matrices.empty() )
+			{
+				if( !scene->actors[i]->mesh->skinned )
+				{
+					singles.push_back( std::make_pair( scene->actors[i]->mesh, &scene->actors[i]->pose->matrices[0] ) );
+					continue;
+				}
+				const SkinnedMesh* copy = context->skinCache->draw( scene->actors[i]->mesh, &scene->actors[i]->pose->matrices[0], 1 );
+				if( copy )
+				{
+					skinned.push_back( copy );
+					continue;
+				}
+				drawShadowCaster( caster, pass, *scene->actors[i]->mesh, &scene->actors[i]->pose->matrices[0], scene->actors[i]->pose->matrices.size() );
+				shadowDraws += scene->actors[i]->mesh->subsetCount;
+			}
+		}
+
+		// The copies are in world space, an identity bone places them. The caller's pass is
+		// bound again afterwards.
+		if( !skinned.empty() || !singles.empty() )
+		{
+			Shader* staticCaster = caster->permutations[SHADER_STATIC];
+			Shader* copyCaster = staticCaster ? staticCaster : caster;
+			CGpass copyPass = pass;
+			if( staticCaster )
+			{
+				copyPass = cgGetFirstPass( cgGetFirstTechnique( staticCaster->effect ) );
+				cgGLSetMatrixParameterfr( staticCaster->parameters[SHADER_VIEW_PROJ], (float*)&viewProj );
+				cgSetPassState( copyPass );
+			}
+			for( uint32_t i = 0; i < singles.size(); i++ )
+			{
+				drawShadowCaster( copyCaster, copyPass, *singles[i].first, singles[i].second, 1 );
+				shadowDraws += singles[i].first->subsetCount;
+			}
+			if( copyCaster->parameters[SHADER_MODEL] )
+			{
+				cgGLSetMatrixParameterfr( copyCaster->parameters[SHADER_MODEL], (float*)&skinnedPose );
+			}
+			else
+			{
+				cgGLSetMatrixParameterArrayfr( copyCaster->parameters[SHADER_BONES], 0, 1, (float*)&skinnedPose );
+			}
+			cgUpdatePassParameters( copyPass );
+			for( uint32_t i = 0; i < skinned.size(); i++ )
+			{
+				context->skinCache->bind( skinned[i], true );
+				for( uint32_t s = 0; s < skinned[i]->mesh->subsetCount; s++ )
+				{
+					drawSubset( skinned[i]->mesh, s, 1 );
+				}
+				shadowDraws += skinned[i]->mesh->subsetCount;
+			}
+			if( staticCaster )
+			{
+				cgResetPassState( copyPass );
+				cgSetPassState( pass );
+			}
 		}
 	}
+	glBindVertexArray( 0 );
 }
 
-void RenderTarget::renderMesh( const Mesh& mesh, const Matrix44& matrix, std::vector< Matrix44 >& pose, std::vector< Material* >& materials, bool postRender )
+void RenderTarget::renderShadows( const std::vector< AABB >& bounds )
 {
-	Matrix44 viewProj = (matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->getPose() ) * view->projMat);
-	Matrix44 worldMat = (matrix * viewProj );
-	glLoadMatrixf((float*)&worldMat);
-
-	float lightCount = (float)view->scene->lights.size();
-	std::vector< float > mLights;
-	std::vector< float > lightColors;
-	for( uint32_t l = 0; l < view->scene->lights.size(); l++)
+	Scene* scene = view->scene;
+	Shader* caster = context->defaultMedia->shaders[DEFAULT_SHADER_CASTER];
+	shadowDraws = 0;
+	staticShadowUpdates = 0;
+	frameConstants.shadowMatrices.clear();
+	if( !shadows || !caster->effect )
 	{
-		mLights.push_back( view->scene->lights[l]->getPose()._41 );
-		mLights.push_back( view->scene->lights[l]->getPose()._42 );
-		mLights.push_back( view->scene->lights[l]->getPose()._43 );
-		mLights.push_back( 1.0f );
-		lightColors.push_back( view->scene->lights[l]->color.x );
-		lightColors.push_back( view->scene->lights[l]->color.y );
-		lightColors.push_back( view->scene->lights[l]->color.z );
-		lightColors.push_back( 1.0f );
+		return;
 	}
 
-	for( uint32_t s = 0; s < mesh.subsetCount; s++)
-		if( postRender == materials[s]->postRender )
+	// Every shadowed light gets a range of layers, one per cascade for directional lights, one
+	// per cube face for point lights and one for spot lights. Lights that no longer fit in the
+	// shader's matrices go without shadows.
+	Matrix44 cameraPose = view->getPose();
+	float cameraNear = -view->projMat._43 / view->projMat._33;
+	uint32_t cascades = std::max( (uint32_t)1, std::min( shadowCascades, (uint32_t)4 ) );
+	uint32_t maxLayers = context->defaultMedia->shaders[DEFAULT_SHADER_MESH]->shadowCapacity;
+	for( uint32_t l = 0; l < frameConstants.lightSources.size(); l++ )
+	{
+		Light* light = frameConstants.lightSources[l];
+		uint32_t first = frameConstants.shadowMatrices.size();
+		uint32_t count = ( light->type == DIRECTIONAL_LIGHT ) ? cascades : ( light->type == POINT_LIGHT ) ? 6 : 1;
+		if( !light->castShadows || light->type == AMBIENT_LIGHT || first + count > maxLayers )
 		{
-			if(materials[s]->noZBuffer)
-			{
-				glDisable (GL_DEPTH_TEST);
-			}
-			else
-			{
-				glEnable (GL_DEPTH_TEST);
-			}
+			continue;
+		}
+		Matrix44 lightPose = light->getPose();
 
-			if(materials[s]->noZWrite)
+		// Point and spot light views end at the light's radius, so casters beyond it are culled.
+		float range = ( light->radius > 0.0f ) ? std::min( light->radius, shadowDistance ) : shadowDistance;
+		if( light->type == DIRECTIONAL_LIGHT )
+		{
+			// Cascade splits blend even and logarithmic spacing of the shadowed distance.
+			float nearDistance = cameraNear;
+			for( uint32_t c = 0; c < cascades; c++ )
 			{
-				glDepthMask (GL_FALSE);
+				float part = (float)( c + 1 ) / cascades;
+				float farDistance = 0.5f * ( cameraNear * powf( shadowDistance / cameraNear, part ) ) + 0.5f * ( cameraNear + ( shadowDistance - cameraNear ) * part );
+				frameConstants.shadowMatrices.push_back( cascadeMatrix( cameraPose, view->projMat, lightPose, nearDistance, farDistance, shadowDistance, shadowResolution ) );
+				nearDistance = farDistance;
 			}
-			else
+			frameConstants.lightShadows[l] = Vector4( (float)first, (float)count, 0.0f, 0.0f );
+		}
+		else if( light->type == POINT_LIGHT )
+		{
+			// Faces in the order the shader picks them, +x, -x, +y, -y, +z and -z.
+			static const float axes[6][6] = {
+				{ 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f }, { -1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f },
+				{ 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+				{ 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f } };
+			Vector3 position( lightPose._41, lightPose._42, lightPose._43 );
+			Matrix44 projection = matrixPerspectiveLH( ( (float)OvglPi ) / 2.0f, 1.0f, 0.05f, range );
+			for( uint32_t f = 0; f < 6; f++ )
 			{
-				glDepthMask (GL_TRUE);
+				Matrix44 facePose = axisPose( Vector3( axes[f][0], axes[f][1], axes[f][2] ), Vector3( axes[f][3], axes[f][4], axes[f][5] ), position );
+				frameConstants.shadowMatrices.push_back( matrixInverseRigid( facePose ) * projection );
 			}
+			frameConstants.lightShadows[l] = Vector4( (float)first, 1.0f, 1.0f, 0.0f );
+		}
+		else
+		{
+			frameConstants.shadowMatrices.push_back( matrixInverseRigid( lightPose ) * matrixPerspectiveLH( light->angle, 1.0f, 0.05f, range ) );
+			frameConstants.lightShadows[l] = Vector4( (float)first, 1.0f, 0.0f, 0.0f );
+		}
+	}
+	uint32_t layers = frameConstants.shadowMatrices.size();
+	if( !layers )
+	{
+		return;
+	}
 
-			CGparameter cgWorldMatrix = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "World" );
-			Matrix44 tWorldMat = matrixTranspose(worldMat);
-			cgGLSetMatrixParameterfc( cgWorldMatrix, (float*)&tWorldMat );
-			CGparameter cgViewProjMatrix = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "ViewProj" );
-			Matrix44 tViewProj = matrixTranspose(viewProj);
-			cgGLSetMatrixParameterfc( cgViewProjMatrix, (float*)&tViewProj );
-			CGparameter cgViewPos= cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "ViewPos" );
-			cgGLSetParameter4f( cgViewPos, view->getPose()._41, view->getPose()._42, view->getPose()._43, view->getPose()._44 );
+	// The array textures grow to the layers in use and follow the resolution.
+	if( layers > shadowLayers || shadowTextureResolution != shadowResolution )
+	{
+		if( shadowTexture )
+		{
+			glDeleteTextures( 1, &shadowTexture );
+			glDeleteTextures( 1, &staticShadowTexture );
+		}
+		uint32_t textures[2];
+		glGenTextures( 2, textures );
+		for( uint32_t t = 0; t < 2; t++ )
+		{
+			glBindTexture( GL_TEXTURE_2D_ARRAY, textures[t] );
+			glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+			glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+			glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+			glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+			glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, shadowResolution, shadowResolution, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL );
+		}
+		shadowTexture = textures[0];
+		staticShadowTexture = textures[1];
+		shadowLayers = layers;
+		shadowTextureResolution = shadowResolution;
+		staticShadowMatrices.clear();
+	}
+	glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
 
-			CGparameter cgBoneMatrices = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "Bones" );
-			for( uint32_t v = 0; v < pose.size(); v++)
-			{
-				CGparameter cgBone = cgGetArrayParameter( cgBoneMatrices, v );
-				Matrix44 tPose = matrixTranspose(pose[v]);
-				cgGLSetMatrixParameterfc(cgBone, (float*)&tPose);
-			}
+	// Shadow frame buffers only have depth.
+	if( !shadowFrameBuffer )
+	{
+		glGenFramebuffers( 1, &shadowFrameBuffer );
+		glGenFramebuffers( 1, &shadowCacheFrameBuffer );
+		uint32_t frameBuffers[2] = { shadowFrameBuffer, shadowCacheFrameBuffer };
+		for( uint32_t f = 0; f < 2; f++ )
+		{
+			glBindFramebuffer( GL_FRAMEBUFFER, frameBuffers[f] );
+			glDrawBuffer( GL_NONE );
+			glReadBuffer( GL_NONE );
+		}
+	}
 
-			CGparameter cgLightCount = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "LightCount" );
-			cgGLSetParameter1f( cgLightCount, lightCount );
+	// Cached static layers stay valid while the scene's objects and the layer's matrix are unchanged.
+	if( staticShadowScene != scene || staticShadowRevision != scene->staticRevision )
+	{
+		staticShadowMatrices.clear();
+		staticShadowScene = scene;
+		staticShadowRevision = scene->staticRevision;
+	}
 
-			CGparameter CgLights = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "Lights" );
-			CGparameter CgLight;
-			for( uint32_t v = 0; v < mLights.size() / 4; v++)
+	glViewport( 0, 0, shadowResolution, shadowResolution );
+	glDisable( GL_MULTISAMPLE );
+	glEnable( GL_DEPTH_TEST );
+	glDepthMask( GL_TRUE );
+	glEnable( GL_POLYGON_OFFSET_FILL );
+	glPolygonOffset( 1.5f, 4.0f );
+	CGpass pass = cgGetFirstPass( cgGetFirstTechnique( caster->effect ) );
+	cgSetPassState( pass );
+	for( uint32_t l = 0; l < layers; l++ )
+	{
+		const Matrix44& matrix = frameConstants.shadowMatrices[l];
+		if( l >= staticShadowMatrices.size() || memcmp( &staticShadowMatrices[l], &matrix, sizeof( Matrix44 ) ) )
+		{
+			glBindFramebuffer( GL_FRAMEBUFFER, shadowCacheFrameBuffer );
+			glFramebufferTextureLayer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticShadowTexture, 0, l );
+			glClear( GL_DEPTH_BUFFER_BIT );
+			renderShadowCasters( matrix, bounds, true );
+			if( l < staticShadowMatrices.size() )
 			{
-				CgLight=cgGetArrayParameter( CgLights, v );
-				cgGLSetParameter4fv(CgLight, (float*)&mLights[v * 4]);
+				staticShadowMatrices[l] = matrix;
 			}
-
-			CGparameter CgLightColors = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "LightColors" );
-			CGparameter CgLightColor;
-			for( uint32_t v = 0; v < lightColors.size() / 4; v++)
+			else
 			{
-				CgLightColor=cgGetArrayParameter( CgLightColors, v );
-				cgGLSetParameter4fv(CgLightColor, (float*)&lightColors[v * 4]);
+				staticShadowMatrices.push_back( matrix );
 			}
+			staticShadowUpdates++;
+		}
 
-			for( uint32_t v = 0; v < materials[s]->textures.size(); v++)
-			{
-				CGparameter CgTexture = materials[s]->textures[v].first;
-				cgGLSetTextureParameter( CgTexture, materials[s]->textures[v].second->image );
-				cgGLEnableTextureParameter( CgTexture );
-			}
+		// Start from the cached static casters and draw the moving ones over them.
+		glBindFramebuffer( GL_READ_FRAMEBUFFER, shadowCacheFrameBuffer );
+		glFramebufferTextureLayer( GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticShadowTexture, 0, l );
+		glBindFramebuffer( GL_DRAW_FRAMEBUFFER, shadowFrameBuffer );
+		glFramebufferTextureLayer( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, shadowTexture, 0, l );
+		glBlitFramebuffer( 0, 0, shadowResolution, shadowResolution, 0, 0, shadowResolution, shadowResolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST );
+		glBindFramebuffer( GL_FRAMEBUFFER, shadowFrameBuffer );
+		renderShadowCasters( matrix, bounds, false );
+	}
+	cgResetPassState( pass );
+	glDisable( GL_POLYGON_OFFSET_FILL );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
 
-			for( uint32_t v = 0; v < materials[s]->variables.size(); v++)
-			{
-				CGparameter CgVariable = materials[s]->variables[v].first;
-				cgSetParameterValuefr( CgVariable, materials[s]->variables[v].second.size(), (float*)&materials[s]->variables[v].second[0] );
-			}
+void RenderTarget::renderScene()
+{
+	Scene* scene = view->scene;
+	glBindFramebuffer( GL_FRAMEBUFFER, multiSampleFrameBuffer );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, colorBuffer, 0 );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, depthBuffer, 0 );
 
-			glBindBuffer( GL_ARRAY_BUFFER, mesh.vertexBuffer );
-			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffers[s] );
+	// Set the viewport to fit the window
+	glViewport( 0, 0, effectWidth, effectHeight );
 
-			// Set vertex attributes
-			glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (0) ) );
-			glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (12) ) );
-			glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (24) ) );
-			glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (32) ) );
-			glVertexAttribPointer( 4, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (48) ) );
+	// Clear depth buffer
+	glDepthMask( GL_TRUE );
+	glClear( GL_DEPTH_BUFFER_BIT );
 
-			// Enable vertex attributes
-			glEnableVertexAttribArray( 0 );
-			glEnableVertexAttribArray( 1 );
-			glEnableVertexAttribArray( 2 );
-			glEnableVertexAttribArray( 3 );
-			glEnableVertexAttribArray( 4 );
+	if( scene->skyBox )
+	{
+		// Disable depth test
+		glDisable( GL_DEPTH_TEST );
+		glDepthMask( GL_FALSE );
 
-			CGtechnique tech = cgGetFirstTechnique( materials[s]->shaderProgram->effect );
-			CGpass pass;
-			pass = cgGetFirstPass(tech);
-			while (pass)
-			{
-				cgSetPassState(pass);
-				int BufferSize;
-				glGetBufferParameteriv( GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &BufferSize);
-				glDrawElements( GL_TRIANGLES, BufferSize / sizeof( uint32_t ), GL_UNSIGNED_INT, 0 );
-				cgResetPassState(pass);
-				pass = cgGetNextPass(pass);
-			}
+		glDisable( GL_MULTISAMPLE );
 
-			// Disable vertex attributes
-			glDisableVertexAttribArray( 0 );
-			glDisableVertexAttribArray( 1 );
-			glDisableVertexAttribArray( 2 );
-			glDisableVertexAttribArray( 3 );
-			glDisableVertexAttribArray( 4 );
+		// Set skybox shader View variable
+		CGparameter CgView = cgGetNamedEffectParameter( context->defaultMedia->shaders[DEFAULT_SHADER_SKYBOX]->effect, "View" );
+		Matrix44 tinvView = matrixTranspose( frameConstants.view );
+		cgGLSetMatrixParameterfc( CgView, (float*)&tinvView );
 
-			glBindBuffer( GL_ARRAY_BUFFER, 0 );
-			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+		// Set skybox shader Projection variable
+		CGparameter CgProjection = cgGetNamedEffectParameter( context->defaultMedia->shaders[DEFAULT_SHADER_SKYBOX]->effect, "Projection" );
+		Matrix44 tView = matrixTranspose( frameConstants.projection );
+		cgGLSetMatrixParameterfc( CgProjection, (float*)&tView );
 
-			for( uint32_t v = 0; v < materials[s]->textures.size(); v++)
-			{
-				CGparameter cgTexture = materials[s]->textures[v].first;
-				cgGLDisableTextureParameter( cgTexture );
-			}
-		}
-}
+		// Set skybox texture
+		CGparameter CgFSTexture = cgGetNamedEffectParameter( context->defaultMedia->shaders[DEFAULT_SHADER_SKYBOX]->effect, "txSkybox" );
+		cgGLSetTextureParameter( CgFSTexture, scene->skyBox->image );
+		cgGLEnableTextureParameter( CgFSTexture );
 
-void RenderTarget::renderAutoLuminance()
-{
-	glBindTexture(GL_TEXTURE_2D, primaryTex);
-	glGenerateMipmap(GL_TEXTURE_2D);
-	float luminance;
+		// Bind the cube's vertex array object
+		glBindVertexArray( context->defaultMedia->meshes[0]->getVertexArray() );
 
-	GLint width, height;
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
+		// Draw skybox
+		CGtechnique tech = cgGetFirstTechnique( context->defaultMedia->shaders[DEFAULT_SHADER_SKYBOX]->effect );
+		CGpass pass = cgGetFirstPass( tech );
+		while( pass )
+		{
+			cgSetPassState( pass );
+			glDrawElements( GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0 );
+			cgResetPassState( pass );
+			pass = cgGetNextPass( pass );
+		}
+		glBindVertexArray( 0 );
 
-	glGetTexImage( GL_TEXTURE_2D, maxLevel( width, height), GL_LUMINANCE, GL_FLOAT, &luminance );
-	eyeLuminance = eyeLuminance + ( ( ( luminance + 0.5f ) - eyeLuminance ) * 0.01f );
-	eyeLuminance = std::max( 0.5f, std::min( 1.0f, eyeLuminance ) );
+		cgGLDisableTextureParameter( CgFSTexture );
+	}
+	else
+	{
+		glClearColor( 0.0f, 0.0f, 1.0f, 0.0f );
+		glClear( GL_COLOR_BUFFER_BIT );
+	}
 
-	// Auto luminance effect
-	glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
-
-	// Set texture
-	CGparameter CgFSTexture = cgGetNamedEffectParameter( context->defaultMedia->shaders[5]->effect, "txDiffuse" );
-	cgGLSetTextureParameter( CgFSTexture, primaryTex );
-	cgGLEnableTextureParameter( CgFSTexture );
-
-	// Set brightness
-	CGparameter CgBrightness = cgGetNamedEffectParameter( context->defaultMedia->shaders[5]->effect, "Brightness" );
-	cgGLSetParameter1f( CgBrightness, 1.0f / eyeLuminance );
-
-	CGtechnique tech = cgGetFirstTechnique( context->defaultMedia->shaders[5]->effect );
-	CGpass pass;
-	pass = cgGetFirstPass(tech);
-	while (pass)
-	{
-		cgSetPassState(pass);
-		glBegin(GL_QUADS);
-		glTexCoord2f( 0.0f, 0.0f );
-		glVertex3f(-1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 0.0f );
-		glVertex3f(1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 1.0f );
-		glVertex3f(1.0f, 1.0f, -1.0f);
-		glTexCoord2f( 0.0f, 1.0f );
-		glVertex3f(-1.0f, 1.0f, -1.0f);
-		glEnd();
-		cgResetPassState( pass );
-		pass = cgGetNextPass( pass );
+	// Multisample.
+	if( multiSample )
+	{
+		glEnable( GL_MULTISAMPLE );
+	}
+	else
+	{
+		glDisable( GL_MULTISAMPLE );
 	}
 
-	cgGLDisableTextureParameter( CgFSTexture );
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	renderQueue( frameConstants );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	glColor3f( 1.0f, 1.0f, 1.0f );
+	glDisable( GL_MULTISAMPLE );
+	glDisable( GL_DEPTH_TEST );
+	glDepthMask( GL_FALSE );
+	glDisable( GL_LIGHTING );
+	glEnable( GL_TEXTURE_2D );
+	glMatrixMode( GL_MODELVIEW );
+	glLoadIdentity();
+	glMatrixMode( GL_PROJECTION );
+	glLoadIdentity();
 }
 
-void RenderTarget::renderBloom()
+void RenderTarget::resolveScene()
 {
-	CGtechnique tech;
-	CGpass pass;
-
-	// Render bloom effect
-	glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryBloomTex, 0 );
+	// Blit MultiSampleTexture to BaseTexture to apply effects, depth is only resolved when motion blur reads it.
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, multiSampleFrameBuffer );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, effectFrameBuffer );
+	glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
+	glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0 );
+	glBlitFramebuffer( 0, 0, effectWidth, effectHeight, 0, 0, effectWidth, effectHeight, depthTexture ? GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT, GL_NEAREST );
+
+	// The depth texture is only read from now on.
+	glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, 0, 0 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+}
 
-	GLint width, height;
-	glBindTexture( GL_TEXTURE_2D, primaryBloomTex );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
-	glBindTexture( GL_TEXTURE_2D, 0 );
-
-	glViewport( 0, 0, width, height );
-
-	CGparameter CgFSTexture = cgGetNamedEffectParameter( context->defaultMedia->shaders[3]->effect, "txDiffuse" );
-	cgGLSetTextureParameter( CgFSTexture, primaryTex );
-	cgGLEnableTextureParameter( CgFSTexture );
-
-	// Set vertex attributes
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (0) ) );
-	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (12) ) );
-
-	// Enable vertex attributes
-	glEnableVertexAttribArray( 0 );
-	glEnableVertexAttribArray( 1 );
-
-	tech = cgGetFirstTechnique( context->defaultMedia->shaders[3]->effect );
-	pass = cgGetFirstPass(tech);
-	while (pass)
-	{
-		cgSetPassState(pass);
-		glBegin(GL_QUADS);
-		glTexCoord2f( 0.0f, 0.0f );
-		glVertex3f( -1.0f,-1.0f, -1.0f );
-		glTexCoord2f( 1.0f, 0.0f );
-		glVertex3f( 1.0f,-1.0f, -1.0f );
-		glTexCoord2f( 1.0f, 1.0f );
-		glVertex3f( 1.0f, 1.0f, -1.0f );
-		glTexCoord2f( 0.0f, 1.0f );
-		glVertex3f( -1.0f, 1.0f, -1.0f );
-		glEnd();
-		cgResetPassState( pass );
-		pass = cgGetNextPass( pass );
+void RenderTarget::renderFullScreen( Shader* shader )
+{
+	// The triangle is built once per render target, which always renders from the same context.
+	if( !fullScreenArray )
+	{
+		float corners[6] = { -1.0f, -1.0f, 3.0f, -1.0f, -1.0f, 3.0f };
+		glGenBuffers( 1, &fullScreenBuffer );
+		glBindBuffer( GL_ARRAY_BUFFER, fullScreenBuffer );
+		glBufferData( GL_ARRAY_BUFFER, sizeof( corners ), corners, GL_STATIC_DRAW );
+		glGenVertexArrays( 1, &fullScreenArray );
+		fullScreenContext = SDL_GL_GetCurrentContext();
+		glBindVertexArray( fullScreenArray );
+		glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, 0, NULL );
+		glEnableVertexAttribArray( 0 );
+		glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	}
+	else
+	{
+		glBindVertexArray( fullScreenArray );
 	}
 
-	tech = cgGetFirstTechnique( context->defaultMedia->shaders[3]->effect );
-	pass = cgGetFirstPass( tech );
-	while (pass)
+	CGpass pass = cgGetFirstPass( cgGetFirstTechnique( shader->effect ) );
+	while( pass )
 	{
 		cgSetPassState( pass );
-		glBegin( GL_QUADS );
-		glTexCoord2f( 0.0f, 0.0f );
-		glVertex3f(-1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 0.0f );
-		glVertex3f(1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 1.0f );
-		glVertex3f(1.0f, 1.0f, -1.0f);
-		glTexCoord2f( 0.0f, 1.0f );
-		glVertex3f(-1.0f, 1.0f, -1.0f);
-		glEnd();
+		glDrawArrays( GL_TRIANGLES, 0, 3 );
 		cgResetPassState( pass );
 		pass = cgGetNextPass( pass );
 	}
+	glBindVertexArray( 0 );
+}
+
+void RenderTarget::renderAutoLuminance()
+{
+	glBindTexture(GL_TEXTURE_2D, primaryTex);
+	glGenerateMipmap(GL_TEXTURE_2D);
+	float luminance;
+	int width = effectWidth;
+	int height = effectHeight;
 
-	// Disable vertex attributes
-	glDisableVertexAttribArray( 0 );
-	glDisableVertexAttribArray( 1 );
+	// The mip chain reads the whole texture and writes a third of it again.
+	postBandwidth += (uint64_t)width * height * 8 * 4 / 3;
 
-	bool flipflop = true;
-	for( float i = 0; i < (float)OvglPi; i = i + ( (float)(OvglPi) / bloom ) )
+	bool adapt = true;
+	if( asyncLuminance )
 	{
-		float x = sin(i) * 0.005f;
-		float y = cos(i) * 0.005f;
-
-		if( flipflop )
+		// The smallest mip is copied into a ring of pixel buffers and read back two frames
+		// later, when the GPU has long finished with it, so the CPU never waits on the frame.
+		if( !luminanceBuffers[0] )
 		{
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, secondaryBloomTex, 0);
-			CGparameter cgFSTexture2 = cgGetNamedEffectParameter( context->defaultMedia->shaders[2]->effect, "txDiffuse" );
-			cgGLSetTextureParameter( cgFSTexture2, primaryBloomTex );
-			cgGLEnableTextureParameter( cgFSTexture2 );
+			glGenBuffers( 3, luminanceBuffers );
+			for( uint32_t i = 0; i < 3; i++ )
+			{
+				glBindBuffer( GL_PIXEL_PACK_BUFFER, luminanceBuffers[i] );
+				glBufferData( GL_PIXEL_PACK_BUFFER, sizeof( float ), NULL, GL_STREAM_READ );
+			}
 		}
-		else
+		uint32_t write = luminanceFrame % 3;
+		uint32_t read = ( luminanceFrame + 1 ) % 3;
+
+		// Consume the oldest readback if it has landed, otherwise keep the previous exposure.
+		adapt = false;
+		GLsync readFence = (GLsync)luminanceFences[read];
+		if( readFence )
 		{
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryBloomTex, 0);
-			CGparameter cgFSTexture2 = cgGetNamedEffectParameter( context->defaultMedia->shaders[2]->effect, "txDiffuse" );
-			cgGLSetTextureParameter( cgFSTexture2, secondaryBloomTex );
-			cgGLEnableTextureParameter( cgFSTexture2 );
+			GLenum status = glClientWaitSync( readFence, 0, 0 );
+			if( status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED )
+			{
+				glBindBuffer( GL_PIXEL_PACK_BUFFER, luminanceBuffers[read] );
+				glGetBufferSubData( GL_PIXEL_PACK_BUFFER, 0, sizeof( float ), &luminance );
+				glDeleteSync( readFence );
+				luminanceFences[read] = NULL;
+				adapt = true;
+			}
 		}
-		CGparameter CgDirection2 = cgGetNamedEffectParameter( context->defaultMedia->shaders[2]->effect, "direction" );
-		cgGLSetParameter2f( CgDirection2, x, y );
-
-		// Set vertex attributes
-		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (0) ) );
-		glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (12) ) );
 
-		// Enable vertex attributes
-		glEnableVertexAttribArray( 0 );
-		glEnableVertexAttribArray( 1 );
-
-		tech = cgGetFirstTechnique( context->defaultMedia->shaders[2]->effect );
-		pass = cgGetFirstPass( tech );
-		while (pass)
+		// A readback that never completed is dropped when its buffer comes around again.
+		if( luminanceFences[write] )
 		{
-			cgSetPassState( pass );
-			glBegin(GL_QUADS);
-			glTexCoord2f( 0.0f, 0.0f );
-			glVertex3f( -1.0f,-1.0f, -1.0f );
-			glTexCoord2f( 1.0f, 0.0f );
-			glVertex3f( 1.0f,-1.0f, -1.0f );
-			glTexCoord2f( 1.0f, 1.0f );
-			glVertex3f( 1.0f, 1.0f, -1.0f );
-			glTexCoord2f( 0.0f, 1.0f );
-			glVertex3f( -1.0f, 1.0f, -1.0f );
-			glEnd();
-			cgResetPassState( pass );
-			pass = cgGetNextPass( pass );
+			glDeleteSync( (GLsync)luminanceFences[write] );
 		}
-
-		// Disable vertex attributes
-		glDisableVertexAttribArray( 0 );
-		glDisableVertexAttribArray( 1 );
-		flipflop = !flipflop;
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, luminanceBuffers[write] );
+		glGetTexImage( GL_TEXTURE_2D, maxLevel( width, height), GL_LUMINANCE, GL_FLOAT, NULL );
+		luminanceFences[write] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+		luminanceFrame++;
+	}
+	else
+	{
+		glGetTexImage( GL_TEXTURE_2D, maxLevel( width, height), GL_LUMINANCE, GL_FLOAT, &luminance );
 	}
 
-	// Get texture width and height.
-	glBindTexture( GL_TEXTURE_2D, primaryTex );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height );
-	glBindTexture( GL_TEXTURE_2D, 0 );
-
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
-	glViewport( 0, 0, width, height );
-	CGparameter CgFSTextureA = cgGetNamedEffectParameter( context->defaultMedia->shaders[4]->effect, "txDiffuse1" );
-	cgGLSetTextureParameter( CgFSTextureA, primaryTex );
-	cgGLEnableTextureParameter( CgFSTextureA );
-
-	CGparameter CgFSTextureB = cgGetNamedEffectParameter( context->defaultMedia->shaders[4]->effect, "txDiffuse2" );
-	cgGLSetTextureParameter( CgFSTextureB, primaryBloomTex );
-	cgGLEnableTextureParameter( CgFSTextureB );
+	if( adapt )
+	{
+		eyeLuminance = eyeLuminance + ( ( ( luminance + 0.5f ) - eyeLuminance ) * 0.01f );
+	}
+	eyeLuminance = std::max( 0.5f, std::min( 1.0f, eyeLuminance ) );
+}
 
-	// Set vertex attributes
-	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (0) ) );
-	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (12) ) );
+void RenderTarget::renderBloom()
+{
+	Shader* downsample = context->defaultMedia->shaders[DEFAULT_SHADER_BLOOM_DOWNSAMPLE];
+	Shader* upsample = context->defaultMedia->shaders[DEFAULT_SHADER_BLOOM_UPSAMPLE];
+	uint32_t levels = std::min( (uint32_t)bloom, (uint32_t)bloomTextures.size() );
+	float exposure = autoLuminance ? 1.0f / eyeLuminance : 1.0f;
 
-	// Enable vertex attributes
-	glEnableVertexAttribArray( 0 );
-	glEnableVertexAttribArray( 1 );
+	glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
 
-	tech = cgGetFirstTechnique( context->defaultMedia->shaders[4]->effect );
-	pass = cgGetFirstPass( tech );
-	while (pass)
+	// Walk down the pyramid, the first level reads the scene and keeps only its bright parts.
+	uint32_t source = primaryTex;
+	int sourceWidth = effectWidth;
+	int sourceHeight = effectHeight;
+	uint64_t sourceBytes = 8;
+	for( uint32_t l = 0; l < levels; l++ )
 	{
-		cgSetPassState( pass );
-		glBegin( GL_QUADS );
-		glTexCoord2f( 0.0f, 0.0f );
-		glVertex3f(-1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 0.0f );
-		glVertex3f(1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 1.0f );
-		glVertex3f(1.0f, 1.0f, -1.0f);
-		glTexCoord2f( 0.0f, 1.0f );
-		glVertex3f(-1.0f, 1.0f, -1.0f);
-		glEnd();
-		cgResetPassState( pass );
-		pass = cgGetNextPass( pass );
+		int width = effectWidth >> ( l + 1 );
+		int height = effectHeight >> ( l + 1 );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomTextures[l], 0 );
+		glViewport( 0, 0, width, height );
+		bindEffectTexture( downsample->parameters[SHADER_SOURCE], source );
+		cgGLSetParameter2f( downsample->parameters[SHADER_HALF_PIXEL], 0.5f / sourceWidth, 0.5f / sourceHeight );
+		cgGLSetParameter1f( downsample->parameters[SHADER_BRIGHTNESS], l ? 1.0f : exposure );
+		cgGLSetParameter1f( downsample->parameters[SHADER_THRESHOLD], l ? 0.0f : 1.0f );
+		renderFullScreen( downsample );
+		unbindEffectTexture( downsample->parameters[SHADER_SOURCE] );
+		postPasses++;
+		postBandwidth += (uint64_t)sourceWidth * sourceHeight * sourceBytes + (uint64_t)width * height * 4;
+		source = bloomTextures[l];
+		sourceWidth = width;
+		sourceHeight = height;
+		sourceBytes = 4;
 	}
 
-	// Disable vertex attributes
-	glDisableVertexAttribArray( 0 );
-	glDisableVertexAttribArray( 1 );
+	// Walk back up, leaving the blurred result in the first level.
+	for( uint32_t l = levels; l > 1; l-- )
+	{
+		int width = effectWidth >> ( l - 1 );
+		int height = effectHeight >> ( l - 1 );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomTextures[l - 2], 0 );
+		glViewport( 0, 0, width, height );
+		bindEffectTexture( upsample->parameters[SHADER_SOURCE], bloomTextures[l - 1] );
+		cgGLSetParameter2f( upsample->parameters[SHADER_HALF_PIXEL], 0.5f / sourceWidth, 0.5f / sourceHeight );
+		renderFullScreen( upsample );
+		unbindEffectTexture( upsample->parameters[SHADER_SOURCE] );
+		postPasses++;
+		postBandwidth += (uint64_t)sourceWidth * sourceHeight * 4 + (uint64_t)width * height * 4;
+		sourceWidth = width;
+		sourceHeight = height;
+	}
 
 	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 }
 
-void RenderTarget::renderMotionBlur( )
+void RenderTarget::renderComposite()
 {
-	glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, secondaryTex, 0 );
-
-	CGparameter cgFSTexture = cgGetNamedEffectParameter( context->defaultMedia->shaders[6]->effect, "sceneSampler" );
-	cgGLSetTextureParameter( cgFSTexture, primaryTex );
-	cgGLEnableTextureParameter( cgFSTexture );
+	uint32_t levels = std::min( (uint32_t)bloom, (uint32_t)bloomTextures.size() );
+	Shader* composite = context->defaultMedia->shaders[DEFAULT_SHADER_COMPOSITE + ( levels ? 1 : 0 ) + ( motionBlur ? 2 : 0 )];
+	int width = frameRect.right - frameRect.left;
+	int height = frameRect.bottom - frameRect.top;
 
-	CGparameter cgFSTexture2 = cgGetNamedEffectParameter( context->defaultMedia->shaders[6]->effect, "depthTexture" );
-	cgGLSetTextureParameter( cgFSTexture2, depthTexture );
-	cgGLEnableTextureParameter( cgFSTexture2 );
-
-	Matrix44 viewProj = matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), ( view->projMat * matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->getPose() ) ) );
-	static Matrix44 previous_viewProj;
-	CGparameter cgViewProjMatrix = cgGetNamedEffectParameter( context->defaultMedia->shaders[6]->effect, "g_ViewProjectionInverseMatrix" );
-	Matrix44 tViewProj = matrixTranspose( viewProj );
-	cgGLSetMatrixParameterfc( cgViewProjMatrix, (float*)&tViewProj );
-
-	CGparameter cgPreviousViewProjMatrix = cgGetNamedEffectParameter( context->defaultMedia->shaders[6]->effect, "g_previousViewProjectionMatrix" );
-	Matrix44 tPreviousViewProj = matrixTranspose(previous_viewProj );
-	cgGLSetMatrixParameterfc( cgPreviousViewProjMatrix, (float*)&tPreviousViewProj );
-
-	CGtechnique tech = cgGetFirstTechnique( context->defaultMedia->shaders[6]->effect );
-	CGpass pass;
-	pass = cgGetFirstPass( tech );
-	while (pass)
+	if( hTex )
 	{
-		cgSetPassState( pass );
-		glBegin( GL_QUADS );
-		glTexCoord2f( 0.0f, 0.0f );
-		glVertex3f(-1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 0.0f );
-		glVertex3f(1.0f,-1.0f, -1.0f);
-		glTexCoord2f( 1.0f, 1.0f );
-		glVertex3f(1.0f, 1.0f, -1.0f);
-		glTexCoord2f( 0.0f, 1.0f );
-		glVertex3f(-1.0f, 1.0f, -1.0f);
-		glEnd();
-		cgResetPassState( pass );
-		pass = cgGetNextPass( pass );
+		glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hTex->image, 0 );
 	}
 
-	cgGLDisableTextureParameter( cgFSTexture );
-	cgGLDisableTextureParameter( cgFSTexture2 );
+	// The viewport confines the full screen triangle to the target's rectangle.
+	glViewport( frameRect.left, frameTargetHeight - frameRect.bottom, width, height );
 
-	glBindTexture( GL_TEXTURE_2D, secondaryTex );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
+	bindEffectTexture( composite->parameters[SHADER_SCENE], primaryTex );
+	cgGLSetParameter1f( composite->parameters[SHADER_BRIGHTNESS], autoLuminance ? 1.0f / eyeLuminance : 1.0f );
+	uint64_t bytes = (uint64_t)effectWidth * effectHeight * 8 + (uint64_t)width * height * 4;
+	if( levels )
+	{
+		bindEffectTexture( composite->parameters[SHADER_BLOOM], bloomTextures[0] );
+		bytes += (uint64_t)( effectWidth / 2 ) * ( effectHeight / 2 ) * 4;
+	}
+	Matrix44 viewProj;
+	if( motionBlur )
+	{
+		bindEffectTexture( composite->parameters[SHADER_DEPTH], depthTexture );
+		viewProj = view->getPose() * matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->projMat );
+		cgGLSetMatrixParameterfr( composite->parameters[SHADER_INVERSE_VIEW_PROJ], (float*)&viewProj );
+		cgGLSetMatrixParameterfr( composite->parameters[SHADER_PREVIOUS_VIEW_PROJ], (float*)&previousViewProj );
+		bytes += (uint64_t)effectWidth * effectHeight * 4;
+	}
 
-	glBegin( GL_QUADS );
-	glTexCoord2f( 0.0f, 0.0f );
-	glVertex3f(-1.0f,-1.0f, -1.0f);
-	glTexCoord2f( 1.0f, 0.0f );
-	glVertex3f(1.0f,-1.0f, -1.0f);
-	glTexCoord2f( 1.0f, 1.0f );
-	glVertex3f(1.0f, 1.0f, -1.0f);
-	glTexCoord2f( 0.0f, 1.0f );
-	glVertex3f(-1.0f, 1.0f, -1.0f);
-	glEnd();
+	renderFullScreen( composite );
 
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-	previous_viewProj = view->projMat * matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->getPose() );
+	unbindEffectTexture( composite->parameters[SHADER_SCENE] );
+	if( levels )
+	{
+		unbindEffectTexture( composite->parameters[SHADER_BLOOM] );
+	}
+	if( motionBlur )
+	{
+		unbindEffectTexture( composite->parameters[SHADER_DEPTH] );
+		previousViewProj = view->projMat * matrixInverseRigid( view->getPose() );
+	}
+	postPasses++;
+	postBandwidth += bytes;
 }
 
 void RenderTarget::renderMarker( const Matrix44& matrix )
 {
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
-	Matrix44 mat = ( matrix * matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->getPose() ) );
+	Matrix44 mat = ( matrix * matrixInverseRigid( view->getPose() ) );
 	glLoadMatrixf( (float*)&mat );
 	glMatrixMode( GL_PROJECTION );
 	glLoadIdentity();
@@ -664,6 +2584,7 @@ void RenderTarget::render()
 		windowRect.bottom += windowRect.top;
 		adjustedRect = windowAdjustedRect( window, &rect );
 		SDL_GL_MakeCurrent( window->sdlWindow, window->windowContext );
+		context->deleteReleasedVertexArrays();
 	}
 	else
 	{
@@ -685,235 +2606,172 @@ void RenderTarget::render()
 	{
 		Scene* scene = view->scene;
 		
-		// Create light arrays and render shadowmaps
-		float LightCount = (float)scene->lights.size();
-		std::vector< float > mLights;
-		std::vector< float > lightColors;
-		for( uint32_t l = 0; l < scene->lights.size(); l++)
-		{
-			Light* light = scene->lights[l];
-			mLights.push_back( light->getPose()._41 );
-			mLights.push_back( light->getPose()._42 );
-			mLights.push_back( light->getPose()._43 );
-			mLights.push_back( 1.0f );
-			lightColors.push_back( light->color.x );
-			lightColors.push_back( light->color.y );
-			lightColors.push_back( light->color.z );
-			lightColors.push_back( 1.0f );
-
-			glBindFramebuffer( GL_FRAMEBUFFER, light->shadowFrameBuffer );
-			for( uint32_t PostRender = 0; PostRender < 2; PostRender++ )
-			{
-				// Render Objects
-				for( uint32_t i = 0; i < scene->objects.size(); i++ )
-				{
-					std::vector<Matrix44> temp(1);
-					temp[0] = scene->objects[i]->getPose();
-					light->renderShadow( *scene->objects[i]->mesh, scene->objects[i]->getPose(), temp, !!PostRender );
-				}
-
-				// Render props
-				for( uint32_t i = 0; i < scene->props.size(); i++ )
-				{
-					light->renderShadow( *scene->props[i]->mesh, scene->props[i]->getPose(), scene->props[i]->matrices, !!PostRender );
-				}
-
-				// Render actors
-				for( uint32_t i = 0; i < scene->actors.size(); i++ )
-				{
-					if( scene->actors[i]->mesh )
-					{
-						light->renderShadow( *scene->actors[i]->mesh, scene->actors[i]->getPose(), scene->actors[i]->pose->matrices, !!PostRender );
-					}
-				}
+		// Camera and light values shared by every draw this frame.
+		frameConstants = getFrameConstants();
+
+		// Gather world bounds of objects, props and actors in that order and test them against
+		// the camera frustum once.
+		std::vector< AABB > bounds;
+		bounds.reserve( scene->objects.size() + scene->props.size() + scene->actors.size() );
+		for( uint32_t i = 0; i < scene->objects.size(); i++ )
+		{
+			bounds.push_back( scene->objects[i]->getBounds() );
+		}
+		for( uint32_t i = 0; i < scene->props.size(); i++ )
+		{
+			bounds.push_back( scene->props[i]->getBounds() );
+		}
+		for( uint32_t i = 0; i < scene->actors.size(); i++ )
+		{
+			if( scene->actors[i]->mesh )
+			{
+				bounds.push_back( scene->actors[i]->getBounds() );
 			}
-			glBindFramebuffer( GL_FRAMEBUFFER, 0 );
 		}
 
-		glBindFramebuffer( GL_FRAMEBUFFER, multiSampleFrameBuffer );
-
-		// Set the viewport to fit the window
-		glViewport( 0, 0, width, height );
-
-
-		// Clear depth buffer
-		glDepthMask( GL_TRUE );
-		glClear( GL_DEPTH_BUFFER_BIT );
-
-		if( scene->skyBox )
+		// Meshes drawn more than once last frame are skinned once for every pass of this one.
+		context->skinCache->beginRender( this );
+		for( uint32_t i = 0; i < scene->props.size(); i++ )
 		{
-			// Disable depth test
-			glDisable( GL_DEPTH_TEST );
-			glDepthMask( GL_FALSE );
-
-			glDisable( GL_MULTISAMPLE );
-
-			// Set skybox shader View variable
-			CGparameter CgView = cgGetNamedEffectParameter( context->defaultMedia->shaders[1]->effect, "View" );
-			Matrix44 tinvView = matrixTranspose( matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), view->getPose() ) );
-			cgGLSetMatrixParameterfc( CgView, (float*)&tinvView );
-
-			// Set skybox shader Projection variable
-			CGparameter CgProjection = cgGetNamedEffectParameter( context->defaultMedia->shaders[1]->effect, "Projection" );
-			Matrix44 tView = matrixTranspose( view->projMat );
-			cgGLSetMatrixParameterfc( CgProjection, (float*)&tView );
-
-			// Set skybox texture
-			CGparameter CgFSTexture = cgGetNamedEffectParameter( context->defaultMedia->shaders[1]->effect, "txSkybox" );
-			cgGLSetTextureParameter( CgFSTexture, scene->skyBox->image );
-			cgGLEnableTextureParameter( CgFSTexture );
-
-			// Bind vertex and index buffers
-			glBindBuffer( GL_ARRAY_BUFFER, context->defaultMedia->meshes[0]->vertexBuffer );
-			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, context->defaultMedia->meshes[0]->indexBuffers[0] );
-
-			// Set vertex attributes
-			glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (0) ) );
-			glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (12) ) );
-			glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (24) ) );
-			glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (32) ) );
-			glVertexAttribPointer( 4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), ( (char *)NULL + (48) ) );
-
-			// Enable vertex attributes
-			glEnableVertexAttribArray( 0 );
-			glEnableVertexAttribArray( 1 );
-			glEnableVertexAttribArray( 2 );
-			glEnableVertexAttribArray( 3 );
-			glEnableVertexAttribArray( 4 );
-
-			// Draw skybox
-			CGtechnique tech = cgGetFirstTechnique( context->defaultMedia->shaders[1]->effect );
-			CGpass pass = cgGetFirstPass( tech );
-			while( pass )
+			if( !scene->props[i]->matrices.empty() )
 			{
-				cgSetPassState( pass );
-				glDrawElements( GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0 );
-				cgResetPassState( pass );
-				pass = cgGetNextPass( pass );
+				context->skinCache->prepare( scene->props[i]->mesh, &scene->props[i]->matrices[0], scene->props[i]->matrices.size() );
 			}
-
-			// Disable vertex attributes
-			glDisableVertexAttribArray( 0 );
-			glDisableVertexAttribArray( 1 );
-			glDisableVertexAttribArray( 2 );
-			glDisableVertexAttribArray( 3 );
-			glDisableVertexAttribArray( 4 );
-			glBindBuffer( GL_ARRAY_BUFFER, 0 );
-			glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
-
-			cgGLDisableTextureParameter( CgFSTexture );
 		}
-		else
+		for( uint32_t i = 0; i < scene->actors.size(); i++ )
 		{
-			glClearColor( 0.0f, 0.0f, 1.0f, 0.0f );
-			glClear( GL_COLOR_BUFFER_BIT );
+			if( scene->actors[i]->mesh && !scene->actors[i]->pose->matrices.empty() )
+			{
+				context->skinCache->prepare( scene->actors[i]->mesh, &scene->actors[i]->pose->matrices[0], scene->actors[i]->pose->matrices.size() );
+			}
 		}
 
-		// Multisample.
-		if( multiSample )
+		// Shadow casters are culled against each layer's view with the same bounds.
+		renderShadows( bounds );
+
+		// The lights are listed by the cells they reach once their shadow layers are known.
+		clusters.build( context, frameConstants );
+
+		std::vector< char > visible( bounds.size(), 1 );
+		if( frustumCulling && !bounds.empty() )
 		{
-			glEnable( GL_MULTISAMPLE );
+			Frustum frustum = frustumMatrix( frameConstants.viewProj );
+			visibleCount = (uint32_t)frustumIntersectsAABBArray( frustum, &bounds[0], sizeof( AABB ), (bool*)&visible[0], bounds.size() );
 		}
 		else
 		{
-			glDisable( GL_MULTISAMPLE );
+			visibleCount = (uint32_t)bounds.size();
 		}
+		culledCount = (uint32_t)bounds.size() - visibleCount;
 
-		for( uint32_t PostRender = 0; PostRender < 2; PostRender++ )
+		// Queue every visible subset, the queue orders them by state and depth before drawing.
+		queue.clear();
+		uint32_t entry = 0;
+
+		// Queue objects, their single bone is their pose.
+		std::vector< Matrix44 > objectPoses( scene->objects.size() );
+		for( uint32_t i = 0; i < scene->objects.size(); i++ )
 		{
-			// Render Objects
-			for( uint32_t i = 0; i < scene->objects.size(); i++ )
+			if( visible[entry++] )
 			{
-				std::vector<Matrix44> temp(1);
-				temp[0] = scene->objects[i]->getPose();
-				renderMesh( *scene->objects[i]->mesh, scene->objects[i]->getPose(), temp, scene->objects[i]->materials, !!PostRender );
+				objectPoses[i] = scene->objects[i]->getPose();
+				queueMesh( frameConstants, *scene->objects[i]->mesh, objectPoses[i], &objectPoses[i], 1, scene->objects[i]->materials );
 			}
+		}
 
-			// Render props
-			for( uint32_t i = 0; i < scene->props.size(); i++ )
+		// Queue props
+		for( uint32_t i = 0; i < scene->props.size(); i++ )
+		{
+			if( visible[entry++] && !scene->props[i]->matrices.empty() )
 			{
-				renderMesh( *scene->props[i]->mesh, scene->props[i]->getPose(), scene->props[i]->matrices, scene->props[i]->materials, !!PostRender );
+				queueMesh( frameConstants, *scene->props[i]->mesh, scene->props[i]->getPose(), &scene->props[i]->matrices[0], scene->props[i]->matrices.size(), scene->props[i]->materials );
 			}
+		}
 
-			// Render actors
-			for( uint32_t i = 0; i < scene->actors.size(); i++ )
+		// Queue actors
+		for( uint32_t i = 0; i < scene->actors.size(); i++ )
+		{
+			if( scene->actors[i]->mesh && visible[entry++] && !scene->actors[i]->pose->matrices.empty() )
 			{
-				if( scene->actors[i]->mesh )
-				{
-					renderMesh( *scene->actors[i]->mesh, scene->actors[i]->getPose(), scene->actors[i]->pose->matrices, scene->actors[i]->materials, !!PostRender );
-				}
+				queueMesh( frameConstants, *scene->actors[i]->mesh, scene->actors[i]->getPose(), &scene->actors[i]->pose->matrices[0], scene->actors[i]->pose->matrices.size(), scene->actors[i]->materials );
 			}
 		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		glColor3f( 1.0f, 1.0f, 1.0f );
-		glDisable( GL_MULTISAMPLE );
-		glDisable( GL_DEPTH_TEST );
-		glDepthMask( GL_FALSE );
-		glDisable( GL_LIGHTING );
-		glEnable( GL_TEXTURE_2D );
-		glMatrixMode( GL_MODELVIEW );
-		glLoadIdentity();
-		glMatrixMode( GL_PROJECTION );
-		glLoadIdentity();
-
-		// Blit MultiSampleTexture to BaseTexture to apply effects.
-		glBindFramebuffer( GL_READ_FRAMEBUFFER, multiSampleFrameBuffer );
-		glBindFramebuffer( GL_DRAW_FRAMEBUFFER, effectFrameBuffer );
-		glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
-		glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0 );
-		glBlitFramebuffer( 0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST );
-		glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
-		glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+		effectWidth = width;
+		effectHeight = height;
+		frameRect = adjustedRect;
+		frameTargetHeight = windowRect.bottom - windowRect.top;
 
-		if( autoLuminance )
+		// Frame buffers belong to the GL context of the window, the textures attached to them
+		// are taken from the context's pool every render.
+		if( !multiSampleFrameBuffer )
 		{
-			renderAutoLuminance();
+			glGenFramebuffers( 1, &multiSampleFrameBuffer );
+			glGenFramebuffers( 1, &effectFrameBuffer );
 		}
 
-		if( bloom )
+		// Bloom pyramid, packed floats keep the bright range at half the bandwidth of half floats.
+		uint32_t levels = 0;
+		while( levels < (uint32_t)std::max( bloom, 0 ) && levels < 8 && ( width >> ( levels + 1 ) ) >= 4 && ( height >> ( levels + 1 ) ) >= 4 )
 		{
-			renderBloom();
+			levels++;
 		}
-
-		if( motionBlur )
+		bloomTextures.assign( levels, 0 );
+
+		graph.clear();
+		uint32_t sceneColor = graph.addTexture( TextureDesc( width, height, GL_RGBA, 4, false ), &colorBuffer );
+		uint32_t sceneDepth = graph.addTexture( TextureDesc( width, height, GL_DEPTH_COMPONENT32, 4, false ), &depthBuffer );
+		uint32_t primary = graph.addTexture( TextureDesc( width, height, GL_RGBA16F, 1, true ), &primaryTex );
+		uint32_t depth = graph.addTexture( TextureDesc( width, height, GL_DEPTH_COMPONENT32, 1, false ), &depthTexture );
+		std::vector< uint32_t > bloomLevels;
+		for( uint32_t l = 0; l < levels; l++ )
 		{
-			renderMotionBlur();
+			bloomLevels.push_back( graph.addTexture( TextureDesc( width >> ( l + 1 ), height >> ( l + 1 ), GL_R11F_G11F_B10F, 1, false ), &bloomTextures[l] ) );
 		}
 
-		glViewport( 0, 0, windowRect.right - windowRect.left, windowRect.bottom - windowRect.top );
+		uint32_t scenePass = graph.addPass( "scene", &RenderTarget::renderScene );
+		graph.write( scenePass, sceneColor );
+		graph.write( scenePass, sceneDepth );
 
-		// Get viewport
-		GLint iViewport[4];
-		glGetIntegerv( GL_VIEWPORT, iViewport );
+		uint32_t resolvePass = graph.addPass( "resolve", &RenderTarget::resolveScene );
+		graph.read( resolvePass, sceneColor );
+		graph.read( resolvePass, sceneDepth );
+		graph.write( resolvePass, primary );
+		if( motionBlur )
+		{
+			graph.write( resolvePass, depth );
+		}
 
-		glMatrixMode( GL_MODELVIEW );
-		glLoadIdentity();
-		glMatrixMode( GL_PROJECTION );
-		glLoadIdentity();
+		if( autoLuminance )
+		{
+			uint32_t luminancePass = graph.addPass( "autoLuminance", &RenderTarget::renderAutoLuminance );
+			graph.read( luminancePass, primary );
+		}
 
-		// Set up the orthographic projection
-		glOrtho( iViewport[0], iViewport[0] + iViewport[2], iViewport[1] + iViewport[3], iViewport[1], -1, 1 );
+		if( levels )
+		{
+			uint32_t bloomPass = graph.addPass( "bloom", &RenderTarget::renderBloom );
+			graph.read( bloomPass, primary );
+			for( uint32_t l = 0; l < levels; l++ )
+			{
+				graph.write( bloomPass, bloomLevels[l] );
+			}
+		}
 
-		if(hTex)
+		uint32_t compositePass = graph.addPass( "composite", &RenderTarget::renderComposite );
+		graph.read( compositePass, primary );
+		if( levels )
+		{
+			graph.read( compositePass, bloomLevels[0] );
+		}
+		if( motionBlur )
 		{
-			glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
-			glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hTex->image, 0 );
+			graph.read( compositePass, depth );
 		}
 
-		// Render to screen
-		glBindTexture( GL_TEXTURE_2D, primaryTex );
-		glBegin( GL_QUADS );
-		glTexCoord2i( 1, 1 );
-		glVertex2i( adjustedRect.right, adjustedRect.top );
-		glTexCoord2i( 0, 1 );
-		glVertex2i( adjustedRect.left, adjustedRect.top );
-		glTexCoord2i( 0, 0 );
-		glVertex2i( adjustedRect.left, adjustedRect.bottom );
-		glTexCoord2i( 1, 0 );
-		glVertex2i( adjustedRect.right, adjustedRect.bottom );
-		glEnd();
+		postPasses = 0;
+		postBandwidth = 0;
+		graph.execute( this, context->texturePool );
 	}
 
 	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
@@ -962,96 +2820,9 @@ void RenderTarget::render()
 
 void RenderTarget::update()
 {
-	SDL_GL_MakeCurrent( window->sdlWindow, window->windowContext );
-	Ovgl::Rect adjustedRect = windowAdjustedRect( window, &rect );
-
-	int width = (int)(adjustedRect.right - adjustedRect.left);
-	int height = (int)(adjustedRect.bottom - adjustedRect.top);
-
-	// Delete FrameBuffers and Textures
-	if(multiSampleFrameBuffer) glDeleteFramebuffers( 1, &multiSampleFrameBuffer );
-	if(effectFrameBuffer)glDeleteFramebuffers( 1, &effectFrameBuffer );
-	if(colorBuffer)glDeleteRenderbuffers( 1, &colorBuffer );
-	if(depthBuffer)glDeleteRenderbuffers( 1, &depthBuffer );
-	if(colorTexture)glDeleteTextures( 1, &colorTexture );
-	if(depthTexture)glDeleteTextures( 1, &depthTexture );
-	if(primaryTex)glDeleteTextures( 1, &primaryTex );
-	if(secondaryTex)glDeleteTextures( 1, &secondaryTex );
-	if(primaryBloomTex)glDeleteTextures( 1, &primaryBloomTex );
-	if(secondaryBloomTex)glDeleteTextures( 1, &secondaryBloomTex );
-
-	// Multi sample framebuffer
-	glGenFramebuffers( 1, &multiSampleFrameBuffer );
-	glBindFramebuffer( GL_FRAMEBUFFER, multiSampleFrameBuffer );
-
-	// Multi sample colorbuffer
-	glGenTextures( 1, &colorBuffer );
-	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, colorBuffer );
-	glTexImage2DMultisample( GL_TEXTURE_2D_MULTISAMPLE, 4, GL_RGBA, width, height, 0 );
-	glTexParameteri( GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D_MULTISAMPLE, colorBuffer, 0 );
-
-	// Multi sample depthbuffer
-	glGenTextures( 1, &depthBuffer );
-	glBindTexture( GL_TEXTURE_2D_MULTISAMPLE, depthBuffer );
-	glTexImage2DMultisample( GL_TEXTURE_2D_MULTISAMPLE, 4, GL_DEPTH_COMPONENT32, width, height, 0 );
-	glTexParameteri( GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D_MULTISAMPLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D_MULTISAMPLE, depthBuffer, 0 );
-
-	glBindRenderbuffer( GL_RENDERBUFFER, 0 );
-
-	// Effect framebuffer
-	glGenFramebuffers( 1, &effectFrameBuffer );
-	glBindFramebuffer( GL_FRAMEBUFFER, effectFrameBuffer );
-
-	// Create and bind textures
-	glGenTextures( 1, &depthTexture );
-	glBindTexture( GL_TEXTURE_2D, depthTexture );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0 );
-
-	glGenTextures( 1, &primaryTex );
-	glBindTexture( GL_TEXTURE_2D, primaryTex );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, maxLevel( width, height ) );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL );
-	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, primaryTex, 0 );
-
-	glGenTextures( 1, &secondaryTex );
-	glBindTexture( GL_TEXTURE_2D, secondaryTex );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
-
-	glGenTextures( 1, &primaryBloomTex );
-	glBindTexture( GL_TEXTURE_2D, primaryBloomTex );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width / 4, height / 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
-
-	glGenTextures( 1, &secondaryBloomTex );
-	glBindTexture( GL_TEXTURE_2D, secondaryBloomTex );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, width / 4, height / 4, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
-
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
-	SDL_GL_MakeCurrent( NULL, NULL );
+	// The render graph is built every render and takes its textures from the context's
+	// texture pool at the size of the area, so the next render already uses the new size.
+	// Textures of the old size are deleted by the pool once no render target uses them.
 }
 
 void RenderTarget::doEvent( Event event )
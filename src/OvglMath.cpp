@@ -20,263 +20,182 @@
 #include "OvglContext.h"
 #include "OvglMath.h"
 
-namespace Ovgl
-{
-Vector2::Vector2()
-{
-    x = 0.0f;
-    y = 0.0f;
-}
-
-Vector2::Vector2( float new_x, float new_y )
-{
-    x = new_x;
-    y = new_y;
-}
-
-float& Vector2::operator [] ( size_t index )
-{
-    return (&x)[index];
-}
-
-Vector2 Vector2::operator - ( const Vector2& in ) const
-{
-    Vector2 out;
-    out.x = x - in.x;
-    out.y = y - in.y;
-    return out;
-}
-
-Vector2 Vector2::operator / ( const float& in ) const
-{
-    Vector2 out;
-    out.x = x / in;
-    out.y = y / in;
-    return out;
-}
-
-bool Vector2::operator == ( const Vector2& in ) const
-{
-    if( in.x == x && in.y == y )
-        return true;
-    else
-        return false;
-}
-
-bool Vector2::operator != ( const Vector2& in ) const
-{
-    if( in.x ==x && in.y == y )
-        return true;
-    else
-        return false;
-}
-
-Vector3::Vector3()
-{
-    x = 0.0f;
-    y = 0.0f;
-    z = 0.0f;
-}
-
-Vector3::Vector3( float new_x, float new_y, float new_z )
-{
-    x = new_x;
-    y = new_y;
-    z = new_z;
-}
-
-float& Vector3::operator [] ( size_t index )
-{
-    return (&x)[index];
-}
-
-Vector3 Vector3::operator - ( const Vector3& in ) const
-{
-    Vector3 out;
-    out.x = x - in.x;
-    out.y = y - in.y;
-    out.z = z - in.z;
-    return out;
-}
-
-Vector3 Vector3::operator + ( const Vector3& in ) const
-{
-    Vector3 out;
-    out.x = x + in.x;
-    out.y = y + in.y;
-    out.z = z + in.z;
-    return out;
-}
-
-Vector3 Vector3::operator / ( const Vector3& in ) const
-{
-    Vector3 out;
-    out.x = x / in.x;
-    out.y = y / in.y;
-    out.z = z / in.z;
-    return out;
-}
-
-Vector3 Vector3::operator * ( const Vector3& in ) const
-{
-    Vector3 out;
-    out.x = x * in.x;
-    out.y = y * in.y;
-    out.z = z * in.z;
-    return out;
-}
-
-Vector3 Vector3::operator / ( const float& in ) const
-{
-    Vector3 out;
-    out.x = x / in;
-    out.y = y / in;
-    out.z = z / in;
-    return out;
-}
-
-Vector3 Vector3::operator * ( const float& in ) const
-{
-    Vector3 out;
-    out.x = x * in;
-    out.y = y * in;
-    out.z = z * in;
-    return out;
-}
-
-bool Vector3::operator == ( const Vector3& in ) const
-{
-    if( x == in.x && y == in.y && z == in.z )
-        return true;
-    else
-        return false;
-}
-
-bool Vector3::operator != ( const Vector3& in ) const
-{
-    if( x == in.x && y == in.y && z == in.z )
-        return true;
-    else
-        return false;
-}
-
-Vector4::Vector4()
-{
-    w = 0.0f;
-    x = 0.0f;
-    y = 0.0f;
-    z = 0.0f;
-}
-
-Vector4::Vector4( float new_x, float new_y, float new_z, float new_w )
-{
-    w = new_w;
-    x = new_x;
-    y = new_y;
-    z = new_z;
-}
-
-Vector4 Vector4::operator - ( const Vector4& in ) const
-{
-    Vector4 out;
-    out.w = w - in.w;
-    out.x = x - in.x;
-    out.y = y - in.y;
-    out.z = z - in.z;
-    return out;
-}
-
-Vector4 Vector4::operator + ( const Vector4& in ) const
-{
-    Vector4 out;
-    out.w = w + in.w;
-    out.x = x + in.x;
-    out.y = y + in.y;
-    out.z = z + in.z;
-    return out;
-}
-
-Vector4 Vector4::operator / ( const Vector4& in ) const
-{
-    Vector4 out;
-    out.w = w / in.w;
-    out.x = x / in.x;
-    out.y = y / in.y;
-    out.z = z / in.z;
-    return out;
-}
-
-Vector4 Vector4::operator * ( const Vector4& in ) const
-{
-    Vector4 out;
-    out.w = w * in.w;
-    out.x = x * in.x;
-    out.y = y * in.y;
-    out.z = z * in.z;
-    return out;
-}
-
-Vector4 Vector4::operator / ( const float& in ) const
-{
-    Vector4 out;
-    out.w = w / in;
-    out.x = x / in;
-    out.y = y / in;
-    out.z = z / in;
-    return out;
-}
-
-Vector4 Vector4::operator * ( const float& in ) const
-{
-    Vector4 out;
-    out.w = w * in;
-    out.x = x * in;
-    out.y = y * in;
-    out.z = z * in;
-    return out;
-}
+// Pick the widest instruction set the compiler was told it may use. Define
+// OVGL_NO_SIMD to force the portable scalar code on every platform.
+#if !defined( OVGL_NO_SIMD )
+#  if defined( __AVX__ )
+#    define OVGL_SIMD_AVX
+#    define OVGL_SIMD_SSE
+#  elif defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#    define OVGL_SIMD_SSE
+#  elif defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+#    define OVGL_SIMD_NEON
+#  endif
+#endif
+
+#if defined( OVGL_SIMD_AVX )
+#  include <immintrin.h>
+#elif defined( OVGL_SIMD_SSE )
+#  include <xmmintrin.h>
+#elif defined( OVGL_SIMD_NEON )
+#  include <arm_neon.h>
+#endif
 
-Matrix33::Matrix33()
-{
-    _11 = 1;
-    _12 = 0;
-    _13 = 0;
-
-    _21 = 0;
-	_22 = 1;
-    _23 = 0;
-
-    _31 = 0;
-    _32 = 0;
-    _33 = 1;
-}
-
-Matrix44::Matrix44()
+namespace Ovgl
 {
-    _11 = 1;
-    _12 = 0;
-    _13 = 0;
-    _14 = 0;
-
-    _21 = 0;
-	_22 = 1;
-    _23 = 0;
-    _24 = 0;
-
-    _31 = 0;
-    _32 = 0;
-    _33 = 1;
-    _34 = 0;
-
-    _41 = 0;
-    _42 = 0;
-    _43 = 0;
-    _44 = 1;
+#if defined( OVGL_SIMD_SSE )
+// Shuffle helpers used by the 4x4 inverse. Every swizzle is a plain SSE1 shuffle so no newer instruction sets are required.
+#define OVGL_SHUFFLE( a, b, x, y, z, w ) _mm_shuffle_ps( a, b, _MM_SHUFFLE( w, z, y, x ) )
+#define OVGL_SWIZZLE( a, x, y, z, w ) _mm_shuffle_ps( a, a, _MM_SHUFFLE( w, z, y, x ) )
+
+// Multiplies two 2x2 row major matrices packed as ( _11, _12, _21, _22 ).
+static inline __m128 matrix22Multiply( __m128 a, __m128 b )
+{
+    return _mm_add_ps( _mm_mul_ps( a, OVGL_SWIZZLE( b, 0, 3, 0, 3 ) ), _mm_mul_ps( OVGL_SWIZZLE( a, 1, 0, 3, 2 ), OVGL_SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+
+// Multiplies the adjugate of a with b.
+static inline __m128 matrix22AdjugateMultiply( __m128 a, __m128 b )
+{
+    return _mm_sub_ps( _mm_mul_ps( OVGL_SWIZZLE( a, 3, 3, 0, 0 ), b ), _mm_mul_ps( OVGL_SWIZZLE( a, 1, 1, 2, 2 ), OVGL_SWIZZLE( b, 2, 3, 0, 1 ) ) );
+}
+
+// Multiplies a with the adjugate of b.
+static inline __m128 matrix22MultiplyAdjugate( __m128 a, __m128 b )
+{
+    return _mm_sub_ps( _mm_mul_ps( a, OVGL_SWIZZLE( b, 3, 0, 3, 0 ) ), _mm_mul_ps( OVGL_SWIZZLE( a, 1, 0, 3, 2 ), OVGL_SWIZZLE( b, 2, 1, 2, 1 ) ) );
+}
+#endif
+
+// Programs built before the primitives moved into OvglMath.h call them out of line. Taking
+// each address here makes the compiler emit the inline definition into this object, and the
+// table's external linkage keeps it from being discarded, so the shared library still exports
+// every symbol. GCC emits the inline constructors too because this file is built with
+// -fkeep-inline-functions; a constructor's address cannot be taken.
+struct InlineMathSymbols
+{
+    Vector2 ( Vector2::*vector2Subtract )( const Vector2& ) const;
+    Vector2 ( Vector2::*vector2DivideScalar )( const float& ) const;
+    bool ( Vector2::*vector2Equal )( const Vector2& ) const;
+    bool ( Vector2::*vector2NotEqual )( const Vector2& ) const;
+    float& ( Vector2::*vector2Index )( size_t );
+    float& ( Vector3::*vector3Index )( size_t );
+    Vector3 ( Vector3::*vector3Subtract )( const Vector3& ) const;
+    Vector3 ( Vector3::*vector3Add )( const Vector3& ) const;
+    Vector3 ( Vector3::*vector3Divide )( const Vector3& ) const;
+    Vector3 ( Vector3::*vector3Multiply )( const Vector3& ) const;
+    Vector3 ( Vector3::*vector3DivideScalar )( const float& ) const;
+    Vector3 ( Vector3::*vector3MultiplyScalar )( const float& ) const;
+    bool ( Vector3::*vector3Equal )( const Vector3& ) const;
+    bool ( Vector3::*vector3NotEqual )( const Vector3& ) const;
+    float& ( Vector4::*vector4Index )( size_t );
+    Vector4 ( Vector4::*vector4Subtract )( const Vector4& ) const;
+    Vector4 ( Vector4::*vector4Add )( const Vector4& ) const;
+    Vector4 ( Vector4::*vector4Divide )( const Vector4& ) const;
+    Vector4 ( Vector4::*vector4Multiply )( const Vector4& ) const;
+    Vector4 ( Vector4::*vector4DivideScalar )( const float& ) const;
+    Vector4 ( Vector4::*vector4MultiplyScalar )( const float& ) const;
+    Vector3& ( Matrix33::*matrix33Index )( size_t ) const;
+    Vector4& ( Matrix44::*matrix44Index )( size_t ) const;
+    Vector4 ( *vector4Lerp )( const Vector4&, const Vector4&, float );
+    Vector3 ( *vector3Cross )( const Vector3&, const Vector3& );
+    Vector3 ( *vector3Transform )( const Vector3&, const Matrix44& );
+    float ( *vector3Dot )( const Vector3&, const Vector3& );
+    float ( *length )( const Vector3& );
+    float ( *distance )( const Vector3&, const Vector3& );
+    Vector3 ( *vector3Normalize )( const Vector3& );
+    float ( *lerp )( float, float, float );
+    float ( *degToRad )( float );
+};
+
+extern const InlineMathSymbols inlineMathSymbols;
+const InlineMathSymbols inlineMathSymbols =
+{
+    &Vector2::operator -, &Vector2::operator /, &Vector2::operator ==, &Vector2::operator !=, &Vector2::operator [],
+    &Vector3::operator [], &Vector3::operator -, &Vector3::operator +, &Vector3::operator /, &Vector3::operator *,
+    &Vector3::operator /, &Vector3::operator *, &Vector3::operator ==, &Vector3::operator !=,
+    &Vector4::operator [], &Vector4::operator -, &Vector4::operator +, &Vector4::operator /, &Vector4::operator *,
+    &Vector4::operator /, &Vector4::operator *,
+    &Matrix33::operator [], &Matrix44::operator [],
+    &vector4Lerp, &vector3Cross, &vector3Transform, &vector3Dot, &length, &distance, &vector3Normalize, &lerp, &degToRad
+};
+
+const char* mathInstructionSet()
+{
+#if defined( OVGL_SIMD_AVX )
+    return "AVX";
+#elif defined( OVGL_SIMD_SSE )
+    return "SSE";
+#elif defined( OVGL_SIMD_NEON )
+    return "NEON";
+#else
+    return "Scalar";
+#endif
 }
 
 Matrix44 Matrix44::operator * ( const Matrix44& in ) const
 {
     Matrix44 out;
+#if defined( OVGL_SIMD_AVX )
+    // Two rows of the result per 256 bit register. Each row is a sum of the rows of "in" weighted by one row of this matrix.
+    const float* a = &_11;
+    const float* b = &in._11;
+    __m256 b0 = _mm256_broadcast_ps( (const __m128*)( b ) );
+    __m256 b1 = _mm256_broadcast_ps( (const __m128*)( b + 4 ) );
+    __m256 b2 = _mm256_broadcast_ps( (const __m128*)( b + 8 ) );
+    __m256 b3 = _mm256_broadcast_ps( (const __m128*)( b + 12 ) );
+    for( int row = 0; row < 4; row += 2 )
+    {
+        // Splat each element of the two rows across its own 128 bit lane.
+        __m256 rows = _mm256_loadu_ps( a + row * 4 );
+        __m256 sum = _mm256_mul_ps( _mm256_permute_ps( rows, 0x00 ), b0 );
+        sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0x55 ), b1 ) );
+        sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0xAA ), b2 ) );
+        sum = _mm256_add_ps( sum, _mm256_mul_ps( _mm256_permute_ps( rows, 0xFF ), b3 ) );
+        _mm256_storeu_ps( &out._11 + row * 4, sum );
+    }
+#elif defined( OVGL_SIMD_SSE )
+    // Each row of the result is a sum of the rows of "in" weighted by one row of this matrix.
+    const float* a = &_11;
+    const float* b = &in._11;
+    __m128 b0 = _mm_loadu_ps( b );
+    __m128 b1 = _mm_loadu_ps( b + 4 );
+    __m128 b2 = _mm_loadu_ps( b + 8 );
+    __m128 b3 = _mm_loadu_ps( b + 12 );
+    __m128 rows[4];
+    for( int row = 0; row < 4; row++ )
+    {
+        __m128 sum = _mm_mul_ps( _mm_set1_ps( a[row * 4 + 0] ), b0 );
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( a[row * 4 + 1] ), b1 ) );
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( a[row * 4 + 2] ), b2 ) );
+        sum = _mm_add_ps( sum, _mm_mul_ps( _mm_set1_ps( a[row * 4 + 3] ), b3 ) );
+        rows[row] = sum;
+    }
+    for( int row = 0; row < 4; row++ )
+    {
+        _mm_storeu_ps( &out._11 + row * 4, rows[row] );
+    }
+#elif defined( OVGL_SIMD_NEON )
+    const float* a = &_11;
+    const float* b = &in._11;
+    float32x4_t b0 = vld1q_f32( b );
+    float32x4_t b1 = vld1q_f32( b + 4 );
+    float32x4_t b2 = vld1q_f32( b + 8 );
+    float32x4_t b3 = vld1q_f32( b + 12 );
+    float32x4_t rows[4];
+    for( int row = 0; row < 4; row++ )
+    {
+        float32x4_t sum = vmulq_n_f32( b0, a[row * 4 + 0] );
+        sum = vmlaq_n_f32( sum, b1, a[row * 4 + 1] );
+        sum = vmlaq_n_f32( sum, b2, a[row * 4 + 2] );
+        sum = vmlaq_n_f32( sum, b3, a[row * 4 + 3] );
+        rows[row] = sum;
+    }
+    for( int row = 0; row < 4; row++ )
+    {
+        vst1q_f32( &out._11 + row * 4, rows[row] );
+    }
+#else
 	Matrix44 mine = *this;
 	for( int row = 0; row < 4; row++)
 	{
@@ -285,6 +204,7 @@ Matrix44 Matrix44::operator * ( const Matrix44& in ) const
     		out[row][col] = mine[row][0] * in[0][col] + mine[row][1] * in[1][col] + mine[row][2] * in[2][col] + mine[row][3] * in[3][col];
 		}
 	}
+#endif
 	return out;
 }
 
@@ -407,6 +327,54 @@ Matrix44 matrixIdentity()
 Matrix44 matrixInverse ( const Vector4& in_vec, const Matrix44& in_mat)
 {
     Matrix44 out;
+#if defined( OVGL_SIMD_SSE )
+    // Block inverse: split the matrix into the 2x2 blocks | A B | and invert it through their adjugates.
+    //                                                     | C D |
+    __m128 row0 = _mm_loadu_ps( &in_mat._11 );
+    __m128 row1 = _mm_loadu_ps( &in_mat._21 );
+    __m128 row2 = _mm_loadu_ps( &in_mat._31 );
+    __m128 row3 = _mm_loadu_ps( &in_mat._41 );
+    __m128 a = _mm_movelh_ps( row0, row1 );
+    __m128 b = _mm_movehl_ps( row1, row0 );
+    __m128 c = _mm_movelh_ps( row2, row3 );
+    __m128 d = _mm_movehl_ps( row3, row2 );
+
+    // Determinants of all four blocks at once as ( |A|, |B|, |C|, |D| ).
+    __m128 detSub = _mm_sub_ps( _mm_mul_ps( OVGL_SHUFFLE( row0, row2, 0, 2, 0, 2 ), OVGL_SHUFFLE( row1, row3, 1, 3, 1, 3 ) ),
+                                _mm_mul_ps( OVGL_SHUFFLE( row0, row2, 1, 3, 1, 3 ), OVGL_SHUFFLE( row1, row3, 0, 2, 0, 2 ) ) );
+    __m128 detA = OVGL_SWIZZLE( detSub, 0, 0, 0, 0 );
+    __m128 detB = OVGL_SWIZZLE( detSub, 1, 1, 1, 1 );
+    __m128 detC = OVGL_SWIZZLE( detSub, 2, 2, 2, 2 );
+    __m128 detD = OVGL_SWIZZLE( detSub, 3, 3, 3, 3 );
+
+    __m128 dc = matrix22AdjugateMultiply( d, c );
+    __m128 ab = matrix22AdjugateMultiply( a, b );
+    __m128 x = _mm_sub_ps( _mm_mul_ps( detD, a ), matrix22Multiply( b, dc ) );
+    __m128 w = _mm_sub_ps( _mm_mul_ps( detA, d ), matrix22Multiply( c, ab ) );
+    __m128 y = _mm_sub_ps( _mm_mul_ps( detB, c ), matrix22MultiplyAdjugate( d, ab ) );
+    __m128 z = _mm_sub_ps( _mm_mul_ps( detC, b ), matrix22MultiplyAdjugate( a, dc ) );
+
+    // |M| = |A||D| + |B||C| - tr( A#B D#C )
+    __m128 trace = _mm_mul_ps( ab, OVGL_SWIZZLE( dc, 0, 2, 1, 3 ) );
+    trace = _mm_add_ps( trace, OVGL_SWIZZLE( trace, 2, 3, 0, 1 ) );
+    trace = _mm_add_ps( trace, OVGL_SWIZZLE( trace, 1, 0, 3, 2 ) );
+    __m128 det = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( detA, detD ), _mm_mul_ps( detB, detC ) ), trace );
+    if( _mm_cvtss_f32( det ) == 0.0f )
+        return out;
+
+    __m128 rcpDet = _mm_div_ps( _mm_setr_ps( 1.0f, -1.0f, -1.0f, 1.0f ), det );
+    x = _mm_mul_ps( x, rcpDet );
+    y = _mm_mul_ps( y, rcpDet );
+    z = _mm_mul_ps( z, rcpDet );
+    w = _mm_mul_ps( w, rcpDet );
+
+    // Apply the final adjugate swizzle while writing the blocks back out as rows.
+    _mm_storeu_ps( &out._11, OVGL_SHUFFLE( x, y, 3, 1, 3, 1 ) );
+    _mm_storeu_ps( &out._21, OVGL_SHUFFLE( x, y, 2, 0, 2, 0 ) );
+    _mm_storeu_ps( &out._31, OVGL_SHUFFLE( z, w, 3, 1, 3, 1 ) );
+    _mm_storeu_ps( &out._41, OVGL_SHUFFLE( z, w, 2, 0, 2, 0 ) );
+    return out;
+#else
     float inv[16], det;
     inv[0] =   in_mat._22*in_mat._33*in_mat._44 - in_mat._22*in_mat._34*in_mat._43 - in_mat._32*in_mat._23*in_mat._44
             + in_mat._32*in_mat._24*in_mat._43 + in_mat._42*in_mat._23*in_mat._34 - in_mat._42*in_mat._24*in_mat._33;
@@ -450,8 +418,101 @@ Matrix44 matrixInverse ( const Vector4& in_vec, const Matrix44& in_mat)
         for (int r = 0; r < 4; r++)
             out[c][r] = inv[(c*4) + r] * det;
     return out;
+#endif
 }
 
+Matrix44 matrixInverseRigid( const Matrix44& in_mat )
+{
+    // The inverse of a rotation is its transpose and the translation is moved back through it.
+    Matrix44 out;
+#if defined( OVGL_SIMD_SSE )
+    __m128 row0 = _mm_loadu_ps( &in_mat._11 );
+    __m128 row1 = _mm_loadu_ps( &in_mat._21 );
+    __m128 row2 = _mm_loadu_ps( &in_mat._31 );
+    __m128 row3 = _mm_setzero_ps();
+    __m128 translation = _mm_loadu_ps( &in_mat._41 );
+    _MM_TRANSPOSE4_PS( row0, row1, row2, row3 );
+    __m128 position = _mm_mul_ps( OVGL_SWIZZLE( translation, 0, 0, 0, 0 ), row0 );
+    position = _mm_add_ps( position, _mm_mul_ps( OVGL_SWIZZLE( translation, 1, 1, 1, 1 ), row1 ) );
+    position = _mm_add_ps( position, _mm_mul_ps( OVGL_SWIZZLE( translation, 2, 2, 2, 2 ), row2 ) );
+    position = _mm_sub_ps( _mm_setr_ps( 0.0f, 0.0f, 0.0f, 1.0f ), position );
+    _mm_storeu_ps( &out._11, row0 );
+    _mm_storeu_ps( &out._21, row1 );
+    _mm_storeu_ps( &out._31, row2 );
+    _mm_storeu_ps( &out._41, position );
+#else
+    out._11 = in_mat._11;
+    out._12 = in_mat._21;
+    out._13 = in_mat._31;
+    out._21 = in_mat._12;
+    out._22 = in_mat._22;
+    out._23 = in_mat._32;
+    out._31 = in_mat._13;
+    out._32 = in_mat._23;
+    out._33 = in_mat._33;
+    out._41 = -( in_mat._41 * in_mat._11 + in_mat._42 * in_mat._12 + in_mat._43 * in_mat._13 );
+    out._42 = -( in_mat._41 * in_mat._21 + in_mat._42 * in_mat._22 + in_mat._43 * in_mat._23 );
+    out._43 = -( in_mat._41 * in_mat._31 + in_mat._42 * in_mat._32 + in_mat._43 * in_mat._33 );
+#endif
+    return out;
+}
+
+Matrix44 matrixInverseAffine( const Matrix44& in_mat )
+{
+    // Only the upper 3x3 needs a real inverse, its cofactors are the cross products of its rows.
+    Matrix44 out;
+#if defined( OVGL_SIMD_SSE )
+    __m128 row0 = _mm_loadu_ps( &in_mat._11 );
+    __m128 row1 = _mm_loadu_ps( &in_mat._21 );
+    __m128 row2 = _mm_loadu_ps( &in_mat._31 );
+    __m128 translation = _mm_loadu_ps( &in_mat._41 );
+    __m128 cofactor0 = _mm_sub_ps( _mm_mul_ps( OVGL_SWIZZLE( row1, 1, 2, 0, 3 ), OVGL_SWIZZLE( row2, 2, 0, 1, 3 ) ), _mm_mul_ps( OVGL_SWIZZLE( row1, 2, 0, 1, 3 ), OVGL_SWIZZLE( row2, 1, 2, 0, 3 ) ) );
+    __m128 cofactor1 = _mm_sub_ps( _mm_mul_ps( OVGL_SWIZZLE( row2, 1, 2, 0, 3 ), OVGL_SWIZZLE( row0, 2, 0, 1, 3 ) ), _mm_mul_ps( OVGL_SWIZZLE( row2, 2, 0, 1, 3 ), OVGL_SWIZZLE( row0, 1, 2, 0, 3 ) ) );
+    __m128 cofactor2 = _mm_sub_ps( _mm_mul_ps( OVGL_SWIZZLE( row0, 1, 2, 0, 3 ), OVGL_SWIZZLE( row1, 2, 0, 1, 3 ) ), _mm_mul_ps( OVGL_SWIZZLE( row0, 2, 0, 1, 3 ), OVGL_SWIZZLE( row1, 1, 2, 0, 3 ) ) );
+    __m128 det = _mm_mul_ps( row0, cofactor0 );
+    det = _mm_add_ps( det, OVGL_SWIZZLE( det, 2, 3, 0, 1 ) );
+    det = _mm_add_ps( det, OVGL_SWIZZLE( det, 1, 0, 3, 2 ) );
+    if( _mm_cvtss_f32( det ) == 0.0f )
+        return out;
+
+    __m128 rcpDet = _mm_div_ps( _mm_set1_ps( 1.0f ), det );
+    __m128 row3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS( cofactor0, cofactor1, cofactor2, row3 );
+    cofactor0 = _mm_mul_ps( cofactor0, rcpDet );
+    cofactor1 = _mm_mul_ps( cofactor1, rcpDet );
+    cofactor2 = _mm_mul_ps( cofactor2, rcpDet );
+    __m128 position = _mm_mul_ps( OVGL_SWIZZLE( translation, 0, 0, 0, 0 ), cofactor0 );
+    position = _mm_add_ps( position, _mm_mul_ps( OVGL_SWIZZLE( translation, 1, 1, 1, 1 ), cofactor1 ) );
+    position = _mm_add_ps( position, _mm_mul_ps( OVGL_SWIZZLE( translation, 2, 2, 2, 2 ), cofactor2 ) );
+    position = _mm_sub_ps( _mm_setr_ps( 0.0f, 0.0f, 0.0f, 1.0f ), position );
+    _mm_storeu_ps( &out._11, cofactor0 );
+    _mm_storeu_ps( &out._21, cofactor1 );
+    _mm_storeu_ps( &out._31, cofactor2 );
+    _mm_storeu_ps( &out._41, position );
+#else
+    float c11 = in_mat._22 * in_mat._33 - in_mat._23 * in_mat._32;
+    float c12 = in_mat._23 * in_mat._31 - in_mat._21 * in_mat._33;
+    float c13 = in_mat._21 * in_mat._32 - in_mat._22 * in_mat._31;
+    float det = in_mat._11 * c11 + in_mat._12 * c12 + in_mat._13 * c13;
+    if( det == 0.0f )
+        return out;
+
+    det = 1.0f / det;
+    out._11 = c11 * det;
+    out._21 = c12 * det;
+    out._31 = c13 * det;
+    out._12 = ( in_mat._13 * in_mat._32 - in_mat._12 * in_mat._33 ) * det;
+    out._22 = ( in_mat._11 * in_mat._33 - in_mat._13 * in_mat._31 ) * det;
+    out._32 = ( in_mat._12 * in_mat._31 - in_mat._11 * in_mat._32 ) * det;
+    out._13 = ( in_mat._12 * in_mat._23 - in_mat._13 * in_mat._22 ) * det;
+    out._23 = ( in_mat._13 * in_mat._21 - in_mat._11 * in_mat._23 ) * det;
+    out._33 = ( in_mat._11 * in_mat._22 - in_mat._12 * in_mat._21 ) * det;
+    out._41 = -( in_mat._41 * out._11 + in_mat._42 * out._21 + in_mat._43 * out._31 );
+    out._42 = -( in_mat._41 * out._12 + in_mat._42 * out._22 + in_mat._43 * out._32 );
+    out._43 = -( in_mat._41 * out._13 + in_mat._42 * out._23 + in_mat._43 * out._33 );
+#endif
+    return out;
+}
 
 Matrix44 matrixScaling( float x, float y, float z )
 {
@@ -603,6 +664,28 @@ Matrix44 matrixPerspectiveLH( float fov, float aspect, float zn, float zf)
     return out;
 }
 
+Matrix44 matrixOrthoOffCenterLH( float l, float r, float b, float t, float zn, float zf )
+{
+    Matrix44 out;
+    out._11 = 2 / (r - l);
+    out._12 = 0;
+    out._13 = 0;
+    out._14 = 0;
+    out._21 = 0;
+    out._22 = 2 / (t - b);
+    out._23 = 0;
+    out._24 = 0;
+    out._31 = 0;
+    out._32 = 0;
+    out._33 = 1 / (zf - zn);
+    out._34 = 0;
+    out._41 = (l + r) / (l - r);
+    out._42 = (t + b) / (b - t);
+    out._43 = zn / (zn - zf);
+    out._44 = 1;
+    return out;
+}
+
 Matrix44 matrixRotationQuaternion( const Vector4& q )
 {
     Matrix44 out;
@@ -676,6 +759,157 @@ Matrix44 matrixSwapXZ( const Matrix44& in_mat )
     return out;
 }
 
+Transform::Transform()
+{
+    rotation = Vector4( 0.0f, 0.0f, 0.0f, 1.0f );
+    translation = Vector3( 0.0f, 0.0f, 0.0f );
+    scale = Vector3( 1.0f, 1.0f, 1.0f );
+}
+
+Transform::Transform( const Vector4& newRotation, const Vector3& newTranslation, const Vector3& newScale )
+{
+    rotation = newRotation;
+    translation = newTranslation;
+    scale = newScale;
+}
+
+Transform Transform::operator * ( const Transform& in ) const
+{
+    // Apply this transform first and then the given one, like a matrix product.
+    Transform out;
+    out.rotation = quaternionMultiply( rotation, in.rotation );
+    out.translation = vector3Rotate( translation * in.scale, in.rotation ) + in.translation;
+    out.scale = scale * in.scale;
+    return out;
+}
+
+Matrix44 matrixTransform( const Transform& transform )
+{
+    Matrix44 out = matrixRotationQuaternion( transform.rotation );
+    out._11 *= transform.scale.x; out._12 *= transform.scale.x; out._13 *= transform.scale.x;
+    out._21 *= transform.scale.y; out._22 *= transform.scale.y; out._23 *= transform.scale.y;
+    out._31 *= transform.scale.z; out._32 *= transform.scale.z; out._33 *= transform.scale.z;
+    out._41 = transform.translation.x; out._42 = transform.translation.y; out._43 = transform.translation.z;
+    return out;
+}
+
+Transform transformMatrix( const Matrix44& matrix )
+{
+    Transform out;
+    out.translation = Vector3( matrix._41, matrix._42, matrix._43 );
+    out.scale.x = length( Vector3( matrix._11, matrix._12, matrix._13 ) );
+    out.scale.y = length( Vector3( matrix._21, matrix._22, matrix._23 ) );
+    out.scale.z = length( Vector3( matrix._31, matrix._32, matrix._33 ) );
+    if( out.scale.x == 0.0f || out.scale.y == 0.0f || out.scale.z == 0.0f )
+        return out;
+
+    // A mirrored basis is stored as a negative scale on the x axis.
+    Vector3 row0 = Vector3( matrix._11, matrix._12, matrix._13 );
+    if( vector3Dot( vector3Cross( row0, Vector3( matrix._21, matrix._22, matrix._23 ) ), Vector3( matrix._31, matrix._32, matrix._33 ) ) < 0.0f )
+    {
+        out.scale.x = -out.scale.x;
+    }
+
+    float m11 = matrix._11 / out.scale.x, m12 = matrix._12 / out.scale.x, m13 = matrix._13 / out.scale.x;
+    float m21 = matrix._21 / out.scale.y, m22 = matrix._22 / out.scale.y, m23 = matrix._23 / out.scale.y;
+    float m31 = matrix._31 / out.scale.z, m32 = matrix._32 / out.scale.z, m33 = matrix._33 / out.scale.z;
+
+    // Pick the largest diagonal term to keep the square root well away from zero.
+    float trace = m11 + m22 + m33;
+    if( trace > 0.0f )
+    {
+        float s = 0.5f / sqrt( trace + 1.0f );
+        out.rotation.w = 0.25f / s;
+        out.rotation.x = ( m23 - m32 ) * s;
+        out.rotation.y = ( m31 - m13 ) * s;
+        out.rotation.z = ( m12 - m21 ) * s;
+    }
+    else if( m11 > m22 && m11 > m33 )
+    {
+        float s = 2.0f * sqrt( 1.0f + m11 - m22 - m33 );
+        out.rotation.w = ( m23 - m32 ) / s;
+        out.rotation.x = 0.25f * s;
+        out.rotation.y = ( m21 + m12 ) / s;
+        out.rotation.z = ( m31 + m13 ) / s;
+    }
+    else if( m22 > m33 )
+    {
+        float s = 2.0f * sqrt( 1.0f + m22 - m11 - m33 );
+        out.rotation.w = ( m31 - m13 ) / s;
+        out.rotation.x = ( m21 + m12 ) / s;
+        out.rotation.y = 0.25f * s;
+        out.rotation.z = ( m32 + m23 ) / s;
+    }
+    else
+    {
+        float s = 2.0f * sqrt( 1.0f + m33 - m11 - m22 );
+        out.rotation.w = ( m12 - m21 ) / s;
+        out.rotation.x = ( m31 + m13 ) / s;
+        out.rotation.y = ( m32 + m23 ) / s;
+        out.rotation.z = 0.25f * s;
+    }
+    out.rotation = quaternionNormalize( out.rotation );
+    return out;
+}
+
+Transform transformInverse( const Transform& transform )
+{
+    Transform out;
+    out.rotation = quaternionConjugate( transform.rotation );
+    out.scale = Vector3( 1.0f / transform.scale.x, 1.0f / transform.scale.y, 1.0f / transform.scale.z );
+    out.translation = vector3Rotate( Vector3( 0.0f, 0.0f, 0.0f ) - transform.translation, out.rotation ) * out.scale;
+    return out;
+}
+
+Transform transformNlerp( const Transform& t1, const Transform& t2, float u )
+{
+    Transform out;
+    out.rotation = nlerp( t1.rotation, t2.rotation, u );
+    out.translation = t1.translation + ( t2.translation - t1.translation ) * u;
+    out.scale = t1.scale + ( t2.scale - t1.scale ) * u;
+    return out;
+}
+
+Transform transformSlerp( const Transform& t1, const Transform& t2, float u )
+{
+    Transform out;
+    out.rotation = slerp( t1.rotation, t2.rotation, u );
+    out.translation = t1.translation + ( t2.translation - t1.translation ) * u;
+    out.scale = t1.scale + ( t2.scale - t1.scale ) * u;
+    return out;
+}
+
+Vector4 quaternionMultiply( const Vector4& q1, const Vector4& q2 )
+{
+    // Hamilton product q2 * q1, which rotates by q1 first.
+    Vector4 out;
+    out.w = q2.w * q1.w - q2.x * q1.x - q2.y * q1.y - q2.z * q1.z;
+    out.x = q2.w * q1.x + q2.x * q1.w + q2.y * q1.z - q2.z * q1.y;
+    out.y = q2.w * q1.y - q2.x * q1.z + q2.y * q1.w + q2.z * q1.x;
+    out.z = q2.w * q1.z + q2.x * q1.y - q2.y * q1.x + q2.z * q1.w;
+    return out;
+}
+
+Vector4 quaternionConjugate( const Vector4& q )
+{
+    return Vector4( -q.x, -q.y, -q.z, q.w );
+}
+
+Vector4 quaternionNormalize( const Vector4& q )
+{
+    float l = sqrt( q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w );
+    if( l == 0.0f )
+        return Vector4( 0.0f, 0.0f, 0.0f, 1.0f );
+    return q * ( 1.0f / l );
+}
+
+Vector4 nlerp( const Vector4& q1, const Vector4& q2, float t )
+{
+    float dot = q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+    Vector4 target = ( dot < 0.0f ) ? q2 * -1.0f : q2;
+    return quaternionNormalize( q1 + ( target - q1 ) * t );
+}
+
 Vector4 quaternionRotationMatrix( const Matrix44& matrix )
 {
     Vector4 out;
@@ -738,78 +972,233 @@ Vector3 eulerRotationMatrix( Matrix44& matrix )
     return out;
 }
 
-float& Vector4::operator [] ( size_t index )
+void Vector3::toDoubles( double* data )
 {
-    return (&x)[index];
+    data[0] = (double)x;
+    data[1] = (double)y;
+    data[2] = (double)z;
 }
 
-Vector3& Matrix33::operator [] ( size_t index ) const
+void Vector3::fromDoubles( double* data )
 {
-    return (Vector3&)*((Vector3*)((&_11) + (index * 3)));
+    x = (float)data[0];
+    y = (float)data[1];
+    z = (float)data[2];
 }
 
-Vector4& Matrix44::operator [] ( size_t index ) const
+// Steps a vector pointer by a stride given in bytes.
+#define OVGL_STRIDE( type, pointer, stride, index ) ( (type*)( (char*)( pointer ) + ( stride ) * ( index ) ) )
+
+void vector3TransformArray( const Matrix44& matrix, const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count )
 {
-    return (Vector4&)*((Vector4*)((&_11) + (index * 4)));
+#if defined( OVGL_SIMD_SSE )
+    // Each point becomes a weighted sum of the matrix rows, one point per register.
+    __m128 row0 = _mm_loadu_ps( &matrix._11 );
+    __m128 row1 = _mm_loadu_ps( &matrix._21 );
+    __m128 row2 = _mm_loadu_ps( &matrix._31 );
+    __m128 row3 = _mm_loadu_ps( &matrix._41 );
+    for( size_t i = 0; i < count; i++ )
+    {
+        const Vector3* src = OVGL_STRIDE( const Vector3, in, inStride, i );
+        Vector3* dst = OVGL_STRIDE( Vector3, out, outStride, i );
+        __m128 result = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( src->x ), row0 ), row3 );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_set1_ps( src->y ), row1 ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_set1_ps( src->z ), row2 ) );
+        _mm_storel_pi( (__m64*)&dst->x, result );
+        _mm_store_ss( &dst->z, _mm_movehl_ps( result, result ) );
+    }
+#else
+    for( size_t i = 0; i < count; i++ )
+    {
+        *OVGL_STRIDE( Vector3, out, outStride, i ) = vector3Transform( *OVGL_STRIDE( const Vector3, in, inStride, i ), matrix );
+    }
+#endif
 }
 
-void Vector3::toDoubles( double* data )
+void vector3TransformNormalArray( const Matrix44& matrix, const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count )
 {
-    data[0] = (double)x;
-    data[1] = (double)y;
-    data[2] = (double)z;
+#if defined( OVGL_SIMD_SSE )
+    __m128 row0 = _mm_loadu_ps( &matrix._11 );
+    __m128 row1 = _mm_loadu_ps( &matrix._21 );
+    __m128 row2 = _mm_loadu_ps( &matrix._31 );
+    for( size_t i = 0; i < count; i++ )
+    {
+        const Vector3* src = OVGL_STRIDE( const Vector3, in, inStride, i );
+        Vector3* dst = OVGL_STRIDE( Vector3, out, outStride, i );
+        __m128 result = _mm_mul_ps( _mm_set1_ps( src->x ), row0 );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_set1_ps( src->y ), row1 ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_set1_ps( src->z ), row2 ) );
+        _mm_storel_pi( (__m64*)&dst->x, result );
+        _mm_store_ss( &dst->z, _mm_movehl_ps( result, result ) );
+    }
+#else
+    for( size_t i = 0; i < count; i++ )
+    {
+        const Vector3* src = OVGL_STRIDE( const Vector3, in, inStride, i );
+        Vector3 result;
+        result.x = src->x * matrix._11 + src->y * matrix._21 + src->z * matrix._31;
+        result.y = src->x * matrix._12 + src->y * matrix._22 + src->z * matrix._32;
+        result.z = src->x * matrix._13 + src->y * matrix._23 + src->z * matrix._33;
+        *OVGL_STRIDE( Vector3, out, outStride, i ) = result;
+    }
+#endif
 }
 
-void Vector3::fromDoubles( double* data )
+void vector3TransformStreams( const Matrix44& matrix, const float* inX, const float* inY, const float* inZ, float* outX, float* outY, float* outZ, size_t count, bool normals )
 {
-    x = (float)data[0];
-    y = (float)data[1];
-    z = (float)data[2];
+    float w = normals ? 0.0f : 1.0f;
+    size_t i = 0;
+#if defined( OVGL_SIMD_SSE )
+    // Four points per register, every matrix element is splatted once up front.
+    __m128 m11 = _mm_set1_ps( matrix._11 ), m12 = _mm_set1_ps( matrix._12 ), m13 = _mm_set1_ps( matrix._13 );
+    __m128 m21 = _mm_set1_ps( matrix._21 ), m22 = _mm_set1_ps( matrix._22 ), m23 = _mm_set1_ps( matrix._23 );
+    __m128 m31 = _mm_set1_ps( matrix._31 ), m32 = _mm_set1_ps( matrix._32 ), m33 = _mm_set1_ps( matrix._33 );
+    __m128 m41 = _mm_set1_ps( matrix._41 * w ), m42 = _mm_set1_ps( matrix._42 * w ), m43 = _mm_set1_ps( matrix._43 * w );
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( inX + i );
+        __m128 y = _mm_loadu_ps( inY + i );
+        __m128 z = _mm_loadu_ps( inZ + i );
+        __m128 rx = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m11 ), m41 ), _mm_add_ps( _mm_mul_ps( y, m21 ), _mm_mul_ps( z, m31 ) ) );
+        __m128 ry = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m12 ), m42 ), _mm_add_ps( _mm_mul_ps( y, m22 ), _mm_mul_ps( z, m32 ) ) );
+        __m128 rz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m13 ), m43 ), _mm_add_ps( _mm_mul_ps( y, m23 ), _mm_mul_ps( z, m33 ) ) );
+        _mm_storeu_ps( outX + i, rx );
+        _mm_storeu_ps( outY + i, ry );
+        _mm_storeu_ps( outZ + i, rz );
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        float x = inX[i], y = inY[i], z = inZ[i];
+        outX[i] = x * matrix._11 + y * matrix._21 + z * matrix._31 + matrix._41 * w;
+        outY[i] = x * matrix._12 + y * matrix._22 + z * matrix._32 + matrix._42 * w;
+        outZ[i] = x * matrix._13 + y * matrix._23 + z * matrix._33 + matrix._43 * w;
+    }
 }
 
-float length( const Vector3& vector )
+void vector3NormalizeArray( const Vector3* in, size_t inStride, Vector3* out, size_t outStride, size_t count )
 {
-	return sqrt((vector.x * vector.x) + (vector.y * vector.y) + (vector.z * vector.z));
+    size_t i = 0;
+#if defined( OVGL_SIMD_SSE )
+    // Gather four vectors into x, y and z registers so one square root serves all of them.
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const Vector3* a = OVGL_STRIDE( const Vector3, in, inStride, i );
+        const Vector3* b = OVGL_STRIDE( const Vector3, in, inStride, i + 1 );
+        const Vector3* c = OVGL_STRIDE( const Vector3, in, inStride, i + 2 );
+        const Vector3* d = OVGL_STRIDE( const Vector3, in, inStride, i + 3 );
+        __m128 x = _mm_setr_ps( a->x, b->x, c->x, d->x );
+        __m128 y = _mm_setr_ps( a->y, b->y, c->y, d->y );
+        __m128 z = _mm_setr_ps( a->z, b->z, c->z, d->z );
+        __m128 l = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ), _mm_mul_ps( z, z ) ) );
+        __m128 valid = _mm_cmpgt_ps( l, _mm_setzero_ps() );
+        __m128 scale = _mm_or_ps( _mm_and_ps( valid, _mm_div_ps( _mm_set1_ps( 1.0f ), l ) ), _mm_andnot_ps( valid, _mm_set1_ps( 1.0f ) ) );
+        float xs[4], ys[4], zs[4];
+        _mm_storeu_ps( xs, _mm_mul_ps( x, scale ) );
+        _mm_storeu_ps( ys, _mm_mul_ps( y, scale ) );
+        _mm_storeu_ps( zs, _mm_mul_ps( z, scale ) );
+        for( size_t j = 0; j < 4; j++ )
+        {
+            Vector3* dst = OVGL_STRIDE( Vector3, out, outStride, i + j );
+            dst->x = xs[j];
+            dst->y = ys[j];
+            dst->z = zs[j];
+        }
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        Vector3 vector = *OVGL_STRIDE( const Vector3, in, inStride, i );
+        float l = length( vector );
+        *OVGL_STRIDE( Vector3, out, outStride, i ) = ( l > 0.0f ) ? vector * ( 1.0f / l ) : vector;
+    }
 }
 
-float distance( const Vector3& vector1, const Vector3& vector2 )
+void vector3NormalizeStreams( float* x, float* y, float* z, size_t count )
 {
-    Vector3 vector = vector1 - vector2;
-    float out = length( vector );
-	return out;
+    size_t i = 0;
+#if defined( OVGL_SIMD_SSE )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 vx = _mm_loadu_ps( x + i );
+        __m128 vy = _mm_loadu_ps( y + i );
+        __m128 vz = _mm_loadu_ps( z + i );
+        __m128 l = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( vx, vx ), _mm_mul_ps( vy, vy ) ), _mm_mul_ps( vz, vz ) ) );
+        __m128 valid = _mm_cmpgt_ps( l, _mm_setzero_ps() );
+        __m128 scale = _mm_or_ps( _mm_and_ps( valid, _mm_div_ps( _mm_set1_ps( 1.0f ), l ) ), _mm_andnot_ps( valid, _mm_set1_ps( 1.0f ) ) );
+        _mm_storeu_ps( x + i, _mm_mul_ps( vx, scale ) );
+        _mm_storeu_ps( y + i, _mm_mul_ps( vy, scale ) );
+        _mm_storeu_ps( z + i, _mm_mul_ps( vz, scale ) );
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        float l = sqrt( x[i] * x[i] + y[i] * y[i] + z[i] * z[i] );
+        if( l > 0.0f )
+        {
+            float scale = 1.0f / l;
+            x[i] *= scale;
+            y[i] *= scale;
+            z[i] *= scale;
+        }
+    }
 }
 
-float vector3Dot( const Vector3& vec1, const Vector3& vec2 )
+void vector3DotArray( const Vector3* vec1, size_t stride1, const Vector3* vec2, size_t stride2, float* out, size_t count )
 {
-    return vec1.x * vec2.x + vec1.y * vec2.y + vec1.z * vec2.z;
+    size_t i = 0;
+#if defined( OVGL_SIMD_SSE )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const Vector3* a0 = OVGL_STRIDE( const Vector3, vec1, stride1, i );
+        const Vector3* a1 = OVGL_STRIDE( const Vector3, vec1, stride1, i + 1 );
+        const Vector3* a2 = OVGL_STRIDE( const Vector3, vec1, stride1, i + 2 );
+        const Vector3* a3 = OVGL_STRIDE( const Vector3, vec1, stride1, i + 3 );
+        const Vector3* b0 = OVGL_STRIDE( const Vector3, vec2, stride2, i );
+        const Vector3* b1 = OVGL_STRIDE( const Vector3, vec2, stride2, i + 1 );
+        const Vector3* b2 = OVGL_STRIDE( const Vector3, vec2, stride2, i + 2 );
+        const Vector3* b3 = OVGL_STRIDE( const Vector3, vec2, stride2, i + 3 );
+        __m128 result = _mm_mul_ps( _mm_setr_ps( a0->x, a1->x, a2->x, a3->x ), _mm_setr_ps( b0->x, b1->x, b2->x, b3->x ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_setr_ps( a0->y, a1->y, a2->y, a3->y ), _mm_setr_ps( b0->y, b1->y, b2->y, b3->y ) ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_setr_ps( a0->z, a1->z, a2->z, a3->z ), _mm_setr_ps( b0->z, b1->z, b2->z, b3->z ) ) );
+        _mm_storeu_ps( out + i, result );
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        out[i] = vector3Dot( *OVGL_STRIDE( const Vector3, vec1, stride1, i ), *OVGL_STRIDE( const Vector3, vec2, stride2, i ) );
+    }
 }
 
-Vector3 vector3Cross( const Vector3& vec1, const Vector3& vec2 )
+void vector3DotStreams( const float* x1, const float* y1, const float* z1, const float* x2, const float* y2, const float* z2, float* out, size_t count )
 {
-    Vector3 out;
-    out.x = vec1.y * vec2.z - vec2.y * vec1.z;
-    out.y = vec1.z * vec2.x - vec2.z * vec1.x;
-    out.z = vec1.x * vec2.y - vec2.x * vec1.y;
-    return out;
+    size_t i = 0;
+#if defined( OVGL_SIMD_SSE )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 result = _mm_mul_ps( _mm_loadu_ps( x1 + i ), _mm_loadu_ps( x2 + i ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_loadu_ps( y1 + i ), _mm_loadu_ps( y2 + i ) ) );
+        result = _mm_add_ps( result, _mm_mul_ps( _mm_loadu_ps( z1 + i ), _mm_loadu_ps( z2 + i ) ) );
+        _mm_storeu_ps( out + i, result );
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        out[i] = x1[i] * x2[i] + y1[i] * y2[i] + z1[i] * z2[i];
+    }
 }
 
-Vector3 vector3Transform( const Vector3& vector, const Matrix44& matrix )
+Vector3 vector3Rotate( const Vector3& vector, const Vector4& q )
 {
-    Vector3 out;
-    out.x = vector.x * matrix._11 + vector.y * matrix._21 + vector.z * matrix._31 + matrix._41;
-    out.y = vector.x * matrix._12 + vector.y * matrix._22 + vector.z * matrix._32 + matrix._42;
-    out.z = vector.x * matrix._13 + vector.y * matrix._23 + vector.z * matrix._33 + matrix._43;
-    return out;
+    // v + 2w( u x v ) + 2u x ( u x v ) where u is the vector part of the quaternion.
+    Vector3 u( q.x, q.y, q.z );
+    Vector3 t = vector3Cross( u, vector ) * 2.0f;
+    return vector + t * q.w + vector3Cross( u, t );
 }
 
-Vector3 vector3Normalize( const Vector3& vector )
+Vector3 vector3Transform( const Vector3& vector, const Transform& transform )
 {
-    Vector3 out;
-    float l = length( vector );
-    out.x = vector.x / l;
-    out.y = vector.y / l;
-    out.z = vector.z / l;
-    return out;
+    return vector3Rotate( vector * transform.scale, transform.rotation ) + transform.translation;
 }
 
 Vector3 vector3Center( std::vector< Vector3 >& vertices )
@@ -825,21 +1214,11 @@ Vector3 vector3Center( std::vector< Vector3 >& vertices )
     return out;
 }
 
-Vector4 vector4Lerp( Vector4& vec1, Vector4& vec2, float u )
-{
-    return (vec1 * (1 - u)) + (vec2 * u);
-}
-
 float round( float expression, int32_t numdecimalplaces )
 {
     return floorf( expression * pow(10.0f, numdecimalplaces ) ) / pow( 10.0f, numdecimalplaces );
 }
 
-float lerp( float val1, float val2, float u )
-{
-    return ( val1 * (1 - u) ) + ( val2 * u );
-}
-
 Vector4 slerp( const Vector4& q1, const Vector4& q2, float t )
 {
 
@@ -851,12 +1230,12 @@ Vector4 slerp( const Vector4& q1, const Vector4& q2, float t )
 
     if( cosHalfTheta < 0 )
     {
-        qt.w = -qt.w; qt.x = -qt.x; qt.y = -qt.y; qt.z = qt.z;
+        qt.w = -qt.w; qt.x = -qt.x; qt.y = -qt.y; qt.z = -qt.z;
         cosHalfTheta = -cosHalfTheta;
     }
 
 
-    if( abs(cosHalfTheta) >= 1.0f )
+    if( fabs(cosHalfTheta) >= 1.0f )
 	{
         qm.w = q1.w;qm.x = q1.x;qm.y = q1.y;qm.z = q1.z;
         return qm;
@@ -884,11 +1263,6 @@ Vector4 slerp( const Vector4& q1, const Vector4& q2, float t )
     return qm;
 }
 
-float degToRad( float degree )
-{
-    return degree * ( (float)OvglPi ) / 180.0f;
-}
-
 float volumeTetrahedron( const Vector3& vector1, const Vector3& vector2, const Vector3& vector3, const Vector3& vector4 )
 {
     float width = distance( vector1, vector2 );
@@ -927,4 +1301,375 @@ void vector3Box( std::vector< Ovgl::Vector3 >& vectors, Ovgl::Vector3* min, Ovgl
         }
     }
 }
+
+AABB::AABB()
+{
+}
+
+AABB::AABB( const Vector3& newMin, const Vector3& newMax )
+{
+    min = newMin;
+    max = newMax;
+}
+
+Vector3 AABB::center() const
+{
+    return Vector3( ( min.x + max.x ) * 0.5f, ( min.y + max.y ) * 0.5f, ( min.z + max.z ) * 0.5f );
+}
+
+Vector3 AABB::extents() const
+{
+    return Vector3( ( max.x - min.x ) * 0.5f, ( max.y - min.y ) * 0.5f, ( max.z - min.z ) * 0.5f );
+}
+
+BoundingSphere::BoundingSphere()
+{
+    radius = 0.0f;
+}
+
+BoundingSphere::BoundingSphere( const Vector3& newCenter, float newRadius )
+{
+    center = newCenter;
+    radius = newRadius;
+}
+
+Plane::Plane()
+{
+    d = 0.0f;
+}
+
+Plane::Plane( const Vector3& newNormal, float newD )
+{
+    normal = newNormal;
+    d = newD;
+}
+
+AABB aabbPoints( const Vector3* points, size_t stride, size_t count )
+{
+    if( count == 0 )
+    {
+        return AABB();
+    }
+    Vector3 outMin = *points;
+    Vector3 outMax = *points;
+    size_t i = 1;
+#if defined( OVGL_SIMD_SSE )
+    // Keep x, y and z of one point in a register, the unused fourth lane just follows along.
+    __m128 low = _mm_setr_ps( points->x, points->y, points->z, 0.0f );
+    __m128 high = low;
+    for( ; i < count; i++ )
+    {
+        const Vector3* point = OVGL_STRIDE( const Vector3, points, stride, i );
+        __m128 value = _mm_setr_ps( point->x, point->y, point->z, 0.0f );
+        low = _mm_min_ps( low, value );
+        high = _mm_max_ps( high, value );
+    }
+    float l[4], h[4];
+    _mm_storeu_ps( l, low );
+    _mm_storeu_ps( h, high );
+    outMin = Vector3( l[0], l[1], l[2] );
+    outMax = Vector3( h[0], h[1], h[2] );
+#else
+    for( ; i < count; i++ )
+    {
+        const Vector3* point = OVGL_STRIDE( const Vector3, points, stride, i );
+        outMin.x = std::min( outMin.x, point->x );
+        outMin.y = std::min( outMin.y, point->y );
+        outMin.z = std::min( outMin.z, point->z );
+        outMax.x = std::max( outMax.x, point->x );
+        outMax.y = std::max( outMax.y, point->y );
+        outMax.z = std::max( outMax.z, point->z );
+    }
+#endif
+    return AABB( outMin, outMax );
+}
+
+AABB aabbMerge( const AABB& box1, const AABB& box2 )
+{
+    AABB out;
+    out.min.x = std::min( box1.min.x, box2.min.x );
+    out.min.y = std::min( box1.min.y, box2.min.y );
+    out.min.z = std::min( box1.min.z, box2.min.z );
+    out.max.x = std::max( box1.max.x, box2.max.x );
+    out.max.y = std::max( box1.max.y, box2.max.y );
+    out.max.z = std::max( box1.max.z, box2.max.z );
+    return out;
+}
+
+AABB aabbTransform( const AABB& box, const Matrix44& matrix )
+{
+    // Arvo's method, each matrix element grows the new box by whichever corner gives the smaller or larger product.
+    AABB out;
+    out.min = Vector3( matrix._41, matrix._42, matrix._43 );
+    out.max = out.min;
+    const float* boxMin = &box.min.x;
+    const float* boxMax = &box.max.x;
+    float* outMin = &out.min.x;
+    float* outMax = &out.max.x;
+    for( int i = 0; i < 3; i++ )
+    {
+        const float* row = &matrix._11 + i * 4;
+        for( int j = 0; j < 3; j++ )
+        {
+            float a = row[j] * boxMin[i];
+            float b = row[j] * boxMax[i];
+            outMin[j] += std::min( a, b );
+            outMax[j] += std::max( a, b );
+        }
+    }
+    return out;
+}
+
+BoundingSphere boundingSphereAABB( const AABB& box )
+{
+    return BoundingSphere( box.center(), length( box.extents() ) );
+}
+
+float planeDistance( const Plane& plane, const Vector3& point )
+{
+    return vector3Dot( plane.normal, point ) + plane.d;
+}
+
+Frustum frustumMatrix( const Matrix44& matrix )
+{
+    // Gribb and Hartmann, a point is inside while -w <= x <= w, -w <= y <= w and 0 <= z <= w
+    // in clip space. With row vectors each clip component is the point dotted with one matrix column.
+    Frustum out;
+    const float* m = &matrix._11;
+    for( int i = 0; i < 6; i++ )
+    {
+        int axis = i / 2;
+        float sign = ( i % 2 ) ? -1.0f : 1.0f;
+        float plane[4];
+        for( int j = 0; j < 4; j++ )
+        {
+            float w = m[j * 4 + 3];
+            float value = m[j * 4 + axis];
+            if( i == 4 )
+            {
+                plane[j] = value;
+            }
+            else if( i == 5 )
+            {
+                plane[j] = w - m[j * 4 + 2];
+            }
+            else
+            {
+                plane[j] = w + sign * value;
+            }
+        }
+        float l = sqrt( plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2] );
+        float scale = ( l > 0.0f ) ? 1.0f / l : 0.0f;
+        out.planes[i] = Plane( Vector3( plane[0] * scale, plane[1] * scale, plane[2] * scale ), plane[3] * scale );
+    }
+    return out;
+}
+
+bool frustumIntersectsAABB( const Frustum& frustum, const AABB& box )
+{
+    Vector3 center = box.center();
+    Vector3 extents = box.extents();
+    for( int i = 0; i < 6; i++ )
+    {
+        const Plane& plane = frustum.planes[i];
+        float radius = fabs( plane.normal.x ) * extents.x + fabs( plane.normal.y ) * extents.y + fabs( plane.normal.z ) * extents.z;
+        if( planeDistance( plane, center ) + radius < 0.0f )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool frustumIntersectsSphere( const Frustum& frustum, const BoundingSphere& sphere )
+{
+    for( int i = 0; i < 6; i++ )
+    {
+        if( planeDistance( frustum.planes[i], sphere.center ) + sphere.radius < 0.0f )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t frustumIntersectsAABBArray( const Frustum& frustum, const AABB* boxes, size_t stride, bool* out, size_t count )
+{
+    size_t visible = 0;
+    size_t i = 0;
+#if defined( OVGL_SIMD_AVX )
+    // Splat every plane once, the absolute normal gives the box radius along the plane normal.
+    __m256 wide[6][7];
+    for( int p = 0; p < 6; p++ )
+    {
+        const Plane& plane = frustum.planes[p];
+        wide[p][0] = _mm256_set1_ps( plane.normal.x );
+        wide[p][1] = _mm256_set1_ps( plane.normal.y );
+        wide[p][2] = _mm256_set1_ps( plane.normal.z );
+        wide[p][3] = _mm256_set1_ps( plane.d );
+        wide[p][4] = _mm256_set1_ps( fabs( plane.normal.x ) );
+        wide[p][5] = _mm256_set1_ps( fabs( plane.normal.y ) );
+        wide[p][6] = _mm256_set1_ps( fabs( plane.normal.z ) );
+    }
+    // Eight boxes per register, two groups of four are transposed into the low and high lanes.
+    for( ; i + 8 <= count; i += 8 )
+    {
+        __m256 low[4], high[4];
+        for( size_t j = 0; j < 4; j++ )
+        {
+            const AABB* first = OVGL_STRIDE( const AABB, boxes, stride, i + j );
+            const AABB* second = OVGL_STRIDE( const AABB, boxes, stride, i + j + 4 );
+            low[j] = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( &first->min.x ) ), _mm_loadu_ps( &second->min.x ), 1 );
+            high[j] = _mm256_insertf128_ps( _mm256_castps128_ps256( _mm_loadu_ps( &first->min.z ) ), _mm_loadu_ps( &second->min.z ), 1 );
+        }
+        // Low rows hold ( min.x, min.y, min.z, max.x ) and high rows ( min.z, max.x, max.y, max.z ).
+        __m256 t0 = _mm256_unpacklo_ps( low[0], low[1] ), t1 = _mm256_unpacklo_ps( low[2], low[3] );
+        __m256 t2 = _mm256_unpackhi_ps( low[0], low[1] ), t3 = _mm256_unpackhi_ps( low[2], low[3] );
+        __m256 minX = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+        __m256 minY = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        __m256 minZ = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+        t0 = _mm256_unpacklo_ps( high[0], high[1] ), t1 = _mm256_unpacklo_ps( high[2], high[3] );
+        t2 = _mm256_unpackhi_ps( high[0], high[1] ), t3 = _mm256_unpackhi_ps( high[2], high[3] );
+        __m256 maxX = _mm256_shuffle_ps( t0, t1, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        __m256 maxY = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 1, 0, 1, 0 ) );
+        __m256 maxZ = _mm256_shuffle_ps( t2, t3, _MM_SHUFFLE( 3, 2, 3, 2 ) );
+        __m256 half = _mm256_set1_ps( 0.5f );
+        __m256 cx = _mm256_mul_ps( _mm256_add_ps( minX, maxX ), half ), ex = _mm256_mul_ps( _mm256_sub_ps( maxX, minX ), half );
+        __m256 cy = _mm256_mul_ps( _mm256_add_ps( minY, maxY ), half ), ey = _mm256_mul_ps( _mm256_sub_ps( maxY, minY ), half );
+        __m256 cz = _mm256_mul_ps( _mm256_add_ps( minZ, maxZ ), half ), ez = _mm256_mul_ps( _mm256_sub_ps( maxZ, minZ ), half );
+        __m256 outside = _mm256_setzero_ps();
+        for( int p = 0; p < 6; p++ )
+        {
+            __m256 distance = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( cx, wide[p][0] ), _mm256_mul_ps( cy, wide[p][1] ) ), _mm256_add_ps( _mm256_mul_ps( cz, wide[p][2] ), wide[p][3] ) );
+            __m256 radius = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( ex, wide[p][4] ), _mm256_mul_ps( ey, wide[p][5] ) ), _mm256_mul_ps( ez, wide[p][6] ) );
+            outside = _mm256_or_ps( outside, _mm256_cmp_ps( _mm256_add_ps( distance, radius ), _mm256_setzero_ps(), _CMP_LT_OQ ) );
+        }
+        int mask = _mm256_movemask_ps( outside );
+        for( size_t j = 0; j < 8; j++ )
+        {
+            bool inside = !( mask & ( 1 << j ) );
+            out[i + j] = inside;
+            visible += inside;
+        }
+    }
+#endif
+#if defined( OVGL_SIMD_SSE )
+    __m128 planes[6][7];
+    for( int p = 0; p < 6; p++ )
+    {
+        const Plane& plane = frustum.planes[p];
+        planes[p][0] = _mm_set1_ps( plane.normal.x );
+        planes[p][1] = _mm_set1_ps( plane.normal.y );
+        planes[p][2] = _mm_set1_ps( plane.normal.z );
+        planes[p][3] = _mm_set1_ps( plane.d );
+        planes[p][4] = _mm_set1_ps( fabs( plane.normal.x ) );
+        planes[p][5] = _mm_set1_ps( fabs( plane.normal.y ) );
+        planes[p][6] = _mm_set1_ps( fabs( plane.normal.z ) );
+    }
+    // Four boxes per register. Both loads stay inside the box, min.x to max.x and min.z to max.z.
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const AABB* a = OVGL_STRIDE( const AABB, boxes, stride, i );
+        const AABB* b = OVGL_STRIDE( const AABB, boxes, stride, i + 1 );
+        const AABB* c = OVGL_STRIDE( const AABB, boxes, stride, i + 2 );
+        const AABB* d = OVGL_STRIDE( const AABB, boxes, stride, i + 3 );
+        __m128 minX = _mm_loadu_ps( &a->min.x ), minY = _mm_loadu_ps( &b->min.x ), minZ = _mm_loadu_ps( &c->min.x ), minW = _mm_loadu_ps( &d->min.x );
+        __m128 maxW = _mm_loadu_ps( &a->min.z ), maxX = _mm_loadu_ps( &b->min.z ), maxY = _mm_loadu_ps( &c->min.z ), maxZ = _mm_loadu_ps( &d->min.z );
+        _MM_TRANSPOSE4_PS( minX, minY, minZ, minW );
+        _MM_TRANSPOSE4_PS( maxW, maxX, maxY, maxZ );
+        __m128 half = _mm_set1_ps( 0.5f );
+        __m128 cx = _mm_mul_ps( _mm_add_ps( minX, maxX ), half ), ex = _mm_mul_ps( _mm_sub_ps( maxX, minX ), half );
+        __m128 cy = _mm_mul_ps( _mm_add_ps( minY, maxY ), half ), ey = _mm_mul_ps( _mm_sub_ps( maxY, minY ), half );
+        __m128 cz = _mm_mul_ps( _mm_add_ps( minZ, maxZ ), half ), ez = _mm_mul_ps( _mm_sub_ps( maxZ, minZ ), half );
+        __m128 outside = _mm_setzero_ps();
+        for( int p = 0; p < 6; p++ )
+        {
+            __m128 distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, planes[p][0] ), _mm_mul_ps( cy, planes[p][1] ) ), _mm_add_ps( _mm_mul_ps( cz, planes[p][2] ), planes[p][3] ) );
+            __m128 radius = _mm_add_ps( _mm_add_ps( _mm_mul_ps( ex, planes[p][4] ), _mm_mul_ps( ey, planes[p][5] ) ), _mm_mul_ps( ez, planes[p][6] ) );
+            outside = _mm_or_ps( outside, _mm_cmplt_ps( _mm_add_ps( distance, radius ), _mm_setzero_ps() ) );
+        }
+        int mask = _mm_movemask_ps( outside );
+        for( size_t j = 0; j < 4; j++ )
+        {
+            bool inside = !( mask & ( 1 << j ) );
+            out[i + j] = inside;
+            visible += inside;
+        }
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        out[i] = frustumIntersectsAABB( frustum, *OVGL_STRIDE( const AABB, boxes, stride, i ) );
+        visible += out[i];
+    }
+    return visible;
+}
+
+size_t frustumIntersectsSphereArray( const Frustum& frustum, const BoundingSphere* spheres, size_t stride, bool* out, size_t count )
+{
+    size_t visible = 0;
+    size_t i = 0;
+#if defined( OVGL_SIMD_AVX )
+    for( ; i + 8 <= count; i += 8 )
+    {
+        float s[4][8];
+        for( size_t j = 0; j < 8; j++ )
+        {
+            const BoundingSphere* sphere = OVGL_STRIDE( const BoundingSphere, spheres, stride, i + j );
+            s[0][j] = sphere->center.x;
+            s[1][j] = sphere->center.y;
+            s[2][j] = sphere->center.z;
+            s[3][j] = sphere->radius;
+        }
+        __m256 cx = _mm256_loadu_ps( s[0] ), cy = _mm256_loadu_ps( s[1] ), cz = _mm256_loadu_ps( s[2] ), r = _mm256_loadu_ps( s[3] );
+        __m256 outside = _mm256_setzero_ps();
+        for( int p = 0; p < 6; p++ )
+        {
+            const Plane& plane = frustum.planes[p];
+            __m256 distance = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps( cx, _mm256_set1_ps( plane.normal.x ) ), _mm256_mul_ps( cy, _mm256_set1_ps( plane.normal.y ) ) ), _mm256_add_ps( _mm256_mul_ps( cz, _mm256_set1_ps( plane.normal.z ) ), _mm256_set1_ps( plane.d ) ) );
+            outside = _mm256_or_ps( outside, _mm256_cmp_ps( _mm256_add_ps( distance, r ), _mm256_setzero_ps(), _CMP_LT_OQ ) );
+        }
+        int mask = _mm256_movemask_ps( outside );
+        for( size_t j = 0; j < 8; j++ )
+        {
+            bool inside = !( mask & ( 1 << j ) );
+            out[i + j] = inside;
+            visible += inside;
+        }
+    }
+#endif
+#if defined( OVGL_SIMD_SSE )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        const BoundingSphere* a = OVGL_STRIDE( const BoundingSphere, spheres, stride, i );
+        const BoundingSphere* b = OVGL_STRIDE( const BoundingSphere, spheres, stride, i + 1 );
+        const BoundingSphere* c = OVGL_STRIDE( const BoundingSphere, spheres, stride, i + 2 );
+        const BoundingSphere* d = OVGL_STRIDE( const BoundingSphere, spheres, stride, i + 3 );
+        __m128 cx = _mm_setr_ps( a->center.x, b->center.x, c->center.x, d->center.x );
+        __m128 cy = _mm_setr_ps( a->center.y, b->center.y, c->center.y, d->center.y );
+        __m128 cz = _mm_setr_ps( a->center.z, b->center.z, c->center.z, d->center.z );
+        __m128 r = _mm_setr_ps( a->radius, b->radius, c->radius, d->radius );
+        __m128 outside = _mm_setzero_ps();
+        for( int p = 0; p < 6; p++ )
+        {
+            const Plane& plane = frustum.planes[p];
+            __m128 distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, _mm_set1_ps( plane.normal.x ) ), _mm_mul_ps( cy, _mm_set1_ps( plane.normal.y ) ) ), _mm_add_ps( _mm_mul_ps( cz, _mm_set1_ps( plane.normal.z ) ), _mm_set1_ps( plane.d ) ) );
+            outside = _mm_or_ps( outside, _mm_cmplt_ps( _mm_add_ps( distance, r ), _mm_setzero_ps() ) );
+        }
+        int mask = _mm_movemask_ps( outside );
+        for( size_t j = 0; j < 4; j++ )
+        {
+            bool inside = !( mask & ( 1 << j ) );
+            out[i + j] = inside;
+            visible += inside;
+        }
+    }
+#endif
+    for( ; i < count; i++ )
+    {
+        out[i] = frustumIntersectsSphere( frustum, *OVGL_STRIDE( const BoundingSphere, spheres, stride, i ) );
+        visible += out[i];
+    }
+    return visible;
+}
 }
@@ -70,19 +70,121 @@ void Mesh::generateVertexNormals()
 	}
 }
 
-void Mesh::update()
+// Appends the bytes of a value to a vertex stream.
+static void appendBytes( std::vector< uint8_t >& stream, const void* data, uint32_t size )
 {
-	SDL_GL_MakeCurrent(mediaLibrary->context->contextWindow, mediaLibrary->context->glContext);
+	stream.insert( stream.end(), (const uint8_t*)data, (const uint8_t*)data + size );
+}
+
+// Converts a float to a half float, rounding to the nearest.
+static uint16_t halfFloat( float value )
+{
+	uint32_t bits;
+	memcpy( &bits, &value, sizeof( bits ) );
+	uint32_t sign = ( bits >> 16 ) & 0x8000;
+	int32_t exponent = (int32_t)( ( bits >> 23 ) & 0xFF ) - 112;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	if( exponent <= 0 )
+	{
+		// Too small for a normal half, the implicit bit joins the denormal mantissa.
+		if( exponent < -10 )
+		{
+			return (uint16_t)sign;
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		if( ( mantissa >> ( shift - 1 ) ) & 1 )
+		{
+			half++;
+		}
+		return (uint16_t)( sign | half );
+	}
+	if( exponent >= 31 )
+	{
+		return (uint16_t)( sign | 0x7C00 );
+	}
+
+	// A carry out of the mantissa moves on into the exponent, which is the right result.
+	uint32_t half = sign | ( exponent << 10 ) | ( mantissa >> 13 );
+	if( mantissa & 0x1000 )
+	{
+		half++;
+	}
+	return (uint16_t)half;
+}
+
+// Packs a normal into signed normalized 10:10:10:2 components.
+static uint32_t packNormal( const Vector3& normal )
+{
+	uint32_t packed = 0;
+	for( uint32_t c = 0; c < 3; c++ )
+	{
+		float value = std::max( -1.0f, std::min( 1.0f, (&normal.x)[c] ) );
+		int32_t component = (int32_t)floorf( value * 511.0f + 0.5f );
+		packed |= ( (uint32_t)component & 0x3FF ) << ( c * 10 );
+	}
+	return packed;
+}
 
-	// Release buffers.
-	if( vertexBuffer ) glDeleteBuffers(1, &vertexBuffer);
-	if( indexBuffers )
+// Packs bone weights into normalized bytes. Weights that add up to one still do after
+// rounding, the heaviest weight takes the difference.
+static void packWeights( const Vector4& weight, uint8_t* packed )
+{
+	int32_t total = 0;
+	uint32_t heaviest = 0;
+	for( uint32_t w = 0; w < 4; w++ )
+	{
+		float value = std::max( 0.0f, std::min( 1.0f, (&weight.x)[w] ) );
+		packed[w] = (uint8_t)floorf( value * 255.0f + 0.5f );
+		total += packed[w];
+		if( (&weight.x)[w] > (&weight.x)[heaviest] )
+		{
+			heaviest = w;
+		}
+	}
+	if( fabsf( weight.x + weight.y + weight.z + weight.w - 1.0f ) < 0.01f )
 	{
-		for(uint32_t i = 0; i < subsetCount; i++)
-			if( indexBuffers[i] )
-				glDeleteBuffers(1, &indexBuffers[i]);
-		delete [] indexBuffers;
+		packed[heaviest] = (uint8_t)std::max( 0, std::min( 255, packed[heaviest] + 255 - total ) );
 	}
+}
+
+uint32_t Mesh::getShadingStride() const
+{
+	return ( ( vertexFormat & VERTEX_PACKED_NORMALS ) ? 4 : 12 ) + ( ( vertexFormat & VERTEX_HALF_TEXTURE ) ? 4 : 8 );
+}
+
+uint32_t Mesh::getSkinStride() const
+{
+	return ( vertexFormat & VERTEX_PACKED_SKIN ) ? 8 : 32;
+}
+
+uint32_t Mesh::getVertexMemory() const
+{
+	// The sizes are read back from GL so the report shows what the driver was given.
+	SDL_GL_MakeCurrent( mediaLibrary->context->contextWindow, mediaLibrary->context->glContext );
+	uint32_t buffers[3] = { positionBuffer, vertexBuffer, skinned ? skinBuffer : 0 };
+	uint32_t total = 0;
+	for( uint32_t b = 0; b < 3; b++ )
+	{
+		if( buffers[b] )
+		{
+			GLint size = 0;
+			glBindBuffer( GL_ARRAY_BUFFER, buffers[b] );
+			glGetBufferParameteriv( GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size );
+			total += (uint32_t)size;
+		}
+	}
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	SDL_GL_MakeCurrent( 0, 0 );
+	return total;
+}
+
+void Mesh::update()
+{
+	SDL_GL_MakeCurrent(mediaLibrary->context->contextWindow, mediaLibrary->context->glContext);
+
+	// Release bone shapes.
 	for( uint32_t i = 0; i < skeleton->bones.size(); i++ )
 	{
 		if(skeleton->bones[i]->convex)
@@ -91,9 +193,149 @@ void Mesh::update()
 		}
 	}
 
-	glGenBuffers( 1, &vertexBuffer );
+	// Cache local bounds for culling.
+	if( !vertices.empty() )
+	{
+		bounds = aabbPoints( &vertices[0].position, sizeof(Vertex), vertices.size() );
+	}
+	else
+	{
+		bounds = AABB();
+	}
+	boundingSphere = boundingSphereAABB( bounds );
+
+	// Cache the bounds of the vertices each bone moves so skinned bounds stay tight.
+	boneBounds.clear();
+	std::vector< bool > boneUsed;
+	for( uint32_t v = 0; v < vertices.size(); v++ )
+	{
+		for( uint32_t w = 0; w < 4; w++ )
+		{
+			if( (&vertices[v].weight.x)[w] > 0.0f )
+			{
+				uint32_t b = (uint32_t)(&vertices[v].indices.x)[w];
+				if( b >= boneBounds.size() )
+				{
+					boneBounds.resize( b + 1 );
+					boneUsed.resize( b + 1, false );
+				}
+				if( boneUsed[b] )
+				{
+					boneBounds[b] = aabbMerge( boneBounds[b], AABB( vertices[v].position, vertices[v].position ) );
+				}
+				else
+				{
+					boneBounds[b] = AABB( vertices[v].position, vertices[v].position );
+					boneUsed[b] = true;
+				}
+			}
+		}
+	}
+	for( uint32_t b = 0; b < boneBounds.size(); b++ )
+	{
+		// Bones that move no vertices get an inverted box so skinnedBounds skips them.
+		if( !boneUsed[b] )
+		{
+			boneBounds[b] = AABB( Vector3( 1.0f, 1.0f, 1.0f ), Vector3( -1.0f, -1.0f, -1.0f ) );
+		}
+	}
+
+	// Vertices whose whole weight is on bone 0 are drawn the same with the constant weights
+	// set when their vertex array objects are built, so they get no skinning stream.
+	skinned = false;
+	for( uint32_t v = 0; v < vertices.size() && !skinned; v++ )
+	{
+		const Vertex& vertex = vertices[v];
+		float total = vertex.weight.x + vertex.weight.y + vertex.weight.z + vertex.weight.w;
+		skinned = fabsf( total - 1.0f ) > 0.0001f;
+		for( uint32_t w = 0; w < 4 && !skinned; w++ )
+		{
+			skinned = (&vertex.weight.x)[w] != 0.0f && (&vertex.indices.x)[w] != 0.0f;
+		}
+	}
+
+	// Normals always fit 10 bits a component. Texture coordinates are halved only if they
+	// keep a step of 1/1024 or finer, and bones only if their indices fit a byte.
+	vertexFormat = 0;
+	if( packVertices )
+	{
+		vertexFormat = VERTEX_PACKED_NORMALS | VERTEX_HALF_TEXTURE | VERTEX_PACKED_SKIN;
+		for( uint32_t v = 0; v < vertices.size(); v++ )
+		{
+			if( fabsf( vertices[v].texture.x ) > 2.0f || fabsf( vertices[v].texture.y ) > 2.0f )
+			{
+				vertexFormat &= ~VERTEX_HALF_TEXTURE;
+			}
+			for( uint32_t w = 0; w < 4; w++ )
+			{
+				float index = (&vertices[v].indices.x)[w];
+				if( index < 0.0f || index > 255.0f || index != floorf( index ) )
+				{
+					vertexFormat &= ~VERTEX_PACKED_SKIN;
+				}
+			}
+		}
+	}
+
+	std::vector< Vector3 > positions( vertices.size() );
+	std::vector< uint8_t > shading;
+	std::vector< uint8_t > skin;
+	shading.reserve( vertices.size() * getShadingStride() );
+	skin.reserve( skinned ? vertices.size() * getSkinStride() : 0 );
+	for( uint32_t v = 0; v < vertices.size(); v++ )
+	{
+		const Vertex& vertex = vertices[v];
+		positions[v] = vertex.position;
+		if( vertexFormat & VERTEX_PACKED_NORMALS )
+		{
+			uint32_t normal = packNormal( vertex.normal );
+			appendBytes( shading, &normal, sizeof( normal ) );
+		}
+		else
+		{
+			appendBytes( shading, &vertex.normal, sizeof( Vector3 ) );
+		}
+		if( vertexFormat & VERTEX_HALF_TEXTURE )
+		{
+			uint16_t texture[2] = { halfFloat( vertex.texture.x ), halfFloat( vertex.texture.y ) };
+			appendBytes( shading, texture, sizeof( texture ) );
+		}
+		else
+		{
+			appendBytes( shading, &vertex.texture, sizeof( Vector2 ) );
+		}
+		if( skinned && ( vertexFormat & VERTEX_PACKED_SKIN ) )
+		{
+			uint8_t packed[8];
+			packWeights( vertex.weight, packed );
+			for( uint32_t w = 0; w < 4; w++ )
+			{
+				packed[4 + w] = (uint8_t)(&vertex.indices.x)[w];
+			}
+			appendBytes( skin, packed, sizeof( packed ) );
+		}
+		else if( skinned )
+		{
+			appendBytes( skin, &vertex.weight, sizeof( Vector4 ) );
+			appendBytes( skin, &vertex.indices, sizeof( Vector4 ) );
+		}
+	}
+
+	// The vertex array objects hold the layout of the streams, which may have changed, so
+	// every context builds them again on next use.
+	releaseVertexArrays( NULL );
+	if( !positionBuffer ) glGenBuffers( 1, &positionBuffer );
+	glBindBuffer( GL_ARRAY_BUFFER, positionBuffer );
+	glBufferData( GL_ARRAY_BUFFER, positions.size() * sizeof(Vector3), positions.empty() ? NULL : &positions[0], GL_STATIC_DRAW );
+	if( !vertexBuffer ) glGenBuffers( 1, &vertexBuffer );
 	glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
-	glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW );
+	glBufferData( GL_ARRAY_BUFFER, shading.size(), shading.empty() ? NULL : &shading[0], GL_STATIC_DRAW );
+	if( skinned )
+	{
+		if( !skinBuffer ) glGenBuffers( 1, &skinBuffer );
+		glBindBuffer( GL_ARRAY_BUFFER, skinBuffer );
+		glBufferData( GL_ARRAY_BUFFER, skin.size(), &skin[0], GL_STATIC_DRAW );
+	}
 	glBindBuffer( GL_ARRAY_BUFFER, 0 );
 
 	// Create index buffers.
@@ -116,13 +358,20 @@ void Mesh::update()
 	// Get subset count.
 	subsetCount = indexSubsets.size();
 
-	indexBuffers = new uint32_t[subsetCount];
+	// Every subset is stored in one index buffer, the count and first index of each are kept
+	// so drawing needs no buffer queries.
+	std::vector< Face > indexData;
+	indexCounts.resize( subsetCount );
+	indexStarts.resize( subsetCount );
 	for( uint32_t i = 0; i < subsetCount; i++ )
 	{
-		glGenBuffers( 1, &indexBuffers[i] );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffers[i] );
-		glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexSubsets[i].size()*sizeof(Face), &indexSubsets[i][0], GL_STATIC_DRAW );
+		indexStarts[i] = indexData.size() * 3;
+		indexCounts[i] = indexSubsets[i].size() * 3;
+		indexData.insert( indexData.end(), indexSubsets[i].begin(), indexSubsets[i].end() );
 	}
+	if( !indexBuffer ) glGenBuffers( 1, &indexBuffer );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indexData.size() * sizeof(Face), indexData.empty() ? NULL : &indexData[0], GL_STATIC_DRAW );
 	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
 
 	// Create triangle mesh.
@@ -159,9 +408,154 @@ void Mesh::update()
 	SDL_GL_MakeCurrent( 0, 0 );
 }
 
+AABB Mesh::skinnedBounds( const std::vector< Matrix44 >& pose ) const
+{
+	// Skinned vertices are weighted averages of their bones' transforms so they stay inside
+	// the union of each bone's transformed vertex bounds.
+	AABB out;
+	bool empty = true;
+	for( uint32_t b = 0; b < boneBounds.size() && b < pose.size(); b++ )
+	{
+		if( boneBounds[b].min.x > boneBounds[b].max.x )
+		{
+			continue;
+		}
+		AABB box = aabbTransform( boneBounds[b], pose[b] );
+		out = empty ? box : aabbMerge( out, box );
+		empty = false;
+	}
+	if( empty && !pose.empty() )
+	{
+		out = aabbTransform( bounds, pose[0] );
+	}
+	return out;
+}
+
+// Builds a vertex array object reading the position and skinning streams of a mesh, and its
+// shading stream if asked to.
+static uint32_t buildVertexArray( const Mesh* mesh, bool shading )
+{
+	uint32_t vertexArray;
+	glGenVertexArrays( 1, &vertexArray );
+	glBindVertexArray( vertexArray );
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mesh->indexBuffer );
+
+	glBindBuffer( GL_ARRAY_BUFFER, mesh->positionBuffer );
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vector3 ), NULL );
+	glEnableVertexAttribArray( 0 );
+	// Packed attributes are expanded to floats by the vertex fetch, so the effects read every
+	// format the same. Bone indices are converted without normalizing and keep their values.
+	if( shading )
+	{
+		uint32_t stride = mesh->getShadingStride();
+		glBindBuffer( GL_ARRAY_BUFFER, mesh->vertexBuffer );
+		if( mesh->vertexFormat & VERTEX_PACKED_NORMALS )
+		{
+			glVertexAttribPointer( 1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, ( (char *)NULL + (0) ) );
+		}
+		else
+		{
+			glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, ( (char *)NULL + (0) ) );
+		}
+		uint32_t textureOffset = ( mesh->vertexFormat & VERTEX_PACKED_NORMALS ) ? 4 : 12;
+		if( mesh->vertexFormat & VERTEX_HALF_TEXTURE )
+		{
+			glVertexAttribPointer( 2, 2, GL_HALF_FLOAT, GL_FALSE, stride, ( (char *)NULL + textureOffset ) );
+		}
+		else
+		{
+			glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, stride, ( (char *)NULL + textureOffset ) );
+		}
+		glEnableVertexAttribArray( 1 );
+		glEnableVertexAttribArray( 2 );
+	}
+	if( mesh->skinned )
+	{
+		glBindBuffer( GL_ARRAY_BUFFER, mesh->skinBuffer );
+		if( mesh->vertexFormat & VERTEX_PACKED_SKIN )
+		{
+			glVertexAttribPointer( 3, 4, GL_UNSIGNED_BYTE, GL_TRUE, 8, ( (char *)NULL + (0) ) );
+			glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_FALSE, 8, ( (char *)NULL + (4) ) );
+		}
+		else
+		{
+			glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, 2 * sizeof( Vector4 ), ( (char *)NULL + (0) ) );
+			glVertexAttribPointer( 4, 4, GL_FLOAT, GL_FALSE, 2 * sizeof( Vector4 ), ( (char *)NULL + (16) ) );
+		}
+		glEnableVertexAttribArray( 3 );
+		glEnableVertexAttribArray( 4 );
+	}
+
+	// Meshes without weights leave attributes 3 and 4 disabled. Disabled attributes read the
+	// context's current values, which glColor overwrites on some drivers, so the renderer draws
+	// these meshes like single bone meshes and sets the values again before drawing them.
+
+	glBindVertexArray( 0 );
+	glBindBuffer( GL_ARRAY_BUFFER, 0 );
+	return vertexArray;
+}
+
+uint32_t Mesh::getVertexArray() const
+{
+	// Vertex array objects are not shared between GL contexts and every window renders with
+	// its own, so each context gets its own copy.
+	void* glContext = SDL_GL_GetCurrentContext();
+	std::map< void*, uint32_t >::iterator found = vertexArrays.find( glContext );
+	if( found != vertexArrays.end() )
+	{
+		return found->second;
+	}
+	uint32_t vertexArray = buildVertexArray( this, true );
+	vertexArrays[glContext] = vertexArray;
+	return vertexArray;
+}
+
+void Mesh::releaseVertexArrays( void* glContext )
+{
+	// Vertex array objects can only be deleted from their own context, the context deletes
+	// the others once their contexts are current again.
+	std::map< void*, uint32_t >* arrays[2] = { &vertexArrays, &depthArrays };
+	for( uint32_t a = 0; a < 2; a++ )
+	{
+		for( std::map< void*, uint32_t >::iterator i = arrays[a]->begin(); i != arrays[a]->end(); )
+		{
+			if( !glContext || i->first == glContext )
+			{
+				mediaLibrary->context->releaseVertexArray( i->first, i->second );
+				arrays[a]->erase( i++ );
+			}
+			else
+			{
+				++i;
+			}
+		}
+	}
+}
+
+uint32_t Mesh::getDepthVertexArray() const
+{
+	void* glContext = SDL_GL_GetCurrentContext();
+	std::map< void*, uint32_t >::iterator found = depthArrays.find( glContext );
+	if( found != depthArrays.end() )
+	{
+		return found->second;
+	}
+	uint32_t vertexArray = buildVertexArray( this, false );
+	depthArrays[glContext] = vertexArray;
+	return vertexArray;
+}
+
 Mesh::Mesh()
 {
 	triangleMesh = NULL;
+	positionBuffer = 0;
+	vertexBuffer = 0;
+	skinBuffer = 0;
+	skinned = false;
+	packVertices = true;
+	vertexFormat = 0;
+	indexBuffer = 0;
+	subsetCount = 0;
 }
 
 Mesh::~Mesh()
@@ -174,11 +568,16 @@ Mesh::~Mesh()
 			mediaLibrary->meshes.erase( mediaLibrary->meshes.begin() + m );
 		}
 	}
+	// Buffers are deleted from the context's own GL context, whichever one the caller has current.
+	SDL_Window* currentWindow = SDL_GL_GetCurrentWindow();
+	SDL_GLContext currentContext = SDL_GL_GetCurrentContext();
+	SDL_GL_MakeCurrent( mediaLibrary->context->contextWindow, mediaLibrary->context->glContext );
+	releaseVertexArrays( NULL );
+	glDeleteBuffers( 1, &positionBuffer );
 	glDeleteBuffers( 1, &vertexBuffer );
-	for( uint32_t i = 0; i < subsetCount; i++)
-	{
-		glDeleteBuffers( 1, &indexBuffers[i] );
-	}
+	glDeleteBuffers( 1, &skinBuffer );
+	glDeleteBuffers( 1, &indexBuffer );
+	SDL_GL_MakeCurrent( currentWindow, currentContext );
 }
 
 void CMesh::setPose( const Matrix44& matrix )
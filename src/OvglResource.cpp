@@ -281,8 +281,10 @@ void ResourceManager::loadResources( const std::string& file )
 			}
 
 			// Nullify buffer addresses.
+			mesh->positionBuffer = 0;
 			mesh->vertexBuffer = 0;
-			mesh->indexBuffers = 0;
+			mesh->skinBuffer = 0;
+			mesh->indexBuffer = 0;
 
 			// Update buffers.
 			mesh->update();
@@ -431,7 +433,7 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 						bone->parent = NULL;
 						aiNode* bnode = scene->mRootNode->FindNode(scene->mMeshes[m]->mBones[b]->mName);
 						bone->localTransform = Ovgl::matrixTranspose(*(Matrix44*)&bnode->mTransformation);
-						bone->matrix = matrixInverse( Vector4(), Ovgl::matrixTranspose(*(Matrix44*)&scene->mMeshes[m]->mBones[b]->mOffsetMatrix));
+						bone->matrix = matrixInverseAffine( Ovgl::matrixTranspose(*(Matrix44*)&scene->mMeshes[m]->mBones[b]->mOffsetMatrix));
 
 						if(!z_up)
 						{
@@ -576,17 +578,6 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 						vertex.normal.x = scene->mMeshes[m]->mNormals[vi].x;
 						vertex.normal.y = scene->mMeshes[m]->mNormals[vi].y;
 						vertex.normal.z = scene->mMeshes[m]->mNormals[vi].z;
-
-						if( scene->mMeshes[m]->HasBones() && !z_up)
-						{
-							vertex.position = vector3Transform(vertex.position, matrixRotationX(1.57f));
-							vertex.normal = vector3Transform(vertex.normal, matrixRotationX(1.57f));
-						}
-						else if(!scene->mMeshes[m]->HasBones())
-						{
-							vertex.position = vector3Transform(vertex.position, matrix);
-							vertex.normal = vector3Transform(vertex.normal, matrix.rotation());
-						}
 						if(scene->mMeshes[m]->GetNumUVChannels() > 0)
 						{
 							vertex.texture.x = scene->mMeshes[m]->mTextureCoords[0][vi].x;
@@ -625,6 +616,15 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 					mesh->faces.push_back( face );
 					mesh->attributes.push_back(scene->mMeshes[m]->mMaterialIndex);
 				}
+
+				// Move all of this mesh's vertices into place in one batch instead of once per face corner.
+				if( scene->mMeshes[m]->mNumVertices > 0 && !( scene->mMeshes[m]->HasBones() && z_up ) )
+				{
+					Matrix44 vertexMatrix = scene->mMeshes[m]->HasBones() ? matrixRotationX(1.57f) : matrix;
+					Vertex* first = &mesh->vertices[voffset];
+					vector3TransformArray( vertexMatrix, &first->position, sizeof(Vertex), &first->position, sizeof(Vertex), scene->mMeshes[m]->mNumVertices );
+					vector3TransformNormalArray( vertexMatrix, &first->normal, sizeof(Vertex), &first->normal, sizeof(Vertex), scene->mMeshes[m]->mNumVertices );
+				}
 			}
 		}
 
@@ -644,6 +644,7 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 		// Save vertices which influence each bone for bone shape automatic generation.
 		for( uint32_t i = 0; i < mesh->skeleton->bones.size(); i++ )
 		{
+			std::vector< Vertex >& boneVertices = mesh->skeleton->bones[i]->mesh->vertices;
 			for( uint32_t v = 0; v < mesh->vertices.size(); v++ )
 			{
 				for( uint32_t j = 0; j < 4; j++)
@@ -651,12 +652,19 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 					if(mesh->vertices[v].indices[j] == i && mesh->vertices[v].weight[j] > 0.1f)
 					{
 						Vertex vertex;
-						vertex.position = vector3Transform( mesh->vertices[v].position, matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), mesh->skeleton->bones[i]->matrix));
+						vertex.position = mesh->vertices[v].position;
 						vertex.weight[0] = 1.0f;
-						mesh->skeleton->bones[i]->mesh->vertices.push_back( vertex );
+						boneVertices.push_back( vertex );
 					}
 				}
 			}
+
+			// Bring the gathered vertices into bone space together.
+			if( boneVertices.size() > 0 )
+			{
+				Matrix44 invBone = matrixInverseAffine( mesh->skeleton->bones[i]->matrix );
+				vector3TransformArray( invBone, &boneVertices[0].position, sizeof(Vertex), &boneVertices[0].position, sizeof(Vertex), boneVertices.size() );
+			}
 		}
 
 		// Find the root bone.
@@ -684,8 +692,10 @@ Mesh* ResourceManager::importModel( const std::string& file, bool z_up )
 		}
 
 		// Null index and vertex buffers.
+		mesh->positionBuffer = 0;
 		mesh->vertexBuffer = 0;
-		mesh->indexBuffers = 0;
+		mesh->skinBuffer = 0;
+		mesh->indexBuffer = 0;
 
 		// Update video memory copies of index and vertex buffers.
 		if(mesh->vertices.size() > 0)
@@ -925,6 +935,9 @@ Shader* ResourceManager::importShader( const std::string& file )
 		fprintf(stderr, "Compiler: %s\n", string);
 	}
 
+	// Look up the engine parameters once.
+	shader->resolveParameters();
+
 	//Add Effect to array
 	shaders.push_back( shader );
 
@@ -937,6 +950,7 @@ Scene* ResourceManager::createScene()
 	Ovgl::Scene* scene = new Ovgl::Scene;
 	scene->context = context;
 	scene->skyBox = NULL;
+	scene->staticRevision = 0;
 	scene->dynamicsWorld = new btDiscreteDynamicsWorld( context->physicsDispatcher, context->physicsBroadphase, context->physicsSolver, context->physicsConfiguration );
 	scene->dynamicsWorld->getDispatchInfo().m_allowedCcdPenetration = 0.00001f;
 	scene->dynamicsWorld->setGravity(btVector3( 0.0f, -9.8f, 0.0f ));
@@ -950,10 +964,11 @@ Material* ResourceManager::createMaterial( )
 {
 	Material* material = new Material;
 	material->mLibrary = this;
-	material->shaderProgram = context->defaultMedia->shaders[0];
+	material->shaderProgram = context->defaultMedia->shaders[DEFAULT_SHADER_MESH];
 	material->noZBuffer = false;
 	material->noZWrite = false;
 	material->postRender = false;
+	material->revision = 0;
 	material->setEffectTexture("txDiffuse", context->defaultMedia->textures[0] );
 	material->setEffectTexture("txEnvironment", context->defaultMedia->textures[1] );
 	materials.push_back(material);
@@ -147,39 +147,10 @@ Light* Scene::createLight( const Matrix44& matrix, const Vector4& color, const L
 	light->color.y = color.y;
 	light->color.z = color.z;
 
-	// Shadow framebuffer
-	glGenFramebuffers( 1, &light->shadowFrameBuffer );
-	glBindFramebuffer( GL_FRAMEBUFFER, light->shadowFrameBuffer );
-
-	if(type == 2)
-	{
-		// Create and bind depth cubemap texture
-		for (int face = 1; face < 6; face++)
-		{
-			glGenTextures( 1, &light->depthTexture );
-			glBindTexture( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, light->depthTexture );
-			glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT32, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL );
-			glTexParameteri( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-			glTexParameteri( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-			glTexParameteri( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-			glTexParameteri( GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-			glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, light->depthTexture, 0 );
-		}
-	}
-	else
-	{
-		// Create and bind depth texture
-		glGenTextures( 1, &light->depthTexture );
-		glBindTexture( GL_TEXTURE_2D, light->depthTexture );
-		glTexImage2D( GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, 1024, 1024, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, light->depthTexture, 0 );
-	}
-
-	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+	// Spot lights cover a right angle, lights reach everything and cast shadows until told otherwise.
+	light->angle = ( (float)OvglPi ) / 2.0f;
+	light->radius = 0.0f;
+	light->castShadows = true;
 
 	// Add light to scene list of lights.
 	this->lights.push_back( light );
@@ -306,6 +277,7 @@ Object* Scene::createObject( Mesh* mesh, const Matrix44& matrix )
 		object->cMesh = cMesh;
 		dynamicsWorld->addRigidBody(cMesh->actor, btBroadphaseProxy::StaticFilter, btBroadphaseProxy::DefaultFilter | btBroadphaseProxy::CharacterFilter);
 		this->objects.push_back( object );
+		staticRevision++;
 		return object;
 	}
 	else
@@ -333,7 +305,7 @@ Actor* Scene::createActor( Mesh* mesh, float radius, float height, const Matrix4
 		{
 			actor->pose->matrices[i] = matrixIdentity();
 			actor->pose->joints[i]->offset = mesh->skeleton->bones[i]->matrix;
-			actor->pose->joints[i]->localTransform = mesh->skeleton->bones[i]->localTransform;
+			actor->pose->joints[i]->localTransform = transformMatrix( mesh->skeleton->bones[i]->localTransform );
 			if(mesh->skeleton->bones[i]->parent)
 			{
 				actor->pose->joints[i]->parent = actor->pose->joints[mesh->skeleton->bones[i]->parent->index];
@@ -396,7 +368,7 @@ Constraint* Scene::createConstraint( CMesh* obj1, CMesh* obj2)
 	bodyMatA = joint->obj[0]->getPose();
 	bodyMatB = joint->obj[1]->getPose();
 	btTransform frameInA, frameInB;
-	Matrix44 diff = (bodyMatB * matrixInverse(Vector4( 0.0f, 0.0f, 0.0f, 0.0f), bodyMatA));
+	Matrix44 diff = (bodyMatB * matrixInverseRigid( bodyMatA ));
 	frameInA.setFromOpenGLMatrix((float*)&diff);
 	frameInB.setIdentity();
 	joint->joint = new btGeneric6DofConstraint( *obj1->actor, *obj2->actor, frameInA, frameInB, true );
@@ -421,6 +393,7 @@ void Object::setPose( const Matrix44& matrix )
 	btTransform transform;
 	transform.setFromOpenGLMatrix( (float*)&matrix );
 	cMesh->actor->setWorldTransform(transform);
+	scene->staticRevision++;
 }
 
 void Camera::setPose( const Matrix44& matrix )
@@ -444,6 +417,16 @@ Matrix44 Object::getPose()
 	return matrix;
 };
 
+AABB Object::getBounds()
+{
+	return aabbTransform( mesh->bounds, getPose() );
+}
+
+AABB Prop::getBounds()
+{
+	return mesh->skinnedBounds( matrices );
+}
+
 Matrix44 Emitter::getPose()
 {
 	Matrix44 matrix;
@@ -472,130 +455,9 @@ Matrix44 Actor::getPose()
 	return matrix;
 }
 
-void Light::renderShadow( const Ovgl::Mesh& mesh, const Matrix44& matrix, std::vector< Matrix44 >& pose, bool PostRender )
+AABB Actor::getBounds()
 {
-
-/*
-	Matrix44 viewProj = (matrixInverse( Vector4( 0.0f, 0.0f, 0.0f, 0.0f ), getPose() ) * view->projMat);
-	Matrix44 worldMat = (matrix * viewProj );
-	glLoadMatrixf((float*)&worldMat);
-
-	float lightCount = (float)view->scene->lights.size();
-	std::vector< float > mLights;
-	std::vector< float > lightColors;
-	for( uint32_t l = 0; l < view->scene->lights.size(); l++)
-	{
-		mLights.push_back( view->scene->lights[l]->getPose()._41 );
-		mLights.push_back( view->scene->lights[l]->getPose()._42 );
-		mLights.push_back( view->scene->lights[l]->getPose()._43 );
-		mLights.push_back( 1.0f );
-		lightColors.push_back( view->scene->lights[l]->color.x );
-		lightColors.push_back( view->scene->lights[l]->color.y );
-		lightColors.push_back( view->scene->lights[l]->color.z );
-		lightColors.push_back( 1.0f );
-	}
-
-	for( uint32_t s = 0; s < mesh.subsetCount; s++)
-	{
-		glEnable (GL_DEPTH_TEST);
-		glDepthMask (GL_TRUE);
-
-		CGparameter cgWorldMatrix = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "World" );
-		Matrix44 tWorldMat = matrixTranspose(worldMat);
-		cgGLSetMatrixParameterfc( cgWorldMatrix, (float*)&tWorldMat );
-		CGparameter cgViewProjMatrix = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "ViewProj" );
-		Matrix44 tViewProj = matrixTranspose(viewProj);
-		cgGLSetMatrixParameterfc( cgViewProjMatrix, (float*)&tViewProj );
-		CGparameter cgViewPos= cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "ViewPos" );
-		cgGLSetParameter4f( cgViewPos, view->getPose()._41, view->getPose()._42, view->getPose()._43, view->getPose()._44 );
-
-		CGparameter cgBoneMatrices = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "Bones" );
-		for( uint32_t v = 0; v < pose.size(); v++)
-		{
-			CGparameter cgBone = cgGetArrayParameter( cgBoneMatrices, v );
-			Matrix44 tPose = matrixTranspose(pose[v]);
-			cgGLSetMatrixParameterfc(cgBone, (float*)&tPose);
-		}
-
-		CGparameter cgLightCount = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "LightCount" );
-		cgGLSetParameter1f( cgLightCount, lightCount );
-
-		CGparameter CgLights = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "Lights" );
-		CGparameter CgLight;
-		for( uint32_t v = 0; v < mLights.size() / 4; v++)
-		{
-			CgLight=cgGetArrayParameter( CgLights, v );
-			cgGLSetParameter4fv(CgLight, (float*)&mLights[v * 4]);
-		}
-
-		CGparameter CgLightColors = cgGetNamedEffectParameter( materials[s]->shaderProgram->effect, "LightColors" );
-		CGparameter CgLightColor;
-		for( uint32_t v = 0; v < lightColors.size() / 4; v++)
-		{
-			CgLightColor=cgGetArrayParameter( CgLightColors, v );
-			cgGLSetParameter4fv(CgLightColor, (float*)&lightColors[v * 4]);
-		}
-
-		for( uint32_t v = 0; v < materials[s]->textures.size(); v++)
-		{
-			CGparameter CgTexture = materials[s]->textures[v].first;
-			cgGLSetTextureParameter( CgTexture, materials[s]->textures[v].second->image );
-			cgGLEnableTextureParameter( CgTexture );
-		}
-
-		for( uint32_t v = 0; v < materials[s]->variables.size(); v++)
-		{
-			CGparameter CgVariable = materials[s]->variables[v].first;
-			cgSetParameterValuefr( CgVariable, materials[s]->variables[v].second.size(), (float*)&materials[s]->variables[v].second[0] );
-		}
-
-		glBindBuffer( GL_ARRAY_BUFFER, mesh.vertexBuffer );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffers[s] );
-
-		// Set vertex attributes
-		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (0) ) );
-		glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (12) ) );
-		glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (24) ) );
-		glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (32) ) );
-		glVertexAttribPointer( 4, 4, GL_FLOAT, GL_FALSE, sizeof( Vertex ), ( (char *)NULL + (48) ) );
-
-		// Enable vertex attributes
-		glEnableVertexAttribArray( 0 );
-		glEnableVertexAttribArray( 1 );
-		glEnableVertexAttribArray( 2 );
-		glEnableVertexAttribArray( 3 );
-		glEnableVertexAttribArray( 4 );
-
-		CGtechnique tech = cgGetFirstTechnique( materials[s]->shaderProgram->effect );
-		CGpass pass;
-		pass = cgGetFirstPass(tech);
-		while (pass)
-		{
-			cgSetPassState(pass);
-			int BufferSize;
-			glGetBufferParameteriv( GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &BufferSize);
-			glDrawElements( GL_TRIANGLES, BufferSize / sizeof( uint32_t ), GL_UNSIGNED_INT, 0 );
-			cgResetPassState(pass);
-			pass = cgGetNextPass(pass);
-		}
-
-		// Disable vertex attributes
-		glDisableVertexAttribArray( 0 );
-		glDisableVertexAttribArray( 1 );
-		glDisableVertexAttribArray( 2 );
-		glDisableVertexAttribArray( 3 );
-		glDisableVertexAttribArray( 4 );
-
-		glBindBuffer( GL_ARRAY_BUFFER, 0 );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
-
-		for( uint32_t v = 0; v < materials[s]->textures.size(); v++)
-		{
-			CGparameter cgTexture = materials[s]->textures[v].first;
-			cgGLDisableTextureParameter( cgTexture );
-		}
-	}
-*/
+	return mesh->skinnedBounds( pose->matrices );
 }
 
 void Prop::update( Bone* bone, Matrix44* matrix )
@@ -604,9 +466,9 @@ void Prop::update( Bone* bone, Matrix44* matrix )
 	matrices[bone->index] = bones[bone->index]->getPose();
 	if( this->mesh->skeleton->bones.size() > 0 )
 	{
-		invMeshBone = matrixInverse( Vector4(0,0,0,0), bone->matrix );
+		invMeshBone = matrixInverseAffine( bone->matrix );
 		matrices[bone->index] = ( invMeshBone * matrices[bone->index] );
-		invMatrix = matrixInverse( Vector4(0,0,0,0), *matrix );
+		invMatrix = matrixInverseAffine( *matrix );
 		tMatrix = matrices[bone->index] * invMatrix;
 		for (uint32_t i = 0; i < bone->children.size(); i++)
 		{
@@ -633,7 +495,7 @@ void Prop::createJoints( Bone* bone )
 			bodyMatA = joint->obj[0]->getPose();
 			bodyMatB = joint->obj[1]->getPose();
 			btTransform frameInA, frameInB;
-			Matrix44 diff = (bodyMatB * matrixInverse(Vector4( 0.0f, 0.0f, 0.0f, 0.0f), bodyMatA));
+			Matrix44 diff = (bodyMatB * matrixInverseRigid( bodyMatA ));
 			frameInA.setFromOpenGLMatrix((float*)&diff);
 			frameInB.setIdentity();
 			joint->joint = new btGeneric6DofConstraint( *joint->obj[0]->actor, *joint->obj[1]->actor, frameInA, frameInB, true );
@@ -886,6 +748,7 @@ void Object::release()
 			scene->objects.erase( scene->objects.begin() + i );
 		}
 	}
+	scene->staticRevision++;
 	delete cMesh;
 	delete this;
 }
@@ -115,14 +115,7 @@ void Pose::evaluate( Animation* anim, float pTime )
 			presentScaling = channel->scalingKeys[frame].value;
 		}
 
-		Matrix44 mat = Ovgl::matrixRotationQuaternion( presentRotation );
-
-		mat._11 *= presentScaling.x; mat._12 *= presentScaling.x; mat._13 *= presentScaling.x;
-		mat._21 *= presentScaling.y; mat._22 *= presentScaling.y; mat._23 *= presentScaling.y;
-		mat._31 *= presentScaling.z; mat._32 *= presentScaling.z; mat._33 *= presentScaling.z;
-		mat._41 = presentPosition.x; mat._42 = presentPosition.y; mat._43 = presentPosition.z;
-
-		joints[channel->index]->localTransform = mat;
+		joints[channel->index]->localTransform = Transform( presentRotation, presentPosition, presentScaling );
 	}
 }
 
@@ -130,21 +123,23 @@ void Pose::animate( Animation* anim, float time )
 {
 	evaluate( anim, time );
 	updateTransforms( rootJoint );
+	// Matrices are only built here, for the skinning palette.
 	for(uint32_t b = 0; b < matrices.size(); b++)
 	{
-		matrices[b] = joints[b]->globalTransform;
-		matrices[b] = matrixInverse( Vector4(), joints[b]->offset) * matrices[b];
+		matrices[b] = matrixInverseAffine( joints[b]->offset ) * matrixTransform( joints[b]->globalTransform );
 	}
 }
 
 void Pose::updateTransforms(Joint* pNode)
 {
-	pNode->globalTransform = pNode->localTransform;
-	Joint* parent = pNode->parent;
-	while( parent )
+	// Parents are always updated before their children so one compose per joint is enough.
+	if( pNode->parent )
+	{
+		pNode->globalTransform = pNode->localTransform * pNode->parent->globalTransform;
+	}
+	else
 	{
-		pNode->globalTransform = pNode->globalTransform * parent->localTransform;
-		parent  = parent->parent;
+		pNode->globalTransform = pNode->localTransform;
 	}
 
 	for( uint32_t i = 0; i < pNode->children.size(); i++)
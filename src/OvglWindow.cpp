@@ -18,7 +18,9 @@
 
 #include "OvglContext.h"
 #include "OvglMath.h"
+#include "OvglResource.h"
 #include "OvglGraphics.h"
+#include "OvglMesh.h"
 #include "OvglWindow.h"
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
@@ -291,10 +293,24 @@ Window::Window( Context* pcontext, const std::string& name, unsigned int width,
 
 Window::~Window()
 {
-	for( uint32_t r = 0; r < renderTargets.size(); r++ )
+	// Frame buffers, queries and vertex array objects are not shared, the ones built in this
+	// window's context are deleted from it before it goes.
+	SDL_GL_MakeCurrent( sdlWindow, windowContext );
+	while( !renderTargets.empty() )
+	{
+		delete renderTargets.back();
+	}
+	for( uint32_t l = 0; l < context->mediaLibraries.size(); l++ )
 	{
-		delete renderTargets[r];
+		for( uint32_t m = 0; m < context->mediaLibraries[l]->meshes.size(); m++ )
+		{
+			context->mediaLibraries[l]->meshes[m]->releaseVertexArrays( windowContext );
+		}
 	}
+	context->skinCache->releaseVertexArrays( windowContext );
+	context->deleteReleasedVertexArrays();
+	SDL_GL_MakeCurrent( 0, 0 );
+	SDL_GL_DeleteContext( windowContext );
 	SDL_DestroyWindow(sdlWindow);
 }
 